@@ -45,6 +45,8 @@ EOS_TYPES = {
         "pmlf4": 0x07,
         "pmlf6": 0x08,
         }
+TRAJECTORY_FIELDS = {"positions": 1, "velocities": 2, "orbits": 4}
+TRAJECTORY_COLUMNS = ["x", "y", "z", "vx", "vy", "vz", "a", "e", "inc", "Omega", "omega", "l"]
 
 # Format: Majorerror, id, message
 BINARY_WARNINGS = [
@@ -56,7 +58,8 @@ BINARY_WARNINGS = [
     (True,  32, "Index out of range.",),
     (True,  64, "Error while trying to seek file.",),
     (False, 128, "Encountered unkown field in file. File might have been saved with a different version of REBOUND."),
-    (True,  256, "Integrator type is not supported by this simulation archive version.")
+    (True,  256, "Integrator type is not supported by this simulation archive version."),
+    (True,  512, "Binary file is corrupt. A field extends past the end of the file.")
 ]
 
 class reb_hash_pointer_pair(Structure):
@@ -68,6 +71,23 @@ class reb_vec3d(Structure):
                 ("y", c_double),
                 ("z", c_double)]
 
+class reb_mixed_precision_report(Structure):
+    """
+    Relative acceleration errors of the mixed precision force calculation.
+    Returned by Simulation.mixed_precision_report().
+
+    :ivar float max_error:          Largest relative acceleration error
+    :ivar float rms_error:          Root mean square of the relative acceleration errors
+    :ivar int max_error_index:      Index of the particle with the largest error
+    :ivar int N:                    Number of particles compared
+    """
+    _fields_ = [("max_error", c_double),
+                ("rms_error", c_double),
+                ("max_error_index", c_int),
+                ("N", c_int)]
+    def __repr__(self):
+        return '<{0}.{1} object at {2}, max_error={3}, rms_error={4}, max_error_index={5}, N={6}>'.format(self.__module__, type(self).__name__, hex(id(self)), self.max_error, self.rms_error, self.max_error_index, self.N)
+
 class reb_dp7(Structure):
     _fields_ = [("p0", POINTER(c_double)),
                 ("p1", POINTER(c_double)),
@@ -118,7 +138,8 @@ class reb_simulation_integrator_sei(Structure):
                 ("_sindt", c_double),
                 ("_tandt", c_double),
                 ("_sindtz", c_double),
-                ("_tandtz", c_double)]
+                ("_tandtz", c_double),
+                ("_boundary_wrapped", c_uint)]
 
 class reb_simulation_integrator_ias15(Structure):
     """
@@ -140,10 +161,34 @@ class reb_simulation_integrator_ias15(Structure):
     
     :ivar float epsilon_global:          
         Determines how the adaptive timestep is chosen. 
+    
+    :ivar int block_levels:          
+        If larger than 1, every particle gets its own timestep dt/2**level 
+        with level < block_levels (block timesteps). Default is 0.
+
+    :ivar float pc_tolerance:          
+        The predictor corrector loop stops once the last correction is 
+        smaller than max(pc_tolerance, pc_tolerance_epsilon*epsilon). Default is 1e-16.
+    
+    :ivar float pc_tolerance_epsilon:          
+        Convergence criterion of the predictor corrector loop relative to epsilon. Default is 0.
+    
+    :ivar int pc_iterations_max:          
+        Maximum number of predictor corrector iterations. Default is 12.
+    
+    :ivar list iterations_histogram:          
+        Element i counts the predictor corrector loops that needed i iterations 
+        (the last element counts 15 or more). Each iteration costs 7 force evaluations.
+        Not stored in binary files.
     """
     _fields_ = [("epsilon", c_double),
                 ("min_dt", c_double),
                 ("epsilon_global", c_uint),
+                ("block_levels", c_uint),
+                ("pc_tolerance", c_double),
+                ("pc_tolerance_epsilon", c_double),
+                ("pc_iterations_max", c_uint),
+                ("iterations_histogram", c_ulong*16),
                 ("_iterations_max_exceeded", c_ulong),
                 ("_allocatedN", c_int),
                 ("_at", POINTER(c_double)),
@@ -161,6 +206,9 @@ class reb_simulation_integrator_ias15(Structure):
                 ("_er", reb_dp7),
                 ("_map", POINTER(c_int)),
                 ("_map_allocated_n", c_int),
+                ("_block", c_void_p),
+                ("_activeN", c_int),
+                ("_active_map", POINTER(c_int)),
                 ]
 
 class reb_simulation_integrator_saba(Structure):
@@ -267,6 +315,24 @@ class reb_simulation_integrator_whfast(Structure):
         If you set safe_mode to 0, the speed and accuracy of WHFast improve.
         However, make sure you are aware of the consequences. Read the iPython tutorial
         on advanced WHFast usage to learn more.
+    :ivar int compensated:
+        If compensated is 1 (default 0), the simulation time and the 
+        position and velocity updates of the Kepler and interaction steps 
+        use compensated summation. This reduces round-off errors in very long 
+        integrations. The compensation terms are discarded whenever the 
+        Jacobi/heliocentric coordinates are recalculated, so this is most 
+        useful together with safe_mode = 0.
+    :ivar int substeps_max:
+        Maximum number of substeps for test particles (default 0, no sub-cycling).
+        If larger than 1, test particles with small pericenter distances are 
+        sub-cycled with n = ceil(dt/(substeps_eta*T_q)) substeps, where T_q is 
+        the period of a circular orbit at the pericenter. The positions of the 
+        massive bodies are interpolated during the substeps. When enabled, all
+        test particles also receive the jump step. Only used with 
+        democratic heliocentric coordinates, safe_mode = 1, testparticle_type = 0
+        and BASIC gravity.
+    :ivar float substeps_eta:
+        Accuracy parameter for the test particle sub-cycling (default 0.05).
     """
     _fields_ = [("corrector", c_uint),
                 ("corrector2", c_uint),
@@ -277,10 +343,21 @@ class reb_simulation_integrator_whfast(Structure):
                 ("_p_jh", POINTER(Particle)),
                 ("_p_temp", POINTER(Particle)),
                 ("keep_unsynchronized", c_uint),
+                ("compensated", c_uint),
+                ("substeps_max", c_uint),
+                ("substeps_eta", c_double),
                 ("is_synchronized", c_uint),
                 ("_allocatedN", c_uint),
+                ("_allocatedNtemp", c_uint),
                 ("_timestep_warning", c_uint),
-                ("_recalculate_coordinates_but_not_synchronized_warning", c_uint)]
+                ("_recalculate_coordinates_but_not_synchronized_warning", c_uint),
+                ("_allocatedN_cs", c_uint),
+                ("_p_jh_cs", POINTER(c_double)),
+                ("_t_cs", c_double),
+                ("_t_last", c_double),
+                ("_allocatedN_substeps", c_uint),
+                ("_substeps", POINTER(c_uint)),
+                ("_substeps_planets", POINTER(c_double))]
     @property
     def coordinates(self):
         """
@@ -452,6 +529,13 @@ class Simulation(Structure):
     
     >>> sim = rebound.Simulation(filename="archive.bin", snapshot=34)
 
+    A simulation can also be sent through a pipe or socket without
+    a temporary file. The fd argument accepts a file descriptor or 
+    any object with a fileno() method.
+
+    >>> sim.save_to_fd(sock)
+    >>> sim_copy = rebound.Simulation(fd=sock)
+
     """
     def __new__(cls, *args, **kw):
         # Handle arguments
@@ -467,7 +551,24 @@ class Simulation(Structure):
             snapshot = kw["snapshot"]
        
         # Create simulation
-        if filename==None:
+        if "fd" in kw and kw["fd"] is not None:
+            # Read a binary from a file descriptor
+            fd = kw["fd"]
+            if hasattr(fd, "fileno"):
+                fd = fd.fileno()
+            sim = super(Simulation,cls).__new__(cls)
+            clibrebound.reb_init_simulation(byref(sim))
+            w = c_int(0)
+            clibrebound.reb_create_simulation_from_fd_with_messages(byref(sim),c_int(fd),byref(w))
+            for majorerror, value, message in BINARY_WARNINGS:
+                if w.value & value:
+                    if majorerror:
+                        raise RuntimeError(message)
+                    else:  
+                        # Just a warning
+                        warnings.warn(message, RuntimeWarning)
+            return sim
+        elif filename==None:
             # Create a new simulation
             sim = super(Simulation,cls).__new__(cls)
             clibrebound.reb_init_simulation(byref(sim))
@@ -488,7 +589,7 @@ class Simulation(Structure):
                         warnings.warn(message, RuntimeWarning)
             return sim
 
-    def __init__(self,filename=None,snapshot=None):
+    def __init__(self,filename=None,snapshot=None,fd=None):
         self.save_messages = 1 # Warnings will be checked within python
     
     @classmethod
@@ -623,6 +724,20 @@ class Simulation(Structure):
         >>> sim = sa[0]   # get the first snapshot in the SA file (initial conditions)
         >>> sim = sa[-1]  # get the last snapshot in the SA file
 
+        For large archives, set sim.simulationarchive_index = 1 before the first
+        snapshot. REBOUND then writes an index file (filename + ".idx") which
+        lets the SimulationArchive be opened without scanning all snapshots.
+
+        Set sim.simulationarchive_async = 1 to write snapshots on a background 
+        thread. The integration then only waits for the disk if snapshots are 
+        taken faster than they can be written. Pending snapshots are written at
+        the end of integrate() or when calling simulationarchive_flush().
+
+        Set sim.simulationarchive_compress = 1 to store compressed snapshots.
+        Each snapshot is delta encoded against the previous one and compressed.
+        Every 8th snapshot is encoded against the initial binary again, so reading
+        a snapshot requires decompressing at most 8 snapshots.
+
         """
         modes = sum(1 for i in [interval, walltime,step] if i != None)
         if modes != 1:
@@ -657,6 +772,14 @@ class Simulation(Structure):
         clibrebound.reb_simulationarchive_snapshot(byref(self), c_char_p(filename.encode("ascii")))
         self.process_messages()
 
+    def simulationarchive_flush(self):
+        """
+        Waits until all pending SimulationArchive snapshots have been written to disk.
+        Only needed if sim.simulationarchive_async is set and the SimulationArchive
+        is read before integrate() returns, e.g. after calling simulationarchive_snapshot().
+        """
+        clibrebound.reb_simulationarchive_flush(byref(self))
+
     @property
     def simulationarchive_filename(self):
         """
@@ -1261,6 +1384,67 @@ class Simulation(Structure):
 
         clibrebound.reb_tools_calculate_lyapunov.restype = c_double
         return clibrebound.reb_tools_calculate_lyapunov(byref(self))
+
+# Lyapunov spectrum
+    def init_lyapunov_spectrum(self, N=None, interval=0., seed=None):
+        """
+        This function initialises the variational particles needed to calculate the Lyapunov spectrum.
+
+        N sets of first order variational particles are added and integrated alongside the 
+        simulation. After every interval (in code units), the vectors are reorthonormalized with 
+        a QR decomposition and the logarithms of the diagonal of R are accumulated. 
+        Call this function after all particles have been added.
+
+        Parameters
+        ----------
+        N : int, optional
+            Number of Lyapunov exponents. Default is the full spectrum, six times the number of particles.
+        interval : float, optional
+            Time between reorthonormalizations. If 0 (default), the vectors are reorthonormalized after every timestep.
+        seed : int, optional
+            Seed for the random initial vectors.
+        """
+        if N is None:
+            N = 6*(self.N-self.N_var)
+        if seed is None:
+            clibrebound.reb_tools_lyapunov_spectrum_init(byref(self), c_int(N), c_double(interval))
+        else:
+            clibrebound.reb_tools_lyapunov_spectrum_init_seed(byref(self), c_int(N), c_double(interval), c_uint(seed))
+        self.process_messages()
+
+    def calculate_lyapunov_spectrum(self):
+        """
+        Return the Lyapunov spectrum as a list, sorted from the largest to the smallest exponent.
+        The exponents are calculated at the time of the last reorthonormalization.
+        Note that you need to call init_lyapunov_spectrum() before the start of the simulation.
+        """
+        N = self._lyapunov_spectrum_N
+        if N==0:
+            raise RuntimeError("Lyapunov spectrum cannot be calculated. Make sure to call init_lyapunov_spectrum() after adding all particles but before integrating the simulation.")
+        lyapunov = (c_double*N)()
+        clibrebound.reb_tools_calculate_lyapunov_spectrum(byref(self), lyapunov)
+        return list(lyapunov)
+
+    def mixed_precision_report(self):
+        """
+        Measure the accuracy of the mixed precision force calculation (see gravity_mixed_precision)
+        for the current snapshot. The accelerations are calculated once with single precision test 
+        particle and far field forces and once in double precision. The relative errors of the 
+        acceleration vectors are returned as a reb_mixed_precision_report. The simulation is not changed.
+
+        Examples
+        --------
+        >>> sim = rebound.Simulation()
+        >>> sim.add(m=1.)
+        >>> sim.add(m=1e-3, a=1.)
+        >>> sim.N_active = 2
+        >>> sim.add(a=2.)
+        >>> report = sim.mixed_precision_report()
+        >>> report.max_error < 1e-5
+        True
+        """
+        clibrebound.reb_tools_mixed_precision_report.restype = reb_mixed_precision_report
+        return clibrebound.reb_tools_mixed_precision_report(byref(self))
     
 # Particle add function, used to be called particle_add() and add_particle() 
     def add(self, particle=None, **kwargs):   
@@ -1661,6 +1845,71 @@ class Simulation(Structure):
         """
         clibrebound.reb_output_binary(byref(self), c_char_p(filename.encode("ascii")))
 
+    def save_to_fd(self, fd):
+        """
+        Write the entire REBOUND simulation as a binary to a file descriptor.
+
+        The data is the same as in a file written by save(). It is written
+        in one pass without a temporary file. fd can be a file descriptor or 
+        any object with a fileno() method, for example a socket or the 
+        result of os.pipe(). Read the simulation back with
+        rebound.Simulation(fd=fd). Several simulations can be sent 
+        through the same file descriptor.
+        """
+        if hasattr(fd, "fileno"):
+            fd = fd.fileno()
+        clibrebound.reb_output_binary_to_fd.restype = c_int
+        if clibrebound.reb_output_binary_to_fd(byref(self), c_int(fd)):
+            raise RuntimeError("Cannot write simulation to file descriptor.")
+
+    def output_trajectory(self, filename, positions=True, velocities=True, orbits=False):
+        """
+        Append the current state of all particles to a columnar trajectory file.
+
+        Trajectory files are meant for post-processing and can be read with 
+        rebound.Trajectory. They cannot be used to restart a simulation.
+        Snapshots are buffered in memory and written in chunks. Call 
+        output_trajectory_flush() before reading a file that is still 
+        being written to.
+
+        Arguments
+        ---------
+        filename : str
+            Filename of the trajectory file. 
+        positions : bool
+            Store x, y, z (default: True).
+        velocities : bool
+            Store vx, vy, vz (default: True).
+        orbits : bool
+            Store a, e, inc, Omega, omega, l in Jacobi coordinates (default: False).
+
+        Examples
+        --------
+
+        >>> for t in np.linspace(0., 100., 1000):
+        >>>     sim.integrate(t)
+        >>>     sim.output_trajectory("trajectory.bin")
+        >>> sim.output_trajectory_flush()
+        >>> tr = rebound.Trajectory("trajectory.bin")
+        >>> t, x = tr.get("x", particles=[1,2])
+        """
+        fields = 0
+        if positions:
+            fields |= TRAJECTORY_FIELDS["positions"]
+        if velocities:
+            fields |= TRAJECTORY_FIELDS["velocities"]
+        if orbits:
+            fields |= TRAJECTORY_FIELDS["orbits"]
+        clibrebound.reb_output_trajectory(byref(self), c_char_p(filename.encode("ascii")), c_int(fields))
+        self.process_messages()
+
+    def output_trajectory_flush(self):
+        """
+        Write all buffered snapshots of output_trajectory() to the file.
+        """
+        clibrebound.reb_output_trajectory_flush(byref(self))
+        self.process_messages()
+
 # Integration
     def step(self):
         """
@@ -2024,9 +2273,12 @@ Simulation._fields_ = [
                 ("_particles", POINTER(Particle)),
                 ("gravity_cs", POINTER(reb_vec3d)),
                 ("gravity_cs_allocatedN", c_int),
+                ("_gravity_mixed_sources", POINTER(c_double)),
+                ("_gravity_mixed_sources_allocatedN", c_int),
                 ("_tree_root", c_void_p),
                 ("_tree_needs_update", c_int),
                 ("opening_angle2", c_double),
+                ("gravity_mixed_precision", c_uint),
                 ("_status", c_int),
                 ("exact_finish_time", c_int),
                 ("force_is_velocity_dependent", c_uint),
@@ -2070,6 +2322,12 @@ Simulation._fields_ = [
                 ("_megno_mean_t", c_double),
                 ("_megno_mean_Y", c_double),
                 ("_megno_n", c_long),
+                ("_lyapunov_spectrum_N", c_int),
+                ("_lyapunov_spectrum_var_config", c_int),
+                ("lyapunov_spectrum_interval", c_double),
+                ("_lyapunov_spectrum_t0", c_double),
+                ("_lyapunov_spectrum_t_last", c_double),
+                ("_lyapunov_spectrum_sums", POINTER(c_double)),
                 ("simulationarchive_version", c_int),
                 ("simulationarchive_size_first", c_long),
                 ("simulationarchive_size_snapshot", c_long),
@@ -2079,6 +2337,11 @@ Simulation._fields_ = [
                 ("simulationarchive_next", c_double),
                 ("simulationarchive_next_step", c_ulonglong),
                 ("_simulationarchive_filename", c_char_p),
+                ("simulationarchive_index", c_int),
+                ("simulationarchive_async", c_int),
+                ("simulationarchive_compress", c_int),
+                ("_simulationarchive_writer", c_void_p),
+                ("_trajectory_writer", c_void_p),
                 ("_visualization", c_int),
                 ("_collision", c_int),
                 ("_integrator", c_int),
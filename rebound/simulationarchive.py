@@ -1,6 +1,6 @@
-from ctypes import Structure, c_double, POINTER, c_float, c_int, c_uint, c_uint32, c_int64, c_long, c_ulong, c_ulonglong, c_void_p, c_char_p, CFUNCTYPE, byref, create_string_buffer, addressof, pointer, cast
+from ctypes import Structure, c_double, POINTER, c_float, c_int, c_uint, c_uint32, c_uint64, c_int64, c_long, c_ulong, c_ulonglong, c_void_p, c_char_p, CFUNCTYPE, byref, create_string_buffer, addressof, pointer, cast
 from .simulation import Simulation, BINARY_WARNINGS
-from . import clibrebound 
+from . import clibrebound, SimulationError
 import os
 import sys
 import math
@@ -54,8 +54,10 @@ class SimulationArchive(Structure):
                 ("auto_walltime", c_double), 
                 ("auto_step", c_ulonglong), 
                 ("nblobs", c_long), 
-                ("offset", POINTER(c_uint32)), 
-                ("t", POINTER(c_double)) 
+                ("offset", POINTER(c_uint64)), 
+                ("t", POINTER(c_double)), 
+                ("_map", c_void_p), 
+                ("_map_size", c_uint64) 
                 ]
     def __init__(self,filename,setup=None, setup_args=(), process_warnings=True):
         """
@@ -132,6 +134,72 @@ class SimulationArchive(Structure):
                     warnings.warn(message, RuntimeWarning)
         return sim
     
+    def serialize_particle_data(self, key, **kwargs):
+        """
+        Fast way to access the particle data of a snapshot via numpy arrays.
+
+        This function uses the same syntax as Simulation.serialize_particle_data()
+        but does not create a Simulation object. The particle data is copied 
+        directly from the memory-mapped SimulationArchive file. This is 
+        significantly faster when only particle data is needed, for example 
+        when analyzing many snapshots. For WHFast or MERCURIUS with safe_mode 
+        turned off, the stored particle data is not synchronized.
+
+        Arguments
+        ---------
+        key : int
+            Index of the snapshot.
+
+        Returns
+        -------
+        The number of particles in the snapshot.
+
+        Examples
+        --------
+        
+        >>> sa = rebound.SimulationArchive("archive.bin")
+        >>> xyz = np.zeros((sa.particles_N(-1),3),dtype="float64")
+        >>> sa.serialize_particle_data(-1, xyz=xyz)
+
+        """
+        N = self.particles_N(key)
+        possible_keys = ["hash","m","r","xyz","vxvyvz","xyzvxvyvz"]
+        d = {x:None for x in possible_keys}
+        for k,v in kwargs.items():
+            if k in d:
+                if k == "hash":
+                    if v.dtype!= "uint32":
+                        raise AttributeError("Expected 'uint32' data type for '%s' array."%k)
+                    if v.size<N:
+                        raise AttributeError("Array '%s' is not large enough."%k)
+                    d[k] = v.ctypes.data_as(POINTER(c_uint32))
+                else:
+                    if v.dtype!= "float64":
+                        raise AttributeError("Expected 'float64' data type for %s array."%k)
+                    if k in ["xyz", "vxvyvz"]:
+                        minsize = 3*N
+                    elif k in ["xyzvxvyvz"]:
+                        minsize = 6*N
+                    else:
+                        minsize = N
+                    if v.size<minsize:
+                        raise AttributeError("Array '%s' is not large enough."%k)
+                    d[k] = v.ctypes.data_as(POINTER(c_double))
+            else:
+                raise AttributeError("Only '%s' are currently supported attributes for serialization." % "', '".join(d.keys()))
+        clibrebound.reb_simulationarchive_serialize_particle_data.restype = c_long
+        return clibrebound.reb_simulationarchive_serialize_particle_data(byref(self), c_long(key), d["hash"], d["m"], d["r"], d["xyz"], d["vxvyvz"], d["xyzvxvyvz"])
+
+    def particles_N(self, key):
+        """
+        Returns the number of particles in a snapshot without creating a Simulation object.
+        """
+        clibrebound.reb_simulationarchive_serialize_particle_data.restype = c_long
+        N = clibrebound.reb_simulationarchive_serialize_particle_data(byref(self), c_long(key), None, None, None, None, None, None)
+        if N<0:
+            raise IndexError("Cannot read snapshot %d."%key)
+        return N
+
     def __setitem__(self, key, value):
         raise AttributeError("Cannot modify SimulationArchive.")
 
@@ -239,10 +307,104 @@ class SimulationArchive(Structure):
         """
         A generator to quickly access many simulations. 
         The arguments are the same as for `getSimulation`.
+        If only particle data is needed, `getParticleData` is faster.
         """
         for t in times:
             yield self.getSimulation(t, **kwargs)
 
+    def getParticleData(self, times, mode='close', keep_unsynchronized=1, threads=0):
+        """
+        Returns the positions and velocities of all particles at many times.
+
+        This is a faster alternative to calling `getSimulation` for every time.
+        Times which share the same preceding snapshot are grouped together.
+        For each group a simulation is created only once and then integrated
+        from one requested time to the next. The groups are integrated in 
+        parallel by C threads. The GIL is released during the integration.
+        The number of particles needs to be the same in all snapshots.
+
+        If a `setup` function was given when opening the SimulationArchive,
+        the groups are integrated sequentially in Python so that `setup`
+        can restore function pointers and additional forces.
+
+        Arguments
+        ---------
+        times : array of floats
+            Requested times. Need to be within tmin and tmax of this Simulation Archive.
+        mode : str
+            'snapshot', 'close' (default), or 'exact'. See `getSimulation`. In 'close'
+            mode the results are bitwise identical to those of `getSimulation`, except 
+            for EOS and MERCURIUS with safe_mode=0 which are synchronized at every 
+            requested time. In 'exact' mode they agree to the accuracy of the integrator.
+        keep_unsynchronized : int
+            See `getSimulation`. Ignored in 'close' and 'exact' mode. The particle data 
+            is synchronized in any case.
+        threads : int
+            Number of threads. By default the number of available processors is used.
+
+        Returns
+        ------- 
+        A tuple (t, xyzvxvyvz) of numpy arrays. t has the shape (len(times),) and 
+        contains the simulation times reached. xyzvxvyvz has the shape (len(times), N, 6)
+        and contains the positions and velocities of all particles.
+
+        Examples
+        --------
+
+        >>> sa = rebound.SimulationArchive("archive.bin")
+        >>> times = np.linspace(sa.tmin, sa.tmax, 10000)
+        >>> t, xyzvxvyvz = sa.getParticleData(times, mode="exact")
+        >>> x1 = xyzvxvyvz[:,1,0]
+
+        """
+        import numpy as np
+        modes = ['snapshot', 'close', 'exact']
+        if mode not in modes:
+            raise AttributeError("Unknown mode.")
+        times = np.ascontiguousarray(times, dtype="float64").reshape(-1)
+        if len(times) and (times.min()<self.tmin or times.max()>self.tmax):
+            raise ValueError("Requested time outside of baseline stored in binary file.")
+        order = np.argsort(times, kind="stable")
+        times_sorted = np.ascontiguousarray(times[order])
+        N = self.particles_N(self._getSnapshotIndex(times_sorted[0])[0]) if len(times) else 0
+        t = np.zeros(len(times), dtype="float64")
+        xyzvxvyvz = np.zeros((len(times), N, 6), dtype="float64")
+
+        if self.setup:
+            exact_finish_time = 1 if mode=='exact' else 0
+            sim, bi_last = None, None
+            for i, ti in enumerate(times_sorted):
+                bi, bt = self._getSnapshotIndex(ti)
+                if bi!=bi_last:
+                    # Continuing from the unsynchronized state is identical to integrating from the snapshot
+                    sim = self.getSimulation(ti, mode=mode, keep_unsynchronized=1 if mode=='close' else keep_unsynchronized)
+                    bi_last = bi
+                elif mode!='snapshot':
+                    sim.integrate(ti, exact_finish_time=exact_finish_time)
+                if sim.N-sim.N_var!=N:
+                    raise RuntimeError("The number of particles is not the same in all snapshots.")
+                t[i] = sim.t
+                sim.serialize_particle_data(xyzvxvyvz=xyzvxvyvz[i])
+        else:
+            clibrebound.reb_simulationarchive_integrate_times.restype = c_int
+            ret = clibrebound.reb_simulationarchive_integrate_times(byref(self), 
+                    times_sorted.ctypes.data_as(POINTER(c_double)), c_long(len(times)), 
+                    c_int(modes.index(mode)), c_int(keep_unsynchronized), c_int(threads), c_long(N), 
+                    t.ctypes.data_as(POINTER(c_double)), xyzvxvyvz.ctypes.data_as(POINTER(c_double)))
+            if ret==-1:
+                raise RuntimeError("Cannot read snapshot.")
+            if ret==-2:
+                raise RuntimeError("The number of particles is not the same in all snapshots.")
+            if ret!=0:
+                raise SimulationError("The integration did not finish successfully (status %d)."%ret)
+
+        # Restore the order of the requested times
+        t_out = np.empty_like(t)
+        t_out[order] = t
+        xyzvxvyvz_out = np.empty_like(xyzvxvyvz)
+        xyzvxvyvz_out[order] = xyzvxvyvz
+        return t_out, xyzvxvyvz_out
+
     
     def getBezierPaths(self,origin=None):
         """
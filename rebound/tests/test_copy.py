@@ -49,6 +49,138 @@ class TestCopy(unittest.TestCase):
             self.assertNotEqual(sim.particles[i].vy,sim_copy.particles[i].vy)
             self.assertNotEqual(sim.particles[i].vz,sim_copy.particles[i].vz)
 
+    def test_copy_equal(self):
+        for integrator in ["ias15", "whfast", "mercurius", "janus", "saba", "leapfrog"]:
+            sim = rebound.Simulation()
+            sim.add(m=1)
+            sim.add(m=1e-3,a=1,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+            sim.add(m=1e-3,a=2,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+            sim.integrator = integrator
+            sim.dt = 0.01
+            sim.integrate(1.)
+            sim_copy = sim.copy()
+            self.assertTrue(sim==sim_copy)
+            sim_copy.integrate(2.)
+            sim.integrate(2.)
+            self.assertTrue(sim==sim_copy)
+
+    def test_copy_does_not_modify_source(self):
+        sim = rebound.Simulation()
+        sim.integrator = "sei"
+        sim.ri_sei.OMEGA = 1.
+        sim.add(m=1e-3,x=1.)
+        sim.dt = 0.01
+        before = bytes(sim.ri_sei)
+        sim_copy = sim.copy()
+        self.assertEqual(before, bytes(sim.ri_sei))
+        # The copy is initialized as before
+        self.assertEqual(sim_copy.ri_sei._lastdt, sim.dt)
+        self.assertEqual(sim_copy.ri_sei.OMEGAZ, 1.)
+        sim_copy.integrate(1.)
+        sim.integrate(1.)
+        self.assertEqual(sim.particles[0].x, sim_copy.particles[0].x)
+
+    def test_fd(self):
+        import os
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+        sim.integrator = "ias15"
+        sim.integrate(1.)
+        r, w = os.pipe()
+        sim.save_to_fd(w)
+        sim.integrate(2.)
+        sim.save_to_fd(w)
+        os.close(w)
+        sim1 = rebound.Simulation(fd=r)
+        sim2 = rebound.Simulation(fd=r)
+        self.assertEqual(sim1.t, 1.)
+        self.assertTrue(sim==sim2)
+        with self.assertRaises(RuntimeError):
+            rebound.Simulation(fd=r)
+        os.close(r)
+        sim1.integrate(2.)
+        self.assertEqual(sim.particles[1].x, sim1.particles[1].x)
+        
+        # Corrupt field size
+        import struct
+        r, w = os.pipe()
+        sim.save_to_fd(w)
+        os.close(w)
+        header = os.read(r, 64)
+        os.close(r)
+        r, w = os.pipe()
+        os.write(w, header + struct.pack("<IxxxxQ", 0, 2**63))
+        os.close(w)
+        with self.assertRaises(RuntimeError):
+            rebound.Simulation(fd=r)
+        os.close(r)
+        
+        # Objects with a fileno() method
+        a, b = socket.socketpair()
+        sim.save_to_fd(a)
+        sim3 = rebound.Simulation(fd=b)
+        a.close()
+        b.close()
+        self.assertTrue(sim==sim3)
+
+    def test_diff_particles_delta(self):
+        import os
+        from ctypes import c_int, c_size_t, byref, sizeof, create_string_buffer
+        def binary(sim):
+            r, w = os.pipe()
+            sim.save_to_fd(w)
+            os.close(w)
+            buf = b""
+            while True:
+                chunk = os.read(r, 65536)
+                if not chunk:
+                    break
+                buf += chunk
+            os.close(r)
+            return buf
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        for i in range(20):
+            sim.add(m=1e-6,a=1.+0.1*i,e=0.1,f=i)
+        buf1 = binary(sim)
+        sim.particles[5].x += 1.
+        buf2 = binary(sim)
+        
+        diff = rebound.clibrebound.reb_binary_diff_to_buffer
+        diff.restype = c_int
+        size = c_size_t()
+        self.assertEqual(diff(buf1, c_size_t(len(buf1)), buf2, c_size_t(len(buf2)), None, c_size_t(0), byref(size), c_int(1)), -1)
+        out = create_string_buffer(size.value)
+        self.assertEqual(diff(buf1, c_size_t(len(buf1)), buf2, c_size_t(len(buf2)), out, c_size_t(len(out)), byref(size), c_int(1)), 1)
+        # Only contains the particle which changed
+        self.assertLess(size.value, 2*sizeof(rebound.Particle))
+        
+        # Apply the diff the same way the SimulationArchive does (before END field and blob)
+        import struct, warnings
+        end = buf1.rindex(struct.pack("<IxxxxQ", 9999, 0)) # END field header
+        r, w = os.pipe()
+        os.write(w, buf1[:end] + out.raw[:size.value] + buf1[end:])
+        os.close(w)
+        sim1 = rebound.Simulation(fd=r)
+        os.close(r)
+        self.assertTrue(sim==sim1)
+        self.assertEqual(sim.particles[5].x, sim1.particles[5].x)
+
+        # Indices beyond N are rejected even if memory for them is allocated
+        p = bytes(sim.particles[5])
+        fields = struct.pack("<IxxxxQi", 4, 4, sim.N-1)
+        fields += struct.pack("<IxxxxQI", 174, 4+len(p), sim.N-1) + p
+        r, w = os.pipe()
+        os.write(w, buf1[:end] + fields + buf1[end:])
+        os.close(w)
+        with warnings.catch_warnings(record=True) as w:
+            warnings.simplefilter("always")
+            sim2 = rebound.Simulation(fd=r)
+            self.assertEqual(1, len(w))
+        os.close(r)
+        self.assertEqual(sim2.N, sim.N-1)
+
 class TestMultiply(unittest.TestCase):
     def test_multiply_with_minus_one(self):
         sim1 = rebound.Simulation()
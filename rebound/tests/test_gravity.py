@@ -90,6 +90,67 @@ class TestGravity(unittest.TestCase):
         x1ias = sim.particles[1].x
         self.assertAlmostEqual(x1ias, x1,delta=1e-9)
 
+    def test_mixed_precision_testparticles(self):
+        for testparticle_type in [0, 1]:
+            sims = []
+            for mixed_precision in [0, 1]:
+                sim = rebound.Simulation()
+                sim.testparticle_type = testparticle_type
+                sim.add(m=1.)
+                sim.add(m=1e-3, a=1.)
+                sim.add(m=1e-3, a=1.6)
+                sim.N_active = 3
+                for i in range(20):
+                    sim.add(m=1e-9, a=2.+0.1*i, e=0.1, f=i)
+                sim.gravity_mixed_precision = mixed_precision
+                sim.integrator = "whfast"
+                sim.dt = 0.01
+                sims.append(sim)
+            report = sims[1].mixed_precision_report()
+            self.assertEqual(report.N, 23)
+            self.assertGreater(report.max_error, 0.)
+            self.assertLess(report.max_error, 1e-6)
+            self.assertLessEqual(report.rms_error, report.max_error)
+            # The report does not change the simulation
+            self.assertEqual(sims[1].gravity_mixed_precision, 1)
+            for sim in sims:
+                sim.integrate(10.)
+            for p0, p1 in zip(sims[0].particles, sims[1].particles):
+                self.assertAlmostEqual(p0.x, p1.x, delta=1e-5)
+                self.assertAlmostEqual(p0.vy, p1.vy, delta=1e-5)
+    
+    def test_mixed_precision_variational(self):
+        sims = []
+        for mixed_precision in [0, 1]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=1.)
+            sim.N_active = 2
+            for i in range(5):
+                sim.add(a=2.+0.1*i, e=0.1, f=i)
+            sim.gravity_mixed_precision = mixed_precision
+            sim.integrator = "whfast"
+            sim.dt = 0.01
+            sim.init_megno()
+            sim.integrate(1.)
+            sims.append(sim)
+        # Test particle forces are calculated in single precision also with variational particles
+        self.assertNotEqual(sims[0].particles[3].x, sims[1].particles[3].x)
+        self.assertAlmostEqual(sims[0].particles[3].x, sims[1].particles[3].x, delta=1e-5)
+
+    def test_mixed_precision_tree(self):
+        sim = rebound.Simulation()
+        sim.configure_box(10.)
+        sim.gravity = "tree"
+        np.random.seed(1)
+        for i in range(200):
+            x, y, z = np.random.uniform(-4., 4., 3)
+            sim.add(m=1e-3, x=x, y=y, z=z)
+        report = sim.mixed_precision_report()
+        self.assertEqual(report.N, 200)
+        self.assertGreater(report.max_error, 0.)
+        self.assertLess(report.max_error, 1e-5)
+
 
 if __name__ == "__main__":
     unittest.main()
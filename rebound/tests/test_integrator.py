@@ -67,6 +67,75 @@ class TestIntegrator2(unittest.TestCase):
         x1 = sim.calculate_energy()
         self.assertAlmostEqual(x0, x1, delta=1e-14)
 
+    def test_whfast_compensated_summation(self):
+        errors = []
+        for compensated in [0, 1]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=1., e=0.1)
+            sim.integrator = "whfast"
+            sim.ri_whfast.safe_mode = 0
+            sim.ri_whfast.compensated = compensated
+            sim.dt = 0.0123
+            e0 = sim.calculate_energy()
+            N = 400000
+            sim.integrate(N*sim.dt, exact_finish_time=0)
+            sim.integrator_synchronize()
+            e1 = sim.calculate_energy()
+            errors.append(math.fabs((e0-e1)/e1))
+            if compensated:
+                # Time is accumulated without round-off error
+                self.assertEqual(sim.t, N*0.0123)
+        self.assertLess(errors[1], 1e-14)
+        self.assertLess(errors[1], 0.1*errors[0])
+
+    def test_whfast_compensated_restart(self):
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1e-3, a=1., e=0.1)
+        sim.add(m=1e-3, a=1.7, e=0.1)
+        sim.integrator = "whfast"
+        sim.ri_whfast.safe_mode = 0
+        sim.ri_whfast.compensated = 1
+        sim.dt = 0.0123
+        sim.integrate(10., exact_finish_time=0)
+        sim2 = sim.copy()
+        sim.integrate(20., exact_finish_time=0)
+        sim2.integrate(20., exact_finish_time=0)
+        self.assertEqual(sim.t, sim2.t)
+        self.assertEqual(sim.particles[1].x, sim2.particles[1].x)
+        self.assertEqual(sim.particles[2].vy, sim2.particles[2].vy)
+
+    def test_whfast_substeps(self):
+        def setup():
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=5.2, e=0.05)
+            sim.add(m=3e-4, a=9.5, e=0.05, inc=0.02)
+            sim.N_active = 3
+            sim.add(a=3., e=0.95, inc=0.3, omega=1.)
+            sim.add(a=7., e=0.2, f=1.)
+            sim.move_to_com()
+            return sim
+        errors = []
+        for substeps_max in [0, 64]:
+            sim = setup()
+            sim.integrator = "whfast"
+            sim.ri_whfast.coordinates = "democraticheliocentric"
+            sim.ri_whfast.substeps_max = substeps_max
+            sim.dt = 1.2
+            for i in range(250):
+                sim.step()
+            ref = setup()
+            ref.integrator = "ias15"
+            ref.integrate(sim.t)
+            errors.append([])
+            for i in [3,4]:
+                d = sim.particles[i]-ref.particles[i]
+                errors[-1].append(math.sqrt(d.x*d.x+d.y*d.y+d.z*d.z))
+        self.assertLess(errors[1][0], 0.1*errors[0][0])
+        self.assertLess(errors[1][1], 0.1*errors[0][1])
+
 
 class TestIntegrator(unittest.TestCase):
     def setUp(self):
@@ -121,7 +190,72 @@ class TestIntegrator(unittest.TestCase):
         self.sim.integrate(1e3*jupyr)
         e1 = self.sim.calculate_energy()
         self.assertLess(math.fabs((e0-e1)/e1),1e-14)
-    
+
+    def test_ias15_pc_tolerance(self):
+        iterations = []
+        for pc_tolerance_epsilon in [0., 1e-3]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=1., e=0.1)
+            sim.add(m=1e-3, a=2., e=0.2)
+            sim.ri_ias15.pc_tolerance_epsilon = pc_tolerance_epsilon
+            e0 = sim.calculate_energy()
+            sim.integrate(100.)
+            e1 = sim.calculate_energy()
+            self.assertLess(math.fabs((e0-e1)/e1),1e-14)
+            histogram = list(sim.ri_ias15.iterations_histogram)
+            self.assertEqual(histogram[0], 0)
+            iterations.append(sum(i*n for i, n in enumerate(histogram))/sum(histogram))
+        self.assertLess(iterations[1], iterations[0])
+
+    def test_ias15_iterations_histogram_not_compared(self):
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1e-3, a=1., e=0.1)
+        sim.integrate(10.)
+        self.assertGreater(sum(sim.ri_ias15.iterations_histogram), 0)
+        sim2 = sim.copy()
+        for i in range(16):
+            sim2.ri_ias15.iterations_histogram[i] = 0
+        self.assertEqual(sim, sim2)
+
+    def test_ias15_block_levels(self):
+        sims = []
+        for block_levels in [0, 12]:
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=1., e=0.05)
+            sim.add(m=1e-6, a=0.01, e=0.01, primary=sim.particles[1])
+            sim.add(m=3e-4, a=3., e=0.05, inc=0.02)
+            for i in range(20):
+                sim.add(a=12.+i*0.05, e=0.1, f=i)
+            sim.move_to_com()
+            sim.N_active = 4
+            sim.ri_ias15.block_levels = block_levels
+            sim.ri_ias15.epsilon = 1e-9
+            sim.dt = 0.01
+            e0 = sim.calculate_energy()
+            sim.integrate(10.)
+            e1 = sim.calculate_energy()
+            self.assertLess(math.fabs((e0-e1)/e1),1e-9)
+            sims.append(sim)
+        # The outer particles are not limited by the moon's timestep
+        self.assertGreater(sims[1].dt, 10.*sims[0].dt)
+        for p0, p1 in zip(sims[0].particles, sims[1].particles):
+            self.assertAlmostEqual(p0.x, p1.x, delta=1e-6)
+
+    def test_ias15_block_levels_unsupported(self):
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        sim.add(m=1e-3, a=1.)
+        sim.gravity = "compensated"
+        sim.ri_ias15.block_levels = 8
+        with warnings.catch_warnings(record=True) as w:
+            warnings.simplefilter("always")
+            sim.integrate(1.)
+            self.assertEqual(1, len(w))
+        self.assertEqual(sim.ri_ias15.block_levels, 0)
+
     def test_whfast_largedt(self):
         self.sim.integrator = "whfast"
         jupyr = 11.86*2.*math.pi
@@ -64,6 +64,36 @@ class TestMegno(unittest.TestCase):
         self.sim.integrate(1000)
         self.megnoWHFast = self.sim.calculate_megno()
         self.assertAlmostEqual(abs((self.megnoIAS-self.megnoWHFast)/self.megnoIAS), 0., delta=0.2)
+    def test_lyapunov_spectrum(self):
+        self.sim.integrator = "whfast"
+        self.sim.add(m=1.)
+        self.sim.add(m=1.e-4, P=1.)
+        self.sim.add(m=1.e-4, P=1.17)
+        self.sim.move_to_com()
+        self.sim.dt = 0.01
+        self.sim.init_lyapunov_spectrum(interval=1., seed=0)
+        sim2 = self.sim.copy()
+        self.sim.integrate(1000.)
+        ls = self.sim.calculate_lyapunov_spectrum()
+        self.assertEqual(len(ls), 18)
+        # Chaotic, close to the value from renormalizing a single tangent vector (0.10)
+        self.assertAlmostEqual(ls[0], 0.1, delta=0.02)
+        # Phase space volume is conserved
+        self.assertAlmostEqual(sum(ls), 0., delta=1e-10)
+        sim2.integrate(1000.)
+        self.assertEqual(ls, sim2.calculate_lyapunov_spectrum())
+
+    def test_lyapunov_spectrum_regular(self):
+        self.sim.integrator = "ias15"
+        self.sim.add(m=1)
+        self.sim.add(m=1e-3,a=1.5,e=0.1,inc=0.1)
+        self.sim.add(m=1.e-3, a=15., e=0.1, inc=0.1)
+        self.sim.init_lyapunov_spectrum(N=3, interval=10., seed=0)
+        self.sim.integrate(10000.)
+        ls = self.sim.calculate_lyapunov_spectrum()
+        self.assertEqual(len(ls), 3)
+        for l in ls:
+            self.assertAlmostEqual(l, 0., delta=2e-3)
 
 if __name__ == "__main__":
     unittest.main()
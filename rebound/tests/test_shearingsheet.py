@@ -60,5 +60,25 @@ class TestShearingSheet(unittest.TestCase):
         with self.assertRaises(RuntimeError):
             sim.remove(0,keepSorted=1)
 
+    def test_boundary_wrap(self):
+        sim = rebound.Simulation()
+        OMEGA = 0.00013143527
+        sim.ri_sei.OMEGA = OMEGA
+        sim.dt = 1e-3*2.*np.pi/OMEGA
+        sim.configure_box(10.)
+        sim.integrator = "sei"
+        sim.boundary = "shear"
+        for i in range(100):
+            x = np.random.uniform(low=-5., high=5.)
+            sim.add(x=x, y=np.random.uniform(low=-5., high=5.), vx=0.01*np.random.normal(), vy=-1.5*x*OMEGA)
+        def move(simp):
+            # Moves a particle outside of the box after the integrator has wrapped all particles
+            simp.contents.particles[0].x += 30.
+        sim.post_timestep_modifications = move
+        sim.integrate(2.*np.pi/OMEGA)
+        for p in sim.particles:
+            self.assertLessEqual(abs(p.x), 5.)
+            self.assertLessEqual(abs(p.y), 5.)
+
 if __name__ == "__main__":
     unittest.main()
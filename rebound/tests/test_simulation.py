@@ -4,7 +4,7 @@ import unittest
 import os
 import math
 import sys
-from ctypes import c_uint32
+from ctypes import c_uint32, c_char_p, byref
 
 class TestSimulation(unittest.TestCase):
     def setUp(self):
@@ -248,6 +248,59 @@ class TestSimulation(unittest.TestCase):
         self.assertEqual(self.sim.integrator, sim2.integrator)
         os.remove("bintest.bin")
     
+    def test_output_ascii_format(self):
+        import random, struct
+        random.seed(1)
+        values = [0., -0., 1., -1., 0.5, 1e-15, 9.9999995e-16, 1e28, 9.999999e27, 1.5e300, -2.5e-300, 
+                5e-324, float("inf"), -float("inf"), float("nan"), 9999999.5, 0.99999995, 1.0000005]
+        # Exact ties which have to be rounded to even
+        for d in [12345665, 12345675, 10000005, 99999995, 99999985]:
+            for k in range(9):
+                values.append(d*10.**k)
+                values.append(-d*10.**k)
+        for n in range(1, 4000, 3):
+            values.append(n/2.**17)
+        for i in range(3000):
+            values.append(random.uniform(-1.,1.)*10.**random.randint(-20,30))
+            v = struct.unpack("<d", struct.pack("<Q", random.getrandbits(64)))[0]
+            if not math.isnan(v):
+                values.append(v)
+        while len(values)%6:
+            values.append(0.)
+        sim = rebound.Simulation()
+        for i in range(0, len(values), 6):
+            sim.add(x=values[i], y=values[i+1], z=values[i+2], vx=values[i+3], vy=values[i+4], vz=values[i+5])
+        filename = "test_output_ascii.txt"
+        if os.path.isfile(filename):
+            os.remove(filename)
+        rebound.clibrebound.reb_output_ascii(byref(sim), c_char_p(filename.encode("ascii")))
+        with open(filename) as f:
+            lines = f.read().split("\n")
+        os.remove(filename)
+        self.assertEqual(lines[-1], "")
+        self.assertEqual(len(lines)-1, sim.N)
+        for i in range(sim.N):
+            self.assertEqual(lines[i], "\t".join("%e"%v for v in values[6*i:6*i+6]))
+
+    def test_output_orbits_format(self):
+        sim = rebound.Simulation()
+        sim.t = 12345675.
+        sim.add(m=1.)
+        for i in range(100):
+            sim.add(m=1e-5, a=1.+0.1*i, e=0.01*(i%50), inc=0.01*i, f=i)
+        filename = "test_output_orbits.txt"
+        if os.path.isfile(filename):
+            os.remove(filename)
+        rebound.clibrebound.reb_output_orbits(byref(sim), c_char_p(filename.encode("ascii")))
+        with open(filename) as f:
+            lines = f.read().split("\n")
+        os.remove(filename)
+        orbits = sim.calculate_orbits()
+        self.assertEqual(len(lines)-1, len(orbits))
+        for line, o in zip(lines, orbits):
+            values = [sim.t, o.a, o.e, o.inc, o.Omega, o.omega, o.l, o.P, o.f]
+            self.assertEqual(line, "\t".join("%e"%v for v in values))
+
 class TestSimulationCollisions(unittest.TestCase):
     def setUp(self):
         self.sim = rebound.Simulation()
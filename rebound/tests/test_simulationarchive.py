@@ -299,9 +299,279 @@ class TestSimulationArchive(unittest.TestCase):
             warnings.simplefilter("always")
             sim.automateSimulationArchive("test.bin", 10.)
             sim.integrate(80.,exact_finish_time=0)
-            self.assertEqual(1, len(w)) 
+            self.assertEqual(1, len(w))
+
+    def test_sa_index(self):
+        import os
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+        sim.add(m=1e-3,a=-2,e=1.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+        sim.integrator = "whfast"
+        sim.dt = 0.1313
+        sim.simulationarchive_index = 1
+        sim.automateSimulationArchive("test.bin", 10.,deletefile=True)
+        sim.integrate(40.,exact_finish_time=0)
+        self.assertTrue(os.path.isfile("test.bin.idx"))
+        # Append snapshots without updating the index
+        sim.simulationarchive_index = 0
+        sim.integrate(80.,exact_finish_time=0)
+
+        sa = rebound.SimulationArchive("test.bin")
+        t_index = [sa.t[i] for i in range(len(sa))]
+        x_index = sa[5].particles[1].x
+        self.assertEqual(len(sa), 9)
+
+        os.remove("test.bin.idx")
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(t_index, [sa.t[i] for i in range(len(sa))])
+        self.assertEqual(x_index, sa[5].particles[1].x)
+
+        # Index from a different file is ignored
+        with open("test.bin.idx","wb") as f:
+            f.write(b"\x00"*48)
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(t_index, [sa.t[i] for i in range(len(sa))])
+
+    def test_sa_append_two_writers(self):
+        import os
+        if os.path.isfile("test.bin"):
+            os.remove("test.bin")
+        sims = []
+        for a in [1., 2.]:
+            sim = rebound.Simulation()
+            sim.add(m=1)
+            sim.add(m=1e-3,a=a)
+            sim.integrator = "whfast"
+            sim.dt = 0.1
+            sims.append(sim)
+        # Both simulations append to the same file. Each writer needs
+        # to notice that the file has been modified by the other one.
+        for i in range(5):
+            for sim in sims:
+                sim.step()
+                sim.simulationarchive_snapshot("test.bin")
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(len(sa), 10)
+        self.assertEqual(sa[-1].particles[1].x, sims[1].particles[1].x)
+        self.assertEqual(sa[-2].particles[1].x, sims[0].particles[1].x)
+        # A new file is started if the old one has been deleted.
+        sims[0].simulationarchive_snapshot("test.bin", deletefile=True)
+        sims[0].step()
+        sims[0].simulationarchive_snapshot("test.bin")
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(len(sa), 2)
+        self.assertEqual(sa[-1].particles[1].x, sims[0].particles[1].x)
+
+    def test_sa_async(self):
+        import os
+        sas = []
+        for filename, async_ in [("test.bin", 0), ("test_async.bin", 1)]:
+            sim = rebound.Simulation()
+            sim.add(m=1)
+            sim.add(m=1e-3,a=1,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+            sim.add(m=1e-3,a=-2,e=1.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+            sim.integrator = "ias15"
+            sim.simulationarchive_async = async_
+            sim.simulationarchive_index = 1
+            sim.automateSimulationArchive(filename, 1.,deletefile=True)
+            sim.integrate(50.)
+            sim.simulationarchive_snapshot(filename)
+            sim.simulationarchive_flush()
+            sas.append(rebound.SimulationArchive(filename))
+        self.assertEqual(len(sas[0]), len(sas[1]))
+        for i in range(len(sas[0])):
+            sim0, sim1 = sas[0][i], sas[1][i]
+            self.assertEqual(sim0.t, sim1.t)
+            for j in range(sim0.N):
+                self.assertEqual(sim0.particles[j].x, sim1.particles[j].x)
+                self.assertEqual(sim0.particles[j].vx, sim1.particles[j].vx)
+        # Restarting from an asynchronously written snapshot is bit-wise exact
+        sim0, sim1 = sas[0][-1], sas[1][-1]
+        sim0.integrate(60.)
+        sim1.integrate(60.)
+        self.assertEqual(sim0.particles[2].x, sim1.particles[2].x)
+        self.assertEqual(sim1.simulationarchive_async, 1)
+        os.remove("test_async.bin")
+        os.remove("test_async.bin.idx")
+
+    def test_sa_removed_fields(self):
+        # Fields of the initial binary which no longer exist are written with size 0
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1)
+        sim.add(m=1e-3,a=2,e=0.1)
+        sim.integrator = "ias15"
+        sim.integrate(1.)
+        sim.simulationarchive_snapshot("test.bin",deletefile=True)
+        sim.integrate(2.)
+        sim.simulationarchive_snapshot("test.bin")
+        sim.integrator_reset()
+        sim.integrator = "leapfrog"
+        sim.dt = 0.01
+        sim.integrate(3.)
+        sim.simulationarchive_snapshot("test.bin")
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(len(sa), 3)
+        self.assertNotEqual(sa[1].ri_ias15._allocatedN, 0)
+        sim1 = sa[2]
+        self.assertEqual(sim1.ri_ias15._allocatedN, 0)
+        self.assertEqual(sim1.integrator, "leapfrog")
+        self.assertEqual(sim1.t, sim.t)
+        self.assertEqual(sim1.particles[2].x, sim.particles[2].x)
+        sim.integrate(4.)
+        sim1.integrate(4.)
+        self.assertEqual(sim1.particles[2].x, sim.particles[2].x)
+
+    def test_sa_compress(self):
+        import os
+        import numpy as np
+        sas = []
+        for filename, compress in [("test.bin", 0), ("test_compress.bin", 1)]:
+            sim = rebound.Simulation()
+            sim.add(m=1)
+            for i in range(20):
+                sim.add(m=1e-5,a=1.+0.1*i,e=0.05,inc=0.01,M=i)
+            sim.integrator = "whfast"
+            sim.dt = 0.01
+            sim.simulationarchive_compress = compress
+            sim.automateSimulationArchive(filename, 0.1,deletefile=True)
+            sim.integrate(3.)
+            sim.add(m=1e-5,a=5.)
+            sim.integrate(4.)
+            # Recreates the writer. The next snapshot does not depend on the previous one.
+            sim2 = rebound.Simulation(filename)
+            sim2.automateSimulationArchive(filename, 0.1)
+            sim2.integrate(5.)
+            sas.append(rebound.SimulationArchive(filename))
+        self.assertLess(os.path.getsize("test_compress.bin"), os.path.getsize("test.bin"))
+        self.assertEqual(len(sas[0]), len(sas[1]))
+        for i in [30, 0, -1, 12, 31, 50, 45]:
+            sim0, sim1 = sas[0][i], sas[1][i]
+            self.assertEqual(sim0.t, sim1.t)
+            self.assertEqual(sim0.N, sim1.N)
+            for j in range(sim0.N):
+                self.assertEqual(sim0.particles[j].x, sim1.particles[j].x)
+                self.assertEqual(sim0.particles[j].vy, sim1.particles[j].vy)
+            xyz0 = np.zeros((sim0.N,3))
+            xyz1 = np.zeros((sim1.N,3))
+            sas[0].serialize_particle_data(i, xyz=xyz0)
+            sas[1].serialize_particle_data(i, xyz=xyz1)
+            self.assertEqual(np.sum(np.abs(xyz0-xyz1)), 0.)
+        # Restart is bit-wise exact
+        sim0, sim1 = sas[0][-1], sas[1][-1]
+        sim0.integrate(6.)
+        sim1.integrate(6.)
+        self.assertEqual(sim0.particles[3].x, sim1.particles[3].x)
+        os.remove("test_compress.bin")
+
+    def test_sa_getparticledata(self):
+        import numpy as np
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1)
+        sim.add(m=1e-3,a=2,e=0.05,inc=0.1)
+        sim.integrator = "whfast"
+        sim.dt = 0.05
+        sim.automateSimulationArchive("test.bin", 10.,deletefile=True)
+        sim.integrate(200.)
+        sa = rebound.SimulationArchive("test.bin")
+        times = [150., 3.5, 31., 32., 33.7, 199.9, 0.]
+        for mode in ["snapshot", "close", "exact"]:
+            t, xyzvxvyvz = sa.getParticleData(times, mode=mode, threads=2)
+            self.assertEqual(xyzvxvyvz.shape, (len(times), 3, 6))
+            for i, ti in enumerate(times):
+                sim = sa.getSimulation(ti, mode=mode)
+                if mode=="exact":
+                    self.assertEqual(t[i], ti)
+                    self.assertAlmostEqual(xyzvxvyvz[i,1,0], sim.particles[1].x, delta=1e-6)
+                else:
+                    # Bit-wise identical
+                    self.assertEqual(t[i], sim.t)
+                    self.assertEqual(xyzvxvyvz[i,2,4], sim.particles[2].vy)
+        # Python fallback with a setup function
+        sa2 = rebound.SimulationArchive("test.bin", setup=lambda sim: None)
+        t2, xyzvxvyvz2 = sa2.getParticleData(times)
+        t, xyzvxvyvz = sa.getParticleData(times)
+        self.assertEqual(np.sum(np.abs(xyzvxvyvz-xyzvxvyvz2)), 0.)
+        with self.assertRaises(ValueError):
+            sa.getParticleData([250.])
+
+    def test_sa_getparticledata_unsynchronized(self):
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1)
+        sim.add(m=1e-3,a=2,e=0.05,inc=0.1)
+        sim.integrator = "whfast"
+        sim.ri_whfast.safe_mode = 0
+        sim.dt = 0.05
+        sim.automateSimulationArchive("test.bin", 10.,deletefile=True)
+        sim.integrate(40.)
+        times = [11., 12.3, 15., 17.77, 19.9, 33.]
+        for setup in [None, lambda sim: None]:
+            sa = rebound.SimulationArchive("test.bin", setup=setup)
+            for keep_unsynchronized in [0, 1]:
+                t, xyzvxvyvz = sa.getParticleData(times, mode="close", keep_unsynchronized=keep_unsynchronized)
+                for i, ti in enumerate(times):
+                    sim = sa.getSimulation(ti, mode="close", keep_unsynchronized=keep_unsynchronized)
+                    self.assertEqual(t[i], sim.t)
+                    for j in range(sim.N):
+                        self.assertEqual(xyzvxvyvz[i,j,0], sim.particles[j].x)
+                        self.assertEqual(xyzvxvyvz[i,j,4], sim.particles[j].vy)
+
+    def test_sa_corrupt_field_size(self):
+        import os, struct
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1)
+        sim.automateSimulationArchive("test.bin", 10.,deletefile=True)
+        sim.integrate(20.)
+        sa = rebound.SimulationArchive("test.bin")
+        self.assertEqual(len(sa), 3)
+        offset = sa.offset[2]
+        sa = None
+        with open("test.bin", "rb") as f:
+            buf = bytearray(f.read())
+        # The first field of the last snapshot claims to extend far past the end of the file
+        struct.pack_into("<Q", buf, offset+8, 2**40)
+        with open("test_corrupt.bin", "wb") as f:
+            f.write(buf)
+        sa = rebound.SimulationArchive("test_corrupt.bin")
+        self.assertEqual(len(sa), 3)
+        self.assertEqual(sa.particles_N(1), 2)
+        self.assertGreaterEqual(sa[1].t, 10.)
+        with self.assertRaises(IndexError):
+            sa.particles_N(2)
+        with self.assertRaises(RuntimeError):
+            sa[2]
+        sa = None
+        os.remove("test_corrupt.bin")
+
+    def test_sa_serialize_particle_data(self):
+        import numpy as np
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+        sim.integrator = "ias15"
+        sim.automateSimulationArchive("test.bin", 10.,deletefile=True)
+        sim.integrate(20.)
+        sim.add(m=1e-3,a=-2,e=1.1,omega=0.1,M=0.1,inc=0.1,Omega=0.1)
+        sim.integrate(40.)
+        sa = rebound.SimulationArchive("test.bin")
+        for k in [0, 1, -1]:
+            sim = sa[k]
+            self.assertEqual(sa.particles_N(k), sim.N)
+            xyzvxvyvz = np.zeros((sim.N,6),dtype="float64")
+            m = np.zeros(sim.N,dtype="float64")
+            sa.serialize_particle_data(k, xyzvxvyvz=xyzvxvyvz, m=m)
+            for i in range(sim.N):
+                self.assertEqual(xyzvxvyvz[i][0], sim.particles[i].x)
+                self.assertEqual(xyzvxvyvz[i][4], sim.particles[i].vy)
+                self.assertEqual(m[i], sim.particles[i].m)
+        with self.assertRaises(IndexError):
+            sa.particles_N(100)
+
 
-    
     def test_sa_restart_generator(self):
         sim = rebound.Simulation()
         sim.add(m=1)
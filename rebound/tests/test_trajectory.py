@@ -0,0 +1,82 @@
+import rebound
+from rebound import clibrebound
+import unittest
+import os
+import math
+from ctypes import c_double, c_int, c_long, byref, POINTER
+
+class TestTrajectory(unittest.TestCase):
+
+    def setUp(self):
+        if os.path.isfile("test_trajectory.bin"):
+            os.remove("test_trajectory.bin")
+
+    def tearDown(self):
+        if os.path.isfile("test_trajectory.bin"):
+            os.remove("test_trajectory.bin")
+    
+    def test_trajectory(self):
+        sim = rebound.Simulation()
+        sim.add(m=1)
+        sim.add(m=1e-3,a=1,e=0.1)
+        sim.add(m=1e-3,a=2,e=0.1,inc=0.1)
+        x, e, times = [], [], []
+        for i in range(100):
+            sim.integrate(0.1*i)
+            sim.output_trajectory("test_trajectory.bin", orbits=True)
+            x.append(sim.particles[2].x)
+            e.append(sim.particles[2].e)
+            times.append(sim.t)
+        sim.output_trajectory_flush()
+        tr = rebound.Trajectory("test_trajectory.bin")
+        self.assertEqual(len(tr), 100)
+        self.assertEqual(tr.t.tolist(), times)
+        t, values = tr.get("x", particles=2)
+        self.assertEqual(values.tolist(), x)
+        t, values = tr.get("e", particles=[1,2])
+        self.assertEqual(values.shape, (2,100))
+        self.assertAlmostEqual(values[1][50], e[50], delta=1e-14)
+        t, values = tr.get("a", particles=0)
+        self.assertTrue(math.isnan(values[0]))
+        t, values = tr.get("x", particles=[2], tmin=2., tmax=3.)
+        self.assertEqual(t.tolist(), [ti for ti in times if ti>=2. and ti<=3.])
+        self.assertEqual(values[0].tolist(), [x[i] for i in range(100) if times[i]>=2. and times[i]<=3.])
+
+        # Same from C
+        Nt = clibrebound.reb_trajectory_read(byref(tr), c_int(0), c_long(2), c_double(2.), c_double(3.), None, None)
+        self.assertEqual(Nt, len(t))
+        tc = (c_double*Nt)()
+        xc = (c_double*Nt)()
+        clibrebound.reb_trajectory_read(byref(tr), c_int(0), c_long(2), c_double(2.), c_double(3.), tc, xc)
+        self.assertEqual(list(xc), values[0].tolist())
+    
+    def test_trajectory_chunks(self):
+        sim = rebound.Simulation()
+        for i in range(3000):
+            sim.add(x=i)
+        vx = []
+        for i in range(100):
+            sim.particles[10].vx = i
+            vx.append(i)
+            sim.output_trajectory("test_trajectory.bin", positions=False)
+        # New chunk because number of particles changed
+        sim.add(x=-1.)
+        for i in range(5):
+            sim.particles[10].vx = -i
+            vx.append(-i)
+            sim.output_trajectory("test_trajectory.bin", positions=False)
+        sim.output_trajectory_flush()
+        tr = rebound.Trajectory("test_trajectory.bin")
+        self.assertGreater(tr.nchunks, 2)
+        self.assertEqual(len(tr), 105)
+        t, values = tr.get("vx", particles=[10])
+        self.assertEqual(values[0].tolist(), vx)
+        t, values = tr.get("vx", particles=[3000])
+        self.assertEqual(values.shape, (1,5))
+        with self.assertRaises(ValueError):
+            tr.get("w")
+        t, values = tr.get("x")
+        self.assertEqual(len(t), 0)
+
+if __name__ == "__main__":
+    unittest.main()
@@ -126,6 +126,86 @@ class TestTransformations(unittest.TestCase):
         for i in range(len(c0)):
             self.assertAlmostEqual(c0[i],c1[i],delta=1e-16)
     
+    def test_jacobi_large_N(self):
+        # Above 4096 particles, OpenMP builds calculate the Jacobi transformations with a
+        # parallel prefix scan unless the deterministic mode is on.
+        def inertial_to_jacobi(ps, comps):
+            # Same operations as the serial version in transformations.c
+            pj = [dict() for p in ps]
+            eta = ps[0].m
+            s = [eta*getattr(ps[0],c) for c in comps]
+            for i in range(1,len(ps)):
+                ei = 1./eta
+                eta += ps[i].m
+                pme = eta*ei
+                for k, c in enumerate(comps):
+                    pj[i][c] = getattr(ps[i],c) - s[k]*ei
+                    s[k] = s[k]*pme + ps[i].m*pj[i][c]
+            Mtotali = 1./eta
+            for k, c in enumerate(comps):
+                pj[0][c] = s[k]*Mtotali
+            return pj
+        def jacobi_to_inertial(pj, ps, comps):
+            eta = pj[0].m
+            s = [getattr(pj[0],c)*eta for c in comps]
+            p = [dict() for q in ps]
+            for i in range(len(ps)-1,0,-1):
+                ei = 1./eta
+                for k, c in enumerate(comps):
+                    s[k] = (s[k] - ps[i].m*getattr(pj[i],c))*ei
+                    p[i][c] = getattr(pj[i],c) + s[k]
+                eta -= ps[i].m
+                for k in range(len(comps)):
+                    s[k] *= eta
+            mi = 1./eta
+            for k, c in enumerate(comps):
+                p[0][c] = s[k]*mi
+            return p
+
+        sim = rebound.Simulation()
+        sim.add(m=1.)
+        for i in range(5000):
+            sim.add(m=1e-9*(1+i%7), a=1.+0.001*i, e=0.05, inc=0.01*(i%13), f=0.1*i)
+        sim.move_to_com()
+        for i, p in enumerate(sim.particles):
+            p.ax, p.ay, p.az = 0.1*p.y, -0.1*p.x, 0.01*i
+        N = sim.N
+        cl = rebound.clibrebound
+        posvel = ["x", "y", "z", "vx", "vy", "vz"]
+        acc = ["ax", "ay", "az"]
+        pj_expected = inertial_to_jacobi(sim.particles, posvel+acc)
+        for deterministic in [True, False]:
+            rebound.omp_set_deterministic(deterministic)
+            pj = (rebound.Particle*N)()
+            cl.reb_transformations_inertial_to_jacobi_posvel(sim._particles,pj,sim._particles,N)
+            cl.reb_transformations_inertial_to_jacobi_acc(sim._particles,pj,sim._particles,N)
+            pj2 = (rebound.Particle*N)()
+            cl.reb_transformations_inertial_to_jacobi_posvelacc(sim._particles,pj2,sim._particles,N)
+            p_expected = jacobi_to_inertial(pj, sim.particles, posvel+acc)
+            ps = (rebound.Particle*N)()
+            cl.reb_transformations_jacobi_to_inertial_posvel(ps,pj,sim._particles,N)
+            cl.reb_transformations_jacobi_to_inertial_acc(ps,pj,sim._particles,N)
+            ps_pos = (rebound.Particle*N)()
+            cl.reb_transformations_jacobi_to_inertial_pos(ps_pos,pj,sim._particles,N)
+            for i in range(N):
+                for c in posvel+acc:
+                    if deterministic:
+                        # Bitwise identical to the serial version
+                        self.assertEqual(getattr(pj[i],c), pj_expected[i][c])
+                        self.assertEqual(getattr(pj2[i],c), pj_expected[i][c])
+                        self.assertEqual(getattr(ps[i],c), p_expected[i][c])
+                    else:
+                        self.assertAlmostEqual(getattr(pj[i],c), pj_expected[i][c], delta=1e-13)
+                        self.assertAlmostEqual(getattr(pj2[i],c), pj_expected[i][c], delta=1e-13)
+                        self.assertAlmostEqual(getattr(ps[i],c), p_expected[i][c], delta=1e-13)
+                    # Round trip
+                    self.assertAlmostEqual(getattr(ps[i],c), getattr(sim.particles[i],c), delta=1e-13)
+                for c in posvel[:3]:
+                    if deterministic:
+                        self.assertEqual(getattr(ps_pos[i],c), p_expected[i][c])
+                    self.assertAlmostEqual(getattr(ps_pos[i],c), getattr(sim.particles[i],c), delta=1e-13)
+        rebound.omp_set_deterministic(False)
+    
     
 if __name__ == "__main__":
     unittest.main()
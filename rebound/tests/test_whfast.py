@@ -259,6 +259,39 @@ class TestIntegratorWHFast(unittest.TestCase):
         e1 = sim.calculate_energy()
         self.assertLess(math.fabs((e0-e1)/e1),2.9e-8)
 
+    def test_whfasthelio_testparticles(self):
+        def run(testparticles, safe_mode=1):
+            sim = rebound.Simulation()
+            sim.add(m=1.)
+            sim.add(m=1e-3, a=1.,e=.1)
+            sim.add(m=1e-3, a=1.6,e=0.05,inc=0.1)
+            for i in testparticles:
+                sim.add(a=2.+0.1*i,e=0.01*i,inc=0.01*i,omega=0.3*i,f=0.7*i,primary=sim.particles[0])
+            sim.N_active = 3
+            sim.integrator = "whfast"
+            sim.ri_whfast.coordinates = "democraticheliocentric"
+            sim.ri_whfast.safe_mode = safe_mode
+            sim.dt = 0.0123
+            sim.integrate(50.)
+            sim.integrator_synchronize()
+            return sim
+        sim1 = run(range(21))
+        # Test particles do not change the massive bodies (bitwise)
+        sim2 = run([])
+        for i in range(sim2.N):
+            self.assertEqual(sim1.particles[i].xyz,sim2.particles[i].xyz)
+            self.assertEqual(sim1.particles[i].vxyz,sim2.particles[i].vxyz)
+        # A test particle does not depend on the others (bitwise)
+        for i in [0,7,20]:
+            sim3 = run([i])
+            self.assertEqual(sim1.particles[3+i].xyz,sim3.particles[3].xyz)
+            self.assertEqual(sim1.particles[3+i].vxyz,sim3.particles[3].vxyz)
+        # Without safe_mode, kicks and drifts are combined differently (not bitwise)
+        sim0 = run(range(21), safe_mode=0)
+        for i in range(sim1.N):
+            self.assertAlmostEqual(sim1.particles[i].x,sim0.particles[i].x,delta=1e-11)
+            self.assertAlmostEqual(sim1.particles[i].vy,sim0.particles[i].vy,delta=1e-11)
+
 
 class TestIntegratorWHFastBackAndForth(unittest.TestCase):
     def test_whfast_hyperbolic(self):
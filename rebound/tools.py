@@ -1,4 +1,4 @@
-from ctypes import c_uint32, c_uint, c_ulong, c_char_p
+from ctypes import c_uint32, c_uint, c_ulong, c_char_p, c_int
 from . import clibrebound
 import sys
 
@@ -22,3 +22,20 @@ def hash(key):
     else:
         raise AttributeError("Need to pash hash an integer or string.")
 
+
+def omp_set_deterministic(deterministic=True):
+    """
+    Choose between fast and reproducible OpenMP reductions.
+
+    If deterministic is True (the default of this argument), sums over particles in
+    the coordinate transformations are calculated in the same order as without OpenMP,
+    so the results are bitwise identical to a serial build. If False, they are
+    calculated in parallel and depend on the number of threads at the level of
+    round-off. The library uses the parallel sums until this function is called.
+    Has no effect if librebound was compiled without OpenMP.
+    """
+    try:
+        f = clibrebound.reb_omp_set_deterministic
+    except AttributeError:
+        return # Compiled without OpenMP: always deterministic
+    f(c_int(1 if deterministic else 0))
@@ -0,0 +1,147 @@
+from ctypes import Structure, c_double, POINTER, c_long, c_uint64, c_void_p, c_char_p, byref
+from .simulation import TRAJECTORY_FIELDS, TRAJECTORY_COLUMNS
+from . import clibrebound 
+
+class TrajectoryChunk(Structure):
+    """
+    Header of one chunk in a trajectory file.
+    """
+    _fields_ = [("n", c_uint64),
+                ("N", c_uint64),
+                ("fields", c_uint64),
+                ("t_first", c_double),
+                ("t_last", c_double)]
+
+class Trajectory(Structure):
+    """
+    Trajectory Class.
+
+    Reads columnar trajectory files created with Simulation.output_trajectory().
+    Within a chunk of the file, the time series of one quantity of one 
+    particle is stored contiguously. The data is accessed via numpy 
+    memory maps, i.e. only the data requested is read from disk.
+    
+    Examples
+    --------
+
+    >>> tr = rebound.Trajectory("trajectory.bin")
+    >>> t, x = tr.get("x", particles=[1,2], tmin=10., tmax=20.)
+    >>> print(x[0])   # x coordinate of particle 1 at times t
+
+    """
+    _fields_ = [("_inf", c_void_p),
+                ("_filename", c_char_p),
+                ("nchunks", c_long),
+                ("chunks", POINTER(TrajectoryChunk)),
+                ("_offset", POINTER(c_uint64))]
+
+    def __init__(self, filename):
+        """
+        Arguments
+        ---------
+        filename : str
+            Filename of the trajectory file to be opened.
+        """
+        if clibrebound.reb_read_trajectory(byref(self), c_char_p(filename.encode("ascii"))):
+            raise RuntimeError("Cannot read trajectory file. Check filename and file contents.")
+        self.filename = filename
+        self._memmaps = {}
+
+    def __del__(self):
+        if self._b_needsfree_ == 1: 
+            clibrebound.reb_free_trajectory_pointers(byref(self))
+
+    def __str__(self):
+        return "<rebound.Trajectory instance, snapshots={0}, chunks={1}>".format(len(self), self.nchunks)
+
+    def __len__(self):
+        return sum(self.chunks[k].n for k in range(self.nchunks))
+
+    def _columns(self, fields):
+        columns = []
+        if fields & TRAJECTORY_FIELDS["positions"]:
+            columns += TRAJECTORY_COLUMNS[0:3]
+        if fields & TRAJECTORY_FIELDS["velocities"]:
+            columns += TRAJECTORY_COLUMNS[3:6]
+        if fields & TRAJECTORY_FIELDS["orbits"]:
+            columns += TRAJECTORY_COLUMNS[6:12]
+        return columns
+
+    def _memmap(self, k):
+        # Returns memory maps of the times and of the columns of chunk k. 
+        if k not in self._memmaps:
+            import numpy as np
+            chunk = self.chunks[k]
+            n, N = chunk.n, chunk.N
+            offset = self._offset[k]
+            t = np.memmap(self.filename, dtype=np.float64, mode="r", offset=offset, shape=(n,))
+            offset += 8*n 
+            hashes = np.memmap(self.filename, dtype=np.uint32, mode="r", offset=offset, shape=(N,)) if N else np.zeros(0, dtype=np.uint32)
+            offset += (4*N+7)//8*8
+            columns = self._columns(chunk.fields)
+            data = np.memmap(self.filename, dtype=np.float64, mode="r", offset=offset, shape=(len(columns), N, n)) if N else None
+            self._memmaps[k] = (t, hashes, columns, data)
+        return self._memmaps[k]
+
+    @property
+    def t(self):
+        """
+        Returns a numpy array with the times of all snapshots.
+        """
+        import numpy as np
+        return np.concatenate([self._memmap(k)[0] for k in range(self.nchunks)]) if self.nchunks else np.zeros(0)
+
+    def get(self, column, particles=None, tmin=None, tmax=None):
+        """
+        Returns the time series of one column for a selection of particles.
+
+        Arguments
+        ---------
+        column : str
+            One of "x", "y", "z", "vx", "vy", "vz", "a", "e", "inc", "Omega", "omega", "l".
+        particles : list of int, or int
+            Indices of the particles. Default: all particles of the first chunk read.
+        tmin, tmax : float
+            Time range (inclusive). Default: all snapshots. 
+
+        Returns
+        -------
+        A tuple (t, values). t is a numpy array of length n, values a numpy 
+        array of shape (len(particles), n). Chunks which do not contain the 
+        column or all requested particles are skipped.
+        """
+        import numpy as np
+        if column not in TRAJECTORY_COLUMNS:
+            raise ValueError("Unknown column. Choose one of: " + ", ".join(TRAJECTORY_COLUMNS) + ".")
+        single = isinstance(particles, int)
+        if single:
+            particles = [particles]
+        ts, values = [], []
+        for k in range(self.nchunks):
+            chunk = self.chunks[k]
+            t_lo, t_hi = min(chunk.t_first, chunk.t_last), max(chunk.t_first, chunk.t_last)
+            if (tmin is not None and t_hi < tmin) or (tmax is not None and t_lo > tmax):
+                continue
+            t, hashes, columns, data = self._memmap(k)
+            if column not in columns or data is None:
+                continue
+            if particles is None:
+                particles = list(range(chunk.N))
+            if len(particles) and max(particles) >= chunk.N:
+                continue
+            mask = np.ones(chunk.n, dtype=bool)
+            if tmin is not None:
+                mask &= t >= tmin
+            if tmax is not None:
+                mask &= t <= tmax
+            ts.append(np.array(t[mask]))
+            values.append(np.array(data[columns.index(column)][particles][:,mask]))
+        if particles is None:
+            particles = []
+        if ts:
+            t, values = np.concatenate(ts), np.concatenate(values, axis=1)
+        else:
+            t, values = np.zeros(0), np.zeros((len(particles), 0))
+        if single:
+            values = values[0]
+        return t, values
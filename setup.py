@@ -46,15 +46,17 @@ libreboundmodule = Extension('librebound',
                                 'src/tree.c',
                                 'src/particle.c',
                                 'src/binarydiff.c',
+                                'src/compression.c',
                                 'src/output.c',
                                 'src/input.c',
                                 'src/simulationarchive.c',
+                                'src/trajectory.c',
                                 'src/transformations.c',
                                 ],
                     include_dirs = ['src'],
                     define_macros=[ ('LIBREBOUND', None) ],
                     # Removed '-march=native' for now.
-                    extra_compile_args=['-fstrict-aliasing', '-O3','-std=c99','-Wno-unknown-pragmas', ghash_arg, '-DLIBREBOUND', '-D_GNU_SOURCE', '-fPIC'],
+                    extra_compile_args=['-fstrict-aliasing', '-O3','-fno-math-errno','-std=c99','-Wno-unknown-pragmas', ghash_arg, '-DLIBREBOUND', '-D_GNU_SOURCE', '-fPIC'],
                     extra_link_args=extra_link_args,
                     )
 
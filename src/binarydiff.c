@@ -35,182 +35,349 @@
 #include "output.h"
 #include "binarydiff.h"
 
-// Wrapper for backwards compatibility
-void reb_binary_diff(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, size_t* sizep){
-    // Ignores return value
-    reb_binary_diff_with_options(buf1, size1, buf2, size2, bufp, sizep, 0);
-}
+// Number of fields per binary that can be indexed without allocating memory.
+#define REB_BINARY_DIFF_STACK_FIELDS 256
 
-int reb_binary_diff_with_options(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, size_t* sizep, int output_option){
-    if (!buf1 || !buf2 || size1<64 || size2<64){
-        printf("Cannot read input buffers.\n");
-        return 0;
-    }
+// One field of a binary.
+struct reb_binary_diff_field {
+    uint32_t type;
+    size_t pos;             // Offset of the field's data in the buffer
+    size_t size;            // Size of the field's data in bytes
+    long match;             // Index of the field in the other binary that was compared to this one, -1 if none
+};
 
-    int are_different = 0;
-    
-    if (output_option==0){
-        *bufp = NULL;
-        *sizep = 0;
-    }
-    size_t allocatedsize = 0;
+struct reb_binary_diff_key {
+    uint32_t type;
+    long i;
+};
 
-    // Header.
-    if(memcmp(buf1,buf2,64)!=0){
-        printf("Header in binary files are different.\n");
-    }
+// Index of all fields in a binary. Fields are stored in the order in which they appear.
+// The keys sorted by type are only created if a field is not found at the expected position.
+struct reb_binary_diff_index {
+    char* buf;
+    long N;
+    long allocatedN;
+    struct reb_binary_diff_field* fields;
+    struct reb_binary_diff_key* keys;
+    struct reb_binary_diff_field fields_stack[REB_BINARY_DIFF_STACK_FIELDS];
+    struct reb_binary_diff_key keys_stack[REB_BINARY_DIFF_STACK_FIELDS];
+};
 
-    size_t pos1 = 64;
-    size_t pos2 = 64;
-    
-    while(1){
-        if (pos1+sizeof(struct reb_binary_field)>size1) break;
-        struct reb_binary_field field1 = *(struct reb_binary_field*)(buf1+pos1);
-        pos1 += sizeof(struct reb_binary_field);
-        if (field1.type==REB_BINARY_FIELD_TYPE_END){
+static void reb_binary_diff_index_init(struct reb_binary_diff_index* idx, char* buf, size_t size, const char* name){
+    idx->buf = buf;
+    idx->N = 0;
+    idx->allocatedN = REB_BINARY_DIFF_STACK_FIELDS;
+    idx->fields = idx->fields_stack;
+    idx->keys = NULL;
+    size_t pos = 64;
+    while(pos+sizeof(struct reb_binary_field)<=size){
+        struct reb_binary_field field;
+        memcpy(&field, buf+pos, sizeof(struct reb_binary_field));
+        pos += sizeof(struct reb_binary_field);
+        if (field.type==REB_BINARY_FIELD_TYPE_END){
             break;
         }
-        if (pos2+sizeof(struct reb_binary_field)>size2) pos2 = 64;
-        struct reb_binary_field field2 = *(struct reb_binary_field*)(buf2+pos2);
-        pos2 += sizeof(struct reb_binary_field);
-        
-        // Fields might not be in the same order.
-        if (field1.type!=field2.type){
-            // Will search for element in buf2, starting at beginning just past header
-            // Note that we ignore all ADDITIONAL fields in buf2 that were not present in buf1 
-            pos2 = 64;
-            int notfound = 0; 
-            while(1) {
-                if (pos2+sizeof(struct reb_binary_field)>size2){
-                    notfound = 1;
-                    break;
-                }
-                field2 = *(struct reb_binary_field*)(buf2+pos2);
-                pos2 += sizeof(struct reb_binary_field);
-                if(field2.type==REB_BINARY_FIELD_TYPE_END){
-                    notfound = 1;
-                    break;
-                }
-                if (field2.type==field1.type){
-                    break; // found!!
-                }else{
-                    pos2 += field2.size; //skip
-                }
-            };
-            if (notfound == 1){
-                // Output field with size 0
-                pos1 += field1.size; // For next search
-                pos2 = 64; // For next search
-                field1.size = 0;
-                are_different = 1.;
-                switch(output_option){
-                    case 0:
-                        reb_output_stream_write(bufp, &allocatedsize, sizep, &field1,sizeof(struct reb_binary_field));
-                        break;
-                    case 1:
-                        printf("Field %d not in simulation 2.\n",field1.type);
-                        break;
-                    default:
-                        break;
-                }
-                continue;
-            }
+        if (field.size>size-pos){
+            printf("Corrupt binary file %s.\n", name);
+            break;
         }
-        // Can assume field1.type == field2.type from here on
-        if (pos1+field1.size>size1) printf("Corrupt binary file buf1.\n");
-        if (pos2+field2.size>size2) printf("Corrupt binary file buf2.\n");
-        int fields_differ = 0;
-        if (field1.size==field2.size){
-            if (memcmp(buf1+pos1,buf2+pos2,field1.size)!=0){
-                fields_differ = 1;
+        if (idx->N==idx->allocatedN){
+            idx->allocatedN *= 2;
+            if (idx->fields==idx->fields_stack){
+                idx->fields = malloc(sizeof(struct reb_binary_diff_field)*idx->allocatedN);
+                memcpy(idx->fields, idx->fields_stack, sizeof(struct reb_binary_diff_field)*idx->N);
+            }else{
+                idx->fields = realloc(idx->fields, sizeof(struct reb_binary_diff_field)*idx->allocatedN);
             }
+        }
+        idx->fields[idx->N] = (struct reb_binary_diff_field){.type = field.type, .pos = pos, .size = field.size, .match = -1};
+        idx->N++;
+        pos += field.size;
+    }
+}
+
+static void reb_binary_diff_index_free(struct reb_binary_diff_index* idx){
+    if (idx->fields!=idx->fields_stack){
+        free(idx->fields);
+    }
+    if (idx->keys!=idx->keys_stack){
+        free(idx->keys);
+    }
+}
+
+static int reb_binary_diff_compare_keys(const void* a, const void* b){
+    const struct reb_binary_diff_key* ka = a;
+    const struct reb_binary_diff_key* kb = b;
+    if (ka->type!=kb->type) return ka->type<kb->type ? -1 : 1;
+    if (ka->i!=kb->i) return ka->i<kb->i ? -1 : 1;
+    return 0;
+}
+
+// Returns the index of the first field with the given type, -1 if there is none.
+// Fields are usually in the same order in both binaries, so the field at position
+// hint is tried first. Otherwise the fields are sorted by type (once) and bisected.
+static long reb_binary_diff_index_find(struct reb_binary_diff_index* idx, uint32_t type, long hint){
+    if (hint>=0 && hint<idx->N && idx->fields[hint].type==type){
+        return hint;
+    }
+    if (idx->keys==NULL){
+        idx->keys = idx->N>REB_BINARY_DIFF_STACK_FIELDS ? malloc(sizeof(struct reb_binary_diff_key)*idx->N) : idx->keys_stack;
+        for (long i=0;i<idx->N;i++){
+            idx->keys[i] = (struct reb_binary_diff_key){.type = idx->fields[i].type, .i = i};
+        }
+        qsort(idx->keys, idx->N, sizeof(struct reb_binary_diff_key), reb_binary_diff_compare_keys);
+    }
+    long l = 0;
+    long h = idx->N;
+    while (l<h){
+        const long m = l + (h-l)/2;
+        if (idx->keys[m].type<type){
+            l = m+1;
         }else{
-            fields_differ = 1;
+            h = m;
         }
-        if(fields_differ){
-            if (field1.type!=REB_BINARY_FIELD_TYPE_WALLTIME){
-                // Ignore the walltime field for the return value.
-                // Typically we do not care about this field when comparing simulations.
-                are_different = 1.;
+    }
+    if (l<idx->N && idx->keys[l].type==type){
+        return idx->keys[l].i;
+    }
+    return -1;
+}
+
+// Size of a PARTICLES field that only contains the particles which changed. 
+// Each particle is preceded by its index (uint32_t). Returns 0 if this would
+// not be smaller than the complete field.
+static size_t reb_binary_diff_particles_delta_size(const char* p1, const char* p2, size_t size){
+    const size_t size_particle = sizeof(struct reb_particle);
+    const size_t size_entry = sizeof(uint32_t)+size_particle;
+    if (size%size_particle){
+        return 0;
+    }
+    size_t size_delta = 0;
+    for (size_t pos=0; pos<size; pos+=size_particle){
+        if (memcmp(p1+pos, p2+pos, size_particle)!=0){
+            size_delta += size_entry;
+            if (size_delta>=size){
+                return 0;
             }
+        }
+    }
+    return size_delta;
+}
+
+// Output buffer of a diff. The size keeps growing once the capacity is 
+// exceeded, but nothing is written anymore.
+struct reb_binary_diff_output {
+    char* buf;
+    size_t capacity;
+    size_t size;
+};
+
+// Returns the position where the next size bytes can be written or NULL if they do not fit.
+static char* reb_binary_diff_output_reserve(struct reb_binary_diff_output* out, size_t size){
+    char* p = NULL;
+    if (out->size+size<=out->capacity){
+        p = out->buf+out->size;
+    }
+    out->size += size;
+    return p;
+}
+
+static void reb_binary_diff_output_field(struct reb_binary_diff_output* out, uint32_t type, const char* data, size_t size){
+    char* p = reb_binary_diff_output_reserve(out, sizeof(struct reb_binary_field)+size);
+    if (p){
+        // Padding set to 0 as in output.c
+        struct reb_binary_field field;
+        memset(&field, 0, sizeof(struct reb_binary_field));
+        field.type = type;
+        field.size = size;
+        memcpy(p, &field, sizeof(struct reb_binary_field));
+        if (size){
+            memcpy(p+sizeof(struct reb_binary_field), data, size);
+        }
+    }
+}
+
+static void reb_binary_diff_output_particles_delta(struct reb_binary_diff_output* out, const char* p1, const char* p2, size_t size, size_t size_delta){
+    char* p = reb_binary_diff_output_reserve(out, sizeof(struct reb_binary_field)+size_delta);
+    if (p){
+        // Padding set to 0 as in output.c
+        struct reb_binary_field field;
+        memset(&field, 0, sizeof(struct reb_binary_field));
+        field.type = REB_BINARY_FIELD_TYPE_PARTICLESDELTA;
+        field.size = size_delta;
+        memcpy(p, &field, sizeof(struct reb_binary_field));
+        p += sizeof(struct reb_binary_field);
+        const size_t size_particle = sizeof(struct reb_particle);
+        for (size_t pos=0; pos<size; pos+=size_particle){
+            if (memcmp(p1+pos, p2+pos, size_particle)!=0){
+                const uint32_t index = pos/size_particle;
+                memcpy(p, &index, sizeof(uint32_t));
+                p += sizeof(uint32_t);
+                memcpy(p, p2+pos, size_particle);
+                p += size_particle;
+            }
+        }
+    }
+}
+
+// Compares all fields. Fields of the same type are compared with memcmp.
+// For output_option 0, the differences are written to out.
+static int reb_binary_diff_fields(struct reb_binary_diff_index* idx1, struct reb_binary_diff_index* idx2, struct reb_binary_diff_output* out, int output_option, int particle_deltas){
+    int are_different = 0;
+    char* const buf1 = idx1->buf;
+    char* const buf2 = idx2->buf;
+
+    // Note that we ignore all ADDITIONAL fields in buf2 that were not present in buf1 
+    long hint = 0;
+    for (long i=0;i<idx1->N;i++){
+        const struct reb_binary_diff_field* const f1 = &idx1->fields[i];
+        const long j = reb_binary_diff_index_find(idx2, f1->type, hint);
+        if (j<0){
+            // Output field with size 0
+            hint = 0;
+            are_different = 1;
             switch(output_option){
                 case 0:
-                    reb_output_stream_write(bufp, &allocatedsize, sizep, &field2,sizeof(struct reb_binary_field));
-                    reb_output_stream_write(bufp, &allocatedsize, sizep, buf2+pos2,field2.size);
+                    reb_binary_diff_output_field(out, f1->type, NULL, 0);
                     break;
                 case 1:
-                    printf("Field %d differs.\n",field1.type);
+                    printf("Field %d not in simulation 2.\n",f1->type);
                     break;
                 default:
-                    break;
+                    return are_different;
             }
+            continue;
         }
-        pos1 += field1.size;
-        pos2 += field2.size;
-    }
-    // Search for fields which are present in buf2 but not in buf1
-    pos1 = 64;
-    pos2 = 64;
-    while(1){
-        if (pos2+sizeof(struct reb_binary_field)>size2) break;
-        struct reb_binary_field field2 = *(struct reb_binary_field*)(buf2+pos2);
-        pos2 += sizeof(struct reb_binary_field);
-        if (field2.type==REB_BINARY_FIELD_TYPE_END){
-            break;
-        }
-        if (pos1+sizeof(struct reb_binary_field)>size1) pos1 = 64;
-        struct reb_binary_field field1 = *(struct reb_binary_field*)(buf1+pos1);
-        pos1 += sizeof(struct reb_binary_field);
-        
-        if (field1.type==field2.type){
-            // Not a new field. Skip.
-            pos1 += field1.size;
-            pos2 += field2.size;
+        hint = j+1;
+        struct reb_binary_diff_field* const f2 = &idx2->fields[j];
+        f2->match = i;
+        if (f1->size==f2->size && memcmp(buf1+f1->pos, buf2+f2->pos, f1->size)==0){
             continue;
         }
-        // Fields might not be in the same order.
-        // Will search for element in buf1, starting at beginning just past header
-        pos1 = 64;
-        int notfound = 0; 
-        while(1) {
-            if (pos1+sizeof(struct reb_binary_field)>size1){
-                notfound = 1;
+        if (f1->type!=REB_BINARY_FIELD_TYPE_WALLTIME){
+            // Ignore the walltime field for the return value.
+            // Typically we do not care about this field when comparing simulations.
+            are_different = 1;
+        }
+        switch(output_option){
+            case 0:
+                {
+                    size_t size_delta = 0;
+                    if (particle_deltas && f1->type==REB_BINARY_FIELD_TYPE_PARTICLES && f1->size==f2->size){
+                        size_delta = reb_binary_diff_particles_delta_size(buf1+f1->pos, buf2+f2->pos, f1->size);
+                    }
+                    if (size_delta){
+                        reb_binary_diff_output_particles_delta(out, buf1+f1->pos, buf2+f2->pos, f1->size, size_delta);
+                    }else{
+                        reb_binary_diff_output_field(out, f2->type, buf2+f2->pos, f2->size);
+                    }
+                }
                 break;
-            }
-            field1 = *(struct reb_binary_field*)(buf1+pos1);
-            pos1 += sizeof(struct reb_binary_field);
-            if(field1.type==REB_BINARY_FIELD_TYPE_END){
-                notfound = 1;
+            case 1:
+                printf("Field %d differs.\n",f1->type);
                 break;
-            }
-            if (field2.type==field1.type){
-                break; // found it, not new
-            }else{
-                // not found, try next
-                pos1 += field1.size;
-            }
-        };
-        if (notfound == 0){
+            default:
+                if (are_different){
+                    return are_different;
+                }
+                break;
+        }
+    }
+
+    // Search for fields which are present in buf2 but not in buf1
+    for (long j=0;j<idx2->N;j++){
+        const struct reb_binary_diff_field* const f2 = &idx2->fields[j];
+        if (f2->match>=0 || reb_binary_diff_index_find(idx1, f2->type, j)>=0){
             // Not a new field. Skip.
-            pos1 = 64;
-            pos2 += field2.size;
             continue;
         }
-
-        are_different = 1.;
+        are_different = 1;
         switch(output_option){
             case 0:
-                reb_output_stream_write(bufp, &allocatedsize, sizep, &field2,sizeof(struct reb_binary_field));
-                reb_output_stream_write(bufp, &allocatedsize, sizep, buf2+pos2,field2.size);
+                reb_binary_diff_output_field(out, f2->type, buf2+f2->pos, f2->size);
                 break;
             case 1:
-                printf("Field %d not in simulation 1.\n",field2.type);
+                printf("Field %d not in simulation 1.\n",f2->type);
                 break;
             default:
-                break;
+                return are_different;
+        }
+    }
+    return are_different;
+}
+
+// Compares two binaries. Each binary is indexed once, then fields are compared in order.
+// For output_option 0 the size of the differences is returned in sizep. The differences 
+// are written to buf if it is large enough. If bufp is not NULL, a buffer is allocated instead.
+static int reb_binary_diff_run(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, char* buf, size_t capacity, size_t* sizep, int output_option, int particle_deltas){
+    if (!buf1 || !buf2 || size1<64 || size2<64){
+        printf("Cannot read input buffers.\n");
+        return 0;
+    }
+    
+    // Header.
+    if(memcmp(buf1,buf2,64)!=0){
+        printf("Header in binary files are different.\n");
+    }
+    
+    struct reb_binary_diff_index idx1;
+    struct reb_binary_diff_index idx2;
+    reb_binary_diff_index_init(&idx1, buf1, size1, "buf1");
+    reb_binary_diff_index_init(&idx2, buf2, size2, "buf2");
+
+    struct reb_binary_diff_output out = {.buf = buf, .capacity = capacity, .size = 0};
+    if (output_option!=0){
+        bufp = NULL;
+    }
+    if (bufp){
+        // Unless a type appears more than once, every field of buf2 is written at most once.
+        out.capacity = size2 + (idx1.N+idx2.N)*sizeof(struct reb_binary_field);
+        out.buf = malloc(out.capacity);
+    }
+    int are_different = reb_binary_diff_fields(&idx1, &idx2, &out, output_option, particle_deltas);
+    if (output_option==0){
+        if (bufp && out.size>out.capacity){
+            out.capacity = out.size;
+            out.buf = realloc(out.buf, out.capacity);
+            out.size = 0;
+            for (long j=0;j<idx2.N;j++){
+                idx2.fields[j].match = -1;
+            }
+            are_different = reb_binary_diff_fields(&idx1, &idx2, &out, output_option, particle_deltas);
+        }
+        if (bufp){
+            if (out.size==0){
+                free(out.buf);
+                out.buf = NULL;
+            }
+            *bufp = out.buf;
+        }
+        *sizep = out.size;
+        if (out.size>out.capacity){
+            are_different = -1;
         }
-        pos1 = 64;
-        pos2 += field2.size;
     }
+    
+    reb_binary_diff_index_free(&idx1);
+    reb_binary_diff_index_free(&idx2);
     return are_different;
 }
+
+// Wrapper for backwards compatibility
+void reb_binary_diff(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, size_t* sizep){
+    // Ignores return value
+    reb_binary_diff_with_options(buf1, size1, buf2, size2, bufp, sizep, 0);
+}
+
+int reb_binary_diff_with_options(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, size_t* sizep, int output_option){
+    if (output_option==0){
+        *bufp = NULL;
+        *sizep = 0;
+    }
+    return reb_binary_diff_run(buf1, size1, buf2, size2, bufp, NULL, 0, sizep, output_option, 0);
+}
+
+int reb_binary_diff_to_buffer(char* buf1, size_t size1, char* buf2, size_t size2, char* buf, size_t capacity, size_t* sizep, int particle_deltas){
+    *sizep = 0;
+    return reb_binary_diff_run(buf1, size1, buf2, size2, NULL, buf, capacity, sizep, 0, particle_deltas);
+}
@@ -83,6 +83,11 @@ void reb_boundary_check(struct reb_simulation* const r){
 			break;
 		case REB_BOUNDARY_SHEAR:
 		{
+			if (r->integrator==REB_INTEGRATOR_SEI && r->ri_sei.boundary_wrapped){
+				// SEI already wrapped the particles during the drift.
+				r->ri_sei.boundary_wrapped = 0;
+				break;
+			}
 			// The offset of ghostcell is time dependent.
 			const double OMEGA = r->ri_sei.OMEGA;
 			const double offsetp1 = -fmod(-1.5*OMEGA*boxsize.x*r->t+boxsize.y/2.,boxsize.y)-boxsize.y/2.; 
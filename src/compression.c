@@ -0,0 +1,238 @@
+/**
+ * @file    compression.c
+ * @brief   Delta encoding and compression of binary snapshots.
+ * @details Consecutive SimulationArchive snapshots differ mostly in the
+ * low-order bytes of floating point numbers. The snapshot is therefore
+ * XORed with a reference, the bytes are grouped by significance (byte
+ * shuffle), and the result is compressed with a small LZ77 type
+ * compressor. The compressed format is similar to an LZ4 block: a
+ * sequence of literal runs and back references with 16 bit offsets.
+ * @author  Hanno Rein <hanno@hanno-rein.de>
+ *
+ * @section     LICENSE
+ * Copyright (c) 2018 Hanno Rein
+ *
+ * This file is part of rebound.
+ *
+ * rebound is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * rebound is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "compression.h"
+
+#define REB_LZ_HASH_LOG     16      // Size of hash table (log2)
+#define REB_LZ_MIN_MATCH    4       // Shortest back reference
+#define REB_LZ_MAX_OFFSET   65535   // Offsets are stored as 16 bit integers
+#define REB_SHUFFLE_WIDTH   8       // Size of the words that are shuffled (double)
+
+static inline uint32_t reb_lz_read32(const unsigned char* p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(uint32_t));
+    return v;
+}
+
+static inline uint32_t reb_lz_hash(const uint32_t v){
+    return (v*2654435761u)>>(32-REB_LZ_HASH_LOG);
+}
+
+// Writes the remainder of a length that does not fit into the 4 bits of the token.
+static inline unsigned char* reb_lz_write_length(unsigned char* op, size_t length){
+    length -= 15;
+    while (length>=255){
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// Reads the remainder of a length. Returns -1 if the input ends prematurely.
+static inline int reb_lz_read_length(const unsigned char* in, const size_t size_in, size_t* ip, size_t* length){
+    unsigned char b;
+    do{
+        if (*ip>=size_in) return -1;
+        b = in[(*ip)++];
+        *length += b;
+    }while(b==255);
+    return 0;
+}
+
+// Maximum size of the compressed output for an input of size bytes.
+static size_t reb_lz_bound(const size_t size){
+    return size + size/255 + 16;
+}
+
+// Compresses in into out. out needs to be at least reb_lz_bound(size) bytes long.
+// Returns the size of the compressed data.
+static size_t reb_lz_compress(const unsigned char* in, const size_t size, unsigned char* out){
+    size_t* table = calloc(1<<REB_LZ_HASH_LOG, sizeof(size_t)); // Position+1 of last occurence, 0 if empty
+    unsigned char* op = out;
+    size_t ip = 0;
+    size_t anchor = 0;  // Start of pending literals
+    while (ip+REB_LZ_MIN_MATCH<=size){
+        const uint32_t seq = reb_lz_read32(in+ip);
+        const uint32_t h = reb_lz_hash(seq);
+        const size_t ref = table[h];
+        table[h] = ip+1;
+        if (ref==0 || ip-(ref-1)>REB_LZ_MAX_OFFSET || reb_lz_read32(in+ref-1)!=seq){
+            // No match. Skip faster through incompressible data.
+            ip += 1 + ((ip-anchor)>>6);
+            continue;
+        }
+        const size_t match = ref-1;
+        size_t length = REB_LZ_MIN_MATCH;
+        while (ip+length+sizeof(uint64_t)<=size){
+            uint64_t a, b;
+            memcpy(&a, in+match+length, sizeof(uint64_t));
+            memcpy(&b, in+ip+length, sizeof(uint64_t));
+            if (a!=b) break;
+            length += sizeof(uint64_t);
+        }
+        while (ip+length<size && in[match+length]==in[ip+length]){
+            length++;
+        }
+
+        // Token, literals, offset, match length
+        const size_t literals = ip-anchor;
+        unsigned char* token = op++;
+        *token = (unsigned char)((literals>=15?15:literals)<<4);
+        if (literals>=15){
+            op = reb_lz_write_length(op, literals);
+        }
+        memcpy(op, in+anchor, literals);
+        op += literals;
+        const size_t offset = ip-match;
+        *op++ = (unsigned char)(offset & 0xff);
+        *op++ = (unsigned char)(offset >> 8);
+        const size_t length_stored = length-REB_LZ_MIN_MATCH;
+        *token |= (unsigned char)(length_stored>=15?15:length_stored);
+        if (length_stored>=15){
+            op = reb_lz_write_length(op, length_stored);
+        }
+        ip += length;
+        anchor = ip;
+    }
+    // Last literals. Always present, even if empty, to mark the end.
+    const size_t literals = size-anchor;
+    *op++ = (unsigned char)((literals>=15?15:literals)<<4);
+    if (literals>=15){
+        op = reb_lz_write_length(op, literals);
+    }
+    memcpy(op, in+anchor, literals);
+    op += literals;
+    free(table);
+    return op-out;
+}
+
+// Decompresses in into out. Returns -1 if the input is corrupt or does not match size_out.
+static int reb_lz_decompress(const unsigned char* in, const size_t size_in, unsigned char* out, const size_t size_out){
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip<size_in){
+        const unsigned char token = in[ip++];
+        size_t literals = token>>4;
+        if (literals==15 && reb_lz_read_length(in, size_in, &ip, &literals)){
+            return -1;
+        }
+        if (literals>size_in-ip || literals>size_out-op){
+            return -1;
+        }
+        memcpy(out+op, in+ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip==size_in){
+            break; // Last sequence has no back reference
+        }
+        if (size_in-ip<2){
+            return -1;
+        }
+        const size_t offset = in[ip] | ((size_t)in[ip+1]<<8);
+        ip += 2;
+        size_t length = token & 15;
+        if (length==15 && reb_lz_read_length(in, size_in, &ip, &length)){
+            return -1;
+        }
+        length += REB_LZ_MIN_MATCH;
+        if (offset==0 || offset>op || length>size_out-op){
+            return -1;
+        }
+        // The reference can overlap with the output (runs). The data before op is periodic 
+        // with period offset. The length of the periodic part doubles with each copy.
+        size_t copied = 0;
+        while (copied<length){
+            const size_t n = offset+copied < length-copied ? offset+copied : length-copied;
+            memcpy(out+op+copied, out+op-offset, n);
+            copied += n;
+        }
+        op += length;
+    }
+    return op==size_out?0:-1;
+}
+
+void reb_compress_delta(const char* buf_ref, size_t size_ref, const char* buf, size_t size, char** bufp, size_t* sizep){
+    const unsigned char* const in = (const unsigned char*)buf;
+    const unsigned char* const ref = (const unsigned char*)buf_ref;
+    if (ref==NULL){
+        size_ref = 0;
+    }
+    // XOR with reference, then shuffle. The tail which is not a full word is not shuffled.
+    unsigned char* delta = malloc(size);
+    const size_t size_xor = size<size_ref ? size : size_ref;
+    for (size_t j=0;j<size_xor;j++){
+        delta[j] = in[j]^ref[j];
+    }
+    memcpy(delta+size_xor, in+size_xor, size-size_xor);
+    unsigned char* shuffled = malloc(size);
+    const size_t Nwords = size/REB_SHUFFLE_WIDTH;
+    for (int k=0;k<REB_SHUFFLE_WIDTH;k++){
+        for (size_t i=0;i<Nwords;i++){
+            shuffled[k*Nwords+i] = delta[i*REB_SHUFFLE_WIDTH+k];
+        }
+    }
+    memcpy(shuffled+Nwords*REB_SHUFFLE_WIDTH, delta+Nwords*REB_SHUFFLE_WIDTH, size-Nwords*REB_SHUFFLE_WIDTH);
+    free(delta);
+
+    unsigned char* out = malloc(reb_lz_bound(size));
+    *sizep = reb_lz_compress(shuffled, size, out);
+    *bufp = realloc(out, *sizep);
+    free(shuffled);
+}
+
+int reb_decompress_delta(const char* buf_ref, size_t size_ref, const char* buf_compressed, size_t size_compressed, char* buf, size_t size){
+    unsigned char* const out = (unsigned char*)buf;
+    const unsigned char* const ref = (const unsigned char*)buf_ref;
+    if (ref==NULL){
+        size_ref = 0;
+    }
+    unsigned char* shuffled = malloc(size);
+    if (reb_lz_decompress((const unsigned char*)buf_compressed, size_compressed, shuffled, size)){
+        free(shuffled);
+        return -1;
+    }
+    const size_t Nwords = size/REB_SHUFFLE_WIDTH;
+    for (int k=0;k<REB_SHUFFLE_WIDTH;k++){
+        for (size_t i=0;i<Nwords;i++){
+            out[i*REB_SHUFFLE_WIDTH+k] = shuffled[k*Nwords+i];
+        }
+    }
+    memcpy(out+Nwords*REB_SHUFFLE_WIDTH, shuffled+Nwords*REB_SHUFFLE_WIDTH, size-Nwords*REB_SHUFFLE_WIDTH);
+    const size_t size_xor = size<size_ref ? size : size_ref;
+    for (size_t j=0;j<size_xor;j++){
+        out[j] ^= ref[j];
+    }
+    free(shuffled);
+    return 0;
+}
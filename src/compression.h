@@ -0,0 +1,57 @@
+/**
+ * @file    compression.h
+ * @brief   Delta encoding and compression of binary snapshots.
+ * @author  Hanno Rein <hanno@hanno-rein.de>
+ *
+ * @section     LICENSE
+ * Copyright (c) 2018 Hanno Rein
+ *
+ * This file is part of rebound.
+ *
+ * rebound is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * rebound is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _COMPRESSION_H
+#define _COMPRESSION_H
+
+#include <stddef.h>
+
+/**
+ * @brief Compresses a buffer relative to a reference buffer.
+ * @details The buffer is XORed with the reference, the bytes are shuffled so that
+ * bytes of equal significance of consecutive 8-byte words are grouped together, and
+ * the result is compressed with an LZ77 type compressor. The reference can have a
+ * different size. The output only depends on buf and buf_ref.
+ * @param buf_ref Reference buffer (can be NULL)
+ * @param size_ref Size of reference buffer
+ * @param buf Buffer to be compressed
+ * @param size Size of buffer to be compressed
+ * @param bufp Will be set to the compressed buffer. Needs to be freed.
+ * @param sizep Will be set to the size of the compressed buffer.
+ */
+void reb_compress_delta(const char* buf_ref, size_t size_ref, const char* buf, size_t size, char** bufp, size_t* sizep);
+
+/**
+ * @brief Reverses reb_compress_delta.
+ * @param buf_ref Reference buffer that was used for compression
+ * @param size_ref Size of reference buffer
+ * @param buf_compressed Compressed buffer
+ * @param size_compressed Size of compressed buffer
+ * @param buf Output buffer of size size.
+ * @param size Size of uncompressed buffer
+ * @return 0 on success, -1 if the compressed buffer is corrupt.
+ */
+int reb_decompress_delta(const char* buf_ref, size_t size_ref, const char* buf_compressed, size_t size_compressed, char* buf, size_t size);
+
+#endif // _COMPRESSION_H
@@ -53,6 +53,38 @@
   */
 static void reb_calculate_acceleration_for_particle(const struct reb_simulation* const r, const int pt, const struct reb_ghostbox gb);
 
+/**
+  * @brief Returns G*m/r^3 in single precision. 
+  * @details The factors are multiplied in an order that avoids underflows at large distances.
+  * @param r2 Square of the distance (including softening).
+  * @param Gm Gravitational constant times mass.
+  */
+static inline float reb_gravity_prefact_float(const float r2, const float Gm){
+    const float r2i = 1.f/r2;
+    return Gm*r2i*sqrtf(r2i);
+}
+
+/**
+  * @brief Copies the positions and masses of the active particles into r->gravity_mixed_sources.
+  * @details The array contains N_active x, y, z and G*m values, in this order. 
+  * @param r REBOUND simulation to consider
+  * @param N_active Number of active particles.
+  */
+static void reb_calculate_acceleration_mixed_sources(struct reb_simulation* const r, const int N_active);
+
+/**
+  * @brief Calculates the acceleration of one test particle from all active particles in single precision.
+  * @details Used if gravity_mixed_precision is set. The accelerations are accumulated in double precision.
+  * Requires r->gravity_mixed_sources to be up to date.
+  * @param r REBOUND simulation to consider
+  * @param i Index of the test particle.
+  * @param gb Ghostbox to consider.
+  * @param startj Index of the first active particle to consider.
+  * @param N_active Number of active particles.
+  * @param backreaction If set to 1, the active particles feel the test particle (testparticle_type 1).
+  */
+static void reb_calculate_acceleration_testparticle_mixed(struct reb_simulation* const r, const int i, const struct reb_ghostbox gb, const int startj, const int N_active, const int backreaction);
+
 
 /**
  * Main Gravity Routine
@@ -67,6 +99,7 @@ void reb_calculate_acceleration(struct reb_simulation* r){
     const int _N_real   = N  - r->N_var;
     const int _N_active = ((N_active==-1)?_N_real:N_active);
     const int _testparticle_type   = r->testparticle_type;
+    const unsigned int _mixed_precision = r->gravity_mixed_precision;
     switch (r->gravity){
         case REB_GRAVITY_NONE: // Do nothing.
         for (int j=0; j<N; j++){
@@ -135,25 +168,142 @@ void reb_calculate_acceleration(struct reb_simulation* r){
             const int nghostx = r->nghostx;
             const int nghosty = r->nghosty;
             const int nghostz = r->nghostz;
-            const int starti = (_gravity_ignore_terms==0)?1:2;
             const int startj = (_gravity_ignore_terms==2)?1:0;
+            if (r->ri_ias15.activeN){
+                // IAS15 block timesteps: only the particles on the levels
+                // being advanced need forces.
+                const int activeN = r->ri_ias15.activeN;
+                const int* const active_map = r->ri_ias15.active_map;
+#pragma omp parallel for
+                for (int k=0; k<activeN; k++){
+#ifndef OPENMP
+                if (reb_sigint) return;
+#endif // OPENMP
+                const int i = active_map[k];
+                const int _N_sources = (_testparticle_type && i<_N_active)?_N_real:_N_active;
+                particles[i].ax = 0;
+                particles[i].ay = 0;
+                particles[i].az = 0;
+                for (int gbx=-nghostx; gbx<=nghostx; gbx++){
+                for (int gby=-nghosty; gby<=nghosty; gby++){
+                for (int gbz=-nghostz; gbz<=nghostz; gbz++){
+                    struct reb_ghostbox gb = reb_boundary_get_ghostbox(r, gbx,gby,gbz);
+                    for (int j=startj; j<_N_sources; j++){
+                        if (j==i) continue;
+                        const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
+                        const double dy = (gb.shifty+particles[i].y) - particles[j].y;
+                        const double dz = (gb.shiftz+particles[i].z) - particles[j].z;
+                        const double _r = sqrt(dx*dx + dy*dy + dz*dz + softening2);
+                        const double prefact = G/(_r*_r*_r);
+                        const double prefactj = -prefact*particles[j].m;
+
+                        particles[i].ax    += prefactj*dx;
+                        particles[i].ay    += prefactj*dy;
+                        particles[i].az    += prefactj*dz;
+                    }
+                }
+                }
+                }
+                }
+                break;
+            }
 #pragma omp parallel for 
             for (int i=0; i<N; i++){
                 particles[i].ax = 0; 
                 particles[i].ay = 0; 
                 particles[i].az = 0; 
             }
+            if (_mixed_precision && _N_real>_N_active){
+                reb_calculate_acceleration_mixed_sources(r, _N_active);
+            }
             // Summing over all Ghost Boxes
             for (int gbx=-nghostx; gbx<=nghostx; gbx++){
             for (int gby=-nghosty; gby<=nghosty; gby++){
             for (int gbz=-nghostz; gbz<=nghostz; gbz++){
                 struct reb_ghostbox gb = reb_boundary_get_ghostbox(r, gbx,gby,gbz);
+#ifdef OPENMP
+                // Every thread only updates its own particles. Each pair is therefore calculated twice.
+#pragma omp parallel for schedule(guided)
+                for (int i=0; i<_N_active; i++){
+                for (int j=0; j<_N_active; j++){
+                    if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
+                    if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
+                    if (i==j) continue;
+                    const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
+                    const double dy = (gb.shifty+particles[i].y) - particles[j].y;
+                    const double dz = (gb.shiftz+particles[i].z) - particles[j].z;
+                    const double _r = sqrt(dx*dx + dy*dy + dz*dz + softening2);
+                    const double prefact = G/(_r*_r*_r);
+                    const double prefactj = -prefact*particles[j].m;
+                    
+                    particles[i].ax    += prefactj*dx;
+                    particles[i].ay    += prefactj*dy;
+                    particles[i].az    += prefactj*dz;
+                }
+                }
+                // Interactions of test particles with active particles
+#pragma omp parallel for schedule(guided)
+                for (int i=_N_active; i<_N_real; i++){
+                if (_mixed_precision){
+                    reb_calculate_acceleration_testparticle_mixed(r, i, gb, startj, _N_active, 0);
+                    continue;
+                }
+                for (int j=startj; j<_N_active; j++){
+                    const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
+                    const double dy = (gb.shifty+particles[i].y) - particles[j].y;
+                    const double dz = (gb.shiftz+particles[i].z) - particles[j].z;
+                    const double _r = sqrt(dx*dx + dy*dy + dz*dz + softening2);
+                    const double prefact = G/(_r*_r*_r);
+                    const double prefactj = -prefact*particles[j].m;
+                    
+                    particles[i].ax    += prefactj*dx;
+                    particles[i].ay    += prefactj*dy;
+                    particles[i].az    += prefactj*dz;
+                }
+                }
+                if (_testparticle_type){
+                    // Interactions of active particles with test particles
+#pragma omp parallel for schedule(guided)
+                    for (int j=startj; j<_N_active; j++){
+                    if (_mixed_precision){
+                        // Single precision, double precision accumulation.
+                        const float softening2f = softening2;
+                        const float Gf = G;
+                        double ax = 0.;
+                        double ay = 0.;
+                        double az = 0.;
+                        for (int i=_N_active; i<_N_real; i++){
+                            const float dx = (gb.shiftx+particles[i].x) - particles[j].x;
+                            const float dy = (gb.shifty+particles[i].y) - particles[j].y;
+                            const float dz = (gb.shiftz+particles[i].z) - particles[j].z;
+                            const float prefacti = reb_gravity_prefact_float(dx*dx + dy*dy + dz*dz + softening2f, Gf*(float)particles[i].m);
+                            ax += prefacti*dx;
+                            ay += prefacti*dy;
+                            az += prefacti*dz;
+                        }
+                        particles[j].ax += ax;
+                        particles[j].ay += ay;
+                        particles[j].az += az;
+                        continue;
+                    }
+                    for (int i=_N_active; i<_N_real; i++){
+                        const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
+                        const double dy = (gb.shifty+particles[i].y) - particles[j].y;
+                        const double dz = (gb.shiftz+particles[i].z) - particles[j].z;
+                        const double _r = sqrt(dx*dx + dy*dy + dz*dz + softening2);
+                        const double prefact = G/(_r*_r*_r);
+                        const double prefacti = prefact*particles[i].m;
+                        particles[j].ax    += prefacti*dx;
+                        particles[j].ay    += prefacti*dy;
+                        particles[j].az    += prefacti*dz;
+                    }
+                    }
+                }
+#else // OPENMP
                 // All active particle pairs
-#pragma omp parallel for
+                const int starti = (_gravity_ignore_terms==0)?1:2;
                 for (int i=starti; i<_N_active; i++){
-#ifndef OPENMP
                 if (reb_sigint) return;
-#endif // OPENMP
                 for (int j=startj; j<i; j++){
                     const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
                     const double dy = (gb.shifty+particles[i].y) - particles[j].y;
@@ -172,11 +322,12 @@ void reb_calculate_acceleration(struct reb_simulation* r){
                 }
                 }
                 // Interactions of test particles with active particles
-#pragma omp parallel for
                 for (int i=_N_active; i<_N_real; i++){
-#ifndef OPENMP
                 if (reb_sigint) return;
-#endif // OPENMP
+                if (_mixed_precision){
+                    reb_calculate_acceleration_testparticle_mixed(r, i, gb, startj, _N_active, _testparticle_type);
+                    continue;
+                }
                 for (int j=startj; j<_N_active; j++){
                     const double dx = (gb.shiftx+particles[i].x) - particles[j].x;
                     const double dy = (gb.shifty+particles[i].y) - particles[j].y;
@@ -196,6 +347,7 @@ void reb_calculate_acceleration(struct reb_simulation* r){
                     }
                 }
                 }
+#endif // OPENMP
             }
             }
             }
@@ -610,290 +762,420 @@ void reb_calculate_acceleration(struct reb_simulation* r){
 
 }
 
-void reb_calculate_acceleration_var(struct reb_simulation* r){
+/**
+ * @brief Direct summation of the first order variational equations.
+ * @details Handles all first order variational configurations which are not test particles
+ * with a single pass over all particle pairs. The pair geometry is shared between these
+ * configurations and, if real is 1, with the accelerations of the real particles
+ * (as in REB_GRAVITY_BASIC without ghost boxes and without softening).
+ */
+static void reb_calculate_acceleration_var1(struct reb_simulation* r, const int real){
     struct reb_particle* const particles = r->particles;
     const double G = r->G;
-    const unsigned int _gravity_ignore_terms = r->gravity_ignore_terms;
-    const int N = r->N;
-    const int _N_real   = N - r->N_var;
+    const int var_config_N = r->var_config_N;
+    const struct reb_variational_configuration* const var_config = r->var_config;
+    const int _N_real   = r->N - r->N_var;
+    const int _N_active = ((r->N_active==-1)?_N_real:r->N_active);
+    const int _testparticle_type = r->testparticle_type;
     const int starti = (r->gravity_ignore_terms==0)?1:2;
     const int startj = (r->gravity_ignore_terms==2)?1:0;
-    switch (r->gravity){
-        case REB_GRAVITY_NONE: // Do nothing.
-        break;
-        case REB_GRAVITY_COMPENSATED:
-        {
-            struct reb_vec3d* restrict const cs = r->gravity_cs;
+#ifdef OPENMP
+    // Every thread only updates its own particles. Each pair is therefore calculated twice.
 #pragma omp parallel for schedule(guided)
-            for (int i=_N_real; i<N; i++){
-                cs[i].x = 0.;
-                cs[i].y = 0.;
-                cs[i].z = 0.;
+    for (int i=0; i<_N_real; i++){
+        if (real){
+            particles[i].ax = 0.;
+            particles[i].ay = 0.;
+            particles[i].az = 0.;
+        }
+        for (int v=0;v<var_config_N;v++){
+            const struct reb_variational_configuration vc = var_config[v];
+            if (vc.order!=1 || vc.testparticle>=0) continue;
+            particles[vc.index+i].ax = 0.;
+            particles[vc.index+i].ay = 0.;
+            particles[vc.index+i].az = 0.;
+        }
+        for (int j=0; j<_N_real; j++){
+            if (i==j) continue;
+            const int var_pair = (i>j?i:j)>=starti && (i<j?i:j)>=startj;
+            int real_pair = 0;
+            if (real){
+                if (i<_N_active && j<_N_active){
+                    real_pair = var_pair;
+                }else if (j<_N_active){
+                    real_pair = j>=startj;
+                }else if (i<_N_active){
+                    real_pair = _testparticle_type && i>=startj;
+                }
+            }
+            if (!var_pair && !real_pair) continue;
+            const double dx = particles[i].x - particles[j].x;
+            const double dy = particles[i].y - particles[j].y;
+            const double dz = particles[i].z - particles[j].z;
+            const double r2 = dx*dx + dy*dy + dz*dz;
+            const double _r  = sqrt(r2);
+            if (real_pair){
+                const double prefact = G/(_r*_r*_r);
+                const double prefactj = -prefact*particles[j].m;
+                particles[i].ax    += prefactj*dx;
+                particles[i].ay    += prefactj*dy;
+                particles[i].az    += prefactj*dz;
+            }
+            if (!var_pair) continue;
+            const double r3inv = 1./(r2*_r);
+            const double r5inv = 3.*r3inv/r2;
+            const double dxdx = dx*dx*r5inv - r3inv;
+            const double dydy = dy*dy*r5inv - r3inv;
+            const double dzdz = dz*dz*r5inv - r3inv;
+            const double dxdy = dx*dy*r5inv;
+            const double dxdz = dx*dz*r5inv;
+            const double dydz = dy*dz*r5inv;
+            const double Gmj = G * particles[j].m;
+            for (int v=0;v<var_config_N;v++){
+                const struct reb_variational_configuration vc = var_config[v];
+                if (vc.order!=1 || vc.testparticle>=0) continue;
+                struct reb_particle* const particles_var1 = particles + vc.index;
+                const double ddx = particles_var1[i].x - particles_var1[j].x;
+                const double ddy = particles_var1[i].y - particles_var1[j].y;
+                const double ddz = particles_var1[i].z - particles_var1[j].z;
+                const double dax =   ddx * dxdx + ddy * dxdy + ddz * dxdz;
+                const double day =   ddx * dxdy + ddy * dydy + ddz * dydz;
+                const double daz =   ddx * dxdz + ddy * dydz + ddz * dzdz;
+                const double dGmj = G*particles_var1[j].m;
+                particles_var1[i].ax += Gmj * dax - dGmj*r3inv*dx;
+                particles_var1[i].ay += Gmj * day - dGmj*r3inv*dy;
+                particles_var1[i].az += Gmj * daz - dGmj*r3inv*dz;
             }
         }
-        case REB_GRAVITY_BASIC:
-            for (int v=0;v<r->var_config_N;v++){
-                struct reb_variational_configuration const vc = r->var_config[v];
-                if (vc.order==1){
-                    //////////////////
-                    /// 1st order  ///
-                    //////////////////
-                    struct reb_particle* const particles_var1 = particles + vc.index;
-                    if (vc.testparticle<0){
-                        for (int i=0; i<_N_real; i++){
-                            particles_var1[i].ax = 0.; 
-                            particles_var1[i].ay = 0.; 
-                            particles_var1[i].az = 0.; 
-                        }
-                        for (int i=starti; i<_N_real; i++){
-                        for (int j=startj; j<i; j++){
-                            const double dx = particles[i].x - particles[j].x;
-                            const double dy = particles[i].y - particles[j].y;
-                            const double dz = particles[i].z - particles[j].z;
-                            const double r2 = dx*dx + dy*dy + dz*dz;
-                            const double _r  = sqrt(r2);
-                            const double r3inv = 1./(r2*_r);
-                            const double r5inv = 3.*r3inv/r2;
-                            const double ddx = particles_var1[i].x - particles_var1[j].x;
-                            const double ddy = particles_var1[i].y - particles_var1[j].y;
-                            const double ddz = particles_var1[i].z - particles_var1[j].z;
-                            const double Gmi = G * particles[i].m;
-                            const double Gmj = G * particles[j].m;
+    }
+#else // OPENMP
+    for (int i=0; i<_N_real; i++){
+        if (real){
+            particles[i].ax = 0.;
+            particles[i].ay = 0.;
+            particles[i].az = 0.;
+        }
+        for (int v=0;v<var_config_N;v++){
+            const struct reb_variational_configuration vc = var_config[v];
+            if (vc.order!=1 || vc.testparticle>=0) continue;
+            particles[vc.index+i].ax = 0.;
+            particles[vc.index+i].ay = 0.;
+            particles[vc.index+i].az = 0.;
+        }
+    }
+    for (int i=0; i<_N_real; i++){
+    if (reb_sigint) return;
+    for (int j=startj; j<i; j++){
+        // Same pairs and order of summation as in REB_GRAVITY_BASIC
+        const int real_pair = real && (i<_N_active ? i>=starti : j<_N_active);
+        const int var_pair = i>=starti;
+        if (!var_pair && !real_pair) continue;
+        const double dx = particles[i].x - particles[j].x;
+        const double dy = particles[i].y - particles[j].y;
+        const double dz = particles[i].z - particles[j].z;
+        const double r2 = dx*dx + dy*dy + dz*dz;
+        const double _r  = sqrt(r2);
+        if (real_pair){
+            const double prefact = G/(_r*_r*_r);
+            const double prefactj = -prefact*particles[j].m;
+            particles[i].ax    += prefactj*dx;
+            particles[i].ay    += prefactj*dy;
+            particles[i].az    += prefactj*dz;
+            if (i<_N_active || _testparticle_type){
+                const double prefacti = prefact*particles[i].m;
+                particles[j].ax    += prefacti*dx;
+                particles[j].ay    += prefacti*dy;
+                particles[j].az    += prefacti*dz;
+            }
+        }
+        if (!var_pair) continue;
+        const double r3inv = 1./(r2*_r);
+        const double r5inv = 3.*r3inv/r2;
+        const double dxdx = dx*dx*r5inv - r3inv;
+        const double dydy = dy*dy*r5inv - r3inv;
+        const double dzdz = dz*dz*r5inv - r3inv;
+        const double dxdy = dx*dy*r5inv;
+        const double dxdz = dx*dz*r5inv;
+        const double dydz = dy*dz*r5inv;
+        const double Gmi = G * particles[i].m;
+        const double Gmj = G * particles[j].m;
+        for (int v=0;v<var_config_N;v++){
+            const struct reb_variational_configuration vc = var_config[v];
+            if (vc.order!=1 || vc.testparticle>=0) continue;
+            struct reb_particle* const particles_var1 = particles + vc.index;
+            const double ddx = particles_var1[i].x - particles_var1[j].x;
+            const double ddy = particles_var1[i].y - particles_var1[j].y;
+            const double ddz = particles_var1[i].z - particles_var1[j].z;
+            const double dax =   ddx * dxdx + ddy * dxdy + ddz * dxdz;
+            const double day =   ddx * dxdy + ddy * dydy + ddz * dydz;
+            const double daz =   ddx * dxdz + ddy * dydz + ddz * dzdz;
 
-                            // Variational equations
-                            const double dxdx = dx*dx*r5inv - r3inv;
-                            const double dydy = dy*dy*r5inv - r3inv;
-                            const double dzdz = dz*dz*r5inv - r3inv;
-                            const double dxdy = dx*dy*r5inv;
-                            const double dxdz = dx*dz*r5inv;
-                            const double dydz = dy*dz*r5inv;
-                            const double dax =   ddx * dxdx + ddy * dxdy + ddz * dxdz;
-                            const double day =   ddx * dxdy + ddy * dydy + ddz * dydz;
-                            const double daz =   ddx * dxdz + ddy * dydz + ddz * dzdz;
+            // Variational mass contributions
+            const double dGmi = G*particles_var1[i].m;
+            const double dGmj = G*particles_var1[j].m;
 
-                            // Variational mass contributions
-                            const double dGmi = G*particles_var1[i].m;
-                            const double dGmj = G*particles_var1[j].m;
+            particles_var1[i].ax += Gmj * dax - dGmj*r3inv*dx;
+            particles_var1[i].ay += Gmj * day - dGmj*r3inv*dy;
+            particles_var1[i].az += Gmj * daz - dGmj*r3inv*dz;
 
-                            particles_var1[i].ax += Gmj * dax - dGmj*r3inv*dx;
-                            particles_var1[i].ay += Gmj * day - dGmj*r3inv*dy;
-                            particles_var1[i].az += Gmj * daz - dGmj*r3inv*dz;
+            particles_var1[j].ax -= Gmi * dax - dGmi*r3inv*dx;
+            particles_var1[j].ay -= Gmi * day - dGmi*r3inv*dy;
+            particles_var1[j].az -= Gmi * daz - dGmi*r3inv*dz; 
+        }
+    }
+    }
+#endif // OPENMP
+}
 
-                            particles_var1[j].ax -= Gmi * dax - dGmi*r3inv*dx;
-                            particles_var1[j].ay -= Gmi * day - dGmi*r3inv*dy;
-                            particles_var1[j].az -= Gmi * daz - dGmi*r3inv*dz; 
-                        }
-                        }
-                    }else{ //testparticle
-                        int i = vc.testparticle;
-                        particles_var1[0].ax = 0.; 
-                        particles_var1[0].ay = 0.; 
-                        particles_var1[0].az = 0.; 
-                        for (int j=0; j<_N_real; j++){
-                            if (i==j) continue;
-                            if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
-                            if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
-                            const double dx = particles[i].x - particles[j].x;
-                            const double dy = particles[i].y - particles[j].y;
-                            const double dz = particles[i].z - particles[j].z;
-                            const double r2 = dx*dx + dy*dy + dz*dz;
-                            const double _r  = sqrt(r2);
-                            const double r3inv = 1./(r2*_r);
-                            const double r5inv = 3.*r3inv/r2;
-                            const double ddx = particles_var1[0].x;
-                            const double ddy = particles_var1[0].y;
-                            const double ddz = particles_var1[0].z;
-                            const double Gmj = G * particles[j].m;
+/**
+ * @brief Direct summation of the second order and of the test particle variational equations.
+ */
+static void reb_calculate_acceleration_var_other(struct reb_simulation* r){
+    struct reb_particle* const particles = r->particles;
+    const double G = r->G;
+    const unsigned int _gravity_ignore_terms = r->gravity_ignore_terms;
+    const int N = r->N;
+    const int _N_real   = N - r->N_var;
+    for (int v=0;v<r->var_config_N;v++){
+        struct reb_variational_configuration const vc = r->var_config[v];
+        if (vc.order==1){
+            //////////////////
+            /// 1st order  ///
+            //////////////////
+            struct reb_particle* const particles_var1 = particles + vc.index;
+            if (vc.testparticle<0){
+                // Calculated in reb_calculate_acceleration_var1()
+            }else{ //testparticle
+                int i = vc.testparticle;
+                particles_var1[0].ax = 0.; 
+                particles_var1[0].ay = 0.; 
+                particles_var1[0].az = 0.; 
+                for (int j=0; j<_N_real; j++){
+                    if (i==j) continue;
+                    if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
+                    if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
+                    const double dx = particles[i].x - particles[j].x;
+                    const double dy = particles[i].y - particles[j].y;
+                    const double dz = particles[i].z - particles[j].z;
+                    const double r2 = dx*dx + dy*dy + dz*dz;
+                    const double _r  = sqrt(r2);
+                    const double r3inv = 1./(r2*_r);
+                    const double r5inv = 3.*r3inv/r2;
+                    const double ddx = particles_var1[0].x;
+                    const double ddy = particles_var1[0].y;
+                    const double ddz = particles_var1[0].z;
+                    const double Gmj = G * particles[j].m;
 
-                            // Variational equations
-                            const double dxdx = dx*dx*r5inv - r3inv;
-                            const double dydy = dy*dy*r5inv - r3inv;
-                            const double dzdz = dz*dz*r5inv - r3inv;
-                            const double dxdy = dx*dy*r5inv;
-                            const double dxdz = dx*dz*r5inv;
-                            const double dydz = dy*dz*r5inv;
-                            const double dax =   ddx * dxdx + ddy * dxdy + ddz * dxdz;
-                            const double day =   ddx * dxdy + ddy * dydy + ddz * dydz;
-                            const double daz =   ddx * dxdz + ddy * dydz + ddz * dzdz;
+                    // Variational equations
+                    const double dxdx = dx*dx*r5inv - r3inv;
+                    const double dydy = dy*dy*r5inv - r3inv;
+                    const double dzdz = dz*dz*r5inv - r3inv;
+                    const double dxdy = dx*dy*r5inv;
+                    const double dxdz = dx*dz*r5inv;
+                    const double dydz = dy*dz*r5inv;
+                    const double dax =   ddx * dxdx + ddy * dxdy + ddz * dxdz;
+                    const double day =   ddx * dxdy + ddy * dydy + ddz * dydz;
+                    const double daz =   ddx * dxdz + ddy * dydz + ddz * dzdz;
 
-                            // No variational mass contributions for test particles!
+                    // No variational mass contributions for test particles!
 
-                            particles_var1[0].ax += Gmj * dax;
-                            particles_var1[0].ay += Gmj * day;
-                            particles_var1[0].az += Gmj * daz;
+                    particles_var1[0].ax += Gmj * dax;
+                    particles_var1[0].ay += Gmj * day;
+                    particles_var1[0].az += Gmj * daz;
 
-                        }
-                    }
-                }else if (vc.order==2){
-                    //////////////////
-                    /// 2nd order  ///
-                    //////////////////
-                    struct reb_particle* const particles_var2 = particles + vc.index;
-                    struct reb_particle* const particles_var1a = particles + vc.index_1st_order_a;
-                    struct reb_particle* const particles_var1b = particles + vc.index_1st_order_b;
-                    if (vc.testparticle<0){
-                        for (int i=0; i<_N_real; i++){
-                            particles_var2[i].ax = 0.; 
-                            particles_var2[i].ay = 0.; 
-                            particles_var2[i].az = 0.; 
-                        }
-                        for (int i=0; i<_N_real; i++){
-                        for (int j=i+1; j<_N_real; j++){
-                            // TODO: Need to implement WH skipping
-                            //if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
-                            //if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
-                            const double dx = particles[i].x - particles[j].x;
-                            const double dy = particles[i].y - particles[j].y;
-                            const double dz = particles[i].z - particles[j].z;
-                            const double r2 = dx*dx + dy*dy + dz*dz;
-                            const double r  = sqrt(r2);
-                            const double r3inv = 1./(r2*r);
-                            const double r5inv = r3inv/r2;
-                            const double r7inv = r5inv/r2;
-                            const double ddx = particles_var2[i].x - particles_var2[j].x;
-                            const double ddy = particles_var2[i].y - particles_var2[j].y;
-                            const double ddz = particles_var2[i].z - particles_var2[j].z;
-                            const double Gmi = G * particles[i].m;
-                            const double Gmj = G * particles[j].m;
-                            const double ddGmi = G*particles_var2[i].m;
-                            const double ddGmj = G*particles_var2[j].m;
-                            
-                            // Variational equations
-                            // delta^(2) terms
-                            double dax =         ddx * ( 3.*dx*dx*r5inv - r3inv )
-                                       + ddy * ( 3.*dx*dy*r5inv )
-                                       + ddz * ( 3.*dx*dz*r5inv );
-                            double day =         ddx * ( 3.*dy*dx*r5inv )
-                                       + ddy * ( 3.*dy*dy*r5inv - r3inv )
-                                       + ddz * ( 3.*dy*dz*r5inv );
-                            double daz =         ddx * ( 3.*dz*dx*r5inv )
-                                       + ddy * ( 3.*dz*dy*r5inv )
-                                       + ddz * ( 3.*dz*dz*r5inv - r3inv );
-                            
-                            // delta^(1) delta^(1) terms
-                            const double dk1dx = particles_var1a[i].x - particles_var1a[j].x;
-                            const double dk1dy = particles_var1a[i].y - particles_var1a[j].y;
-                            const double dk1dz = particles_var1a[i].z - particles_var1a[j].z;
-                            const double dk2dx = particles_var1b[i].x - particles_var1b[j].x;
-                            const double dk2dy = particles_var1b[i].y - particles_var1b[j].y;
-                            const double dk2dz = particles_var1b[i].z - particles_var1b[j].z;
+                }
+            }
+        }else if (vc.order==2){
+            //////////////////
+            /// 2nd order  ///
+            //////////////////
+            struct reb_particle* const particles_var2 = particles + vc.index;
+            struct reb_particle* const particles_var1a = particles + vc.index_1st_order_a;
+            struct reb_particle* const particles_var1b = particles + vc.index_1st_order_b;
+            if (vc.testparticle<0){
+                for (int i=0; i<_N_real; i++){
+                    particles_var2[i].ax = 0.; 
+                    particles_var2[i].ay = 0.; 
+                    particles_var2[i].az = 0.; 
+                }
+                for (int i=0; i<_N_real; i++){
+                for (int j=i+1; j<_N_real; j++){
+                    // TODO: Need to implement WH skipping
+                    //if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
+                    //if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
+                    const double dx = particles[i].x - particles[j].x;
+                    const double dy = particles[i].y - particles[j].y;
+                    const double dz = particles[i].z - particles[j].z;
+                    const double r2 = dx*dx + dy*dy + dz*dz;
+                    const double r  = sqrt(r2);
+                    const double r3inv = 1./(r2*r);
+                    const double r5inv = r3inv/r2;
+                    const double r7inv = r5inv/r2;
+                    const double ddx = particles_var2[i].x - particles_var2[j].x;
+                    const double ddy = particles_var2[i].y - particles_var2[j].y;
+                    const double ddz = particles_var2[i].z - particles_var2[j].z;
+                    const double Gmi = G * particles[i].m;
+                    const double Gmj = G * particles[j].m;
+                    const double ddGmi = G*particles_var2[i].m;
+                    const double ddGmj = G*particles_var2[j].m;
+                    
+                    // Variational equations
+                    // delta^(2) terms
+                    double dax =         ddx * ( 3.*dx*dx*r5inv - r3inv )
+                               + ddy * ( 3.*dx*dy*r5inv )
+                               + ddz * ( 3.*dx*dz*r5inv );
+                    double day =         ddx * ( 3.*dy*dx*r5inv )
+                               + ddy * ( 3.*dy*dy*r5inv - r3inv )
+                               + ddz * ( 3.*dy*dz*r5inv );
+                    double daz =         ddx * ( 3.*dz*dx*r5inv )
+                               + ddy * ( 3.*dz*dy*r5inv )
+                               + ddz * ( 3.*dz*dz*r5inv - r3inv );
+                    
+                    // delta^(1) delta^(1) terms
+                    const double dk1dx = particles_var1a[i].x - particles_var1a[j].x;
+                    const double dk1dy = particles_var1a[i].y - particles_var1a[j].y;
+                    const double dk1dz = particles_var1a[i].z - particles_var1a[j].z;
+                    const double dk2dx = particles_var1b[i].x - particles_var1b[j].x;
+                    const double dk2dy = particles_var1b[i].y - particles_var1b[j].y;
+                    const double dk2dz = particles_var1b[i].z - particles_var1b[j].z;
 
-                            const double rdk1 =  dx*dk1dx + dy*dk1dy + dz*dk1dz;
-                            const double rdk2 =  dx*dk2dx + dy*dk2dy + dz*dk2dz;
-                            const double dk1dk2 =  dk1dx*dk2dx + dk1dy*dk2dy + dk1dz*dk2dz;
-                            dax     +=        3.* r5inv * dk2dx * rdk1
-                                    + 3.* r5inv * dk1dx * rdk2
-                                    + 3.* r5inv    * dx * dk1dk2  
-                                        - 15.      * dx * r7inv * rdk1 * rdk2;
-                            day     +=        3.* r5inv * dk2dy * rdk1
-                                    + 3.* r5inv * dk1dy * rdk2
-                                    + 3.* r5inv    * dy * dk1dk2  
-                                        - 15.      * dy * r7inv * rdk1 * rdk2;
-                            daz     +=        3.* r5inv * dk2dz * rdk1
-                                    + 3.* r5inv * dk1dz * rdk2
-                                    + 3.* r5inv    * dz * dk1dk2  
-                                        - 15.      * dz * r7inv * rdk1 * rdk2;
-                            
-                            const double dk1Gmi = G * particles_var1a[i].m;
-                            const double dk1Gmj = G * particles_var1a[j].m;
-                            const double dk2Gmi = G * particles_var1b[i].m;
-                            const double dk2Gmj = G * particles_var1b[j].m;
+                    const double rdk1 =  dx*dk1dx + dy*dk1dy + dz*dk1dz;
+                    const double rdk2 =  dx*dk2dx + dy*dk2dy + dz*dk2dz;
+                    const double dk1dk2 =  dk1dx*dk2dx + dk1dy*dk2dy + dk1dz*dk2dz;
+                    dax     +=        3.* r5inv * dk2dx * rdk1
+                            + 3.* r5inv * dk1dx * rdk2
+                            + 3.* r5inv    * dx * dk1dk2  
+                                - 15.      * dx * r7inv * rdk1 * rdk2;
+                    day     +=        3.* r5inv * dk2dy * rdk1
+                            + 3.* r5inv * dk1dy * rdk2
+                            + 3.* r5inv    * dy * dk1dk2  
+                                - 15.      * dy * r7inv * rdk1 * rdk2;
+                    daz     +=        3.* r5inv * dk2dz * rdk1
+                            + 3.* r5inv * dk1dz * rdk2
+                            + 3.* r5inv    * dz * dk1dk2  
+                                - 15.      * dz * r7inv * rdk1 * rdk2;
+                    
+                    const double dk1Gmi = G * particles_var1a[i].m;
+                    const double dk1Gmj = G * particles_var1a[j].m;
+                    const double dk2Gmi = G * particles_var1b[i].m;
+                    const double dk2Gmj = G * particles_var1b[j].m;
 
-                            particles_var2[i].ax += Gmj * dax 
-                                - ddGmj*r3inv*dx 
-                                - dk2Gmj*r3inv*dk1dx + 3.*dk2Gmj*r5inv*dx*rdk1
-                                - dk1Gmj*r3inv*dk2dx + 3.*dk1Gmj*r5inv*dx*rdk2;
-                            particles_var2[i].ay += Gmj * day 
-                                - ddGmj*r3inv*dy
-                                - dk2Gmj*r3inv*dk1dy + 3.*dk2Gmj*r5inv*dy*rdk1
-                                - dk1Gmj*r3inv*dk2dy + 3.*dk1Gmj*r5inv*dy*rdk2;
-                            particles_var2[i].az += Gmj * daz 
-                                - ddGmj*r3inv*dz
-                                - dk2Gmj*r3inv*dk1dz + 3.*dk2Gmj*r5inv*dz*rdk1
-                                - dk1Gmj*r3inv*dk2dz + 3.*dk1Gmj*r5inv*dz*rdk2;
-                                                                                 
-                            particles_var2[j].ax -= Gmi * dax 
-                                - ddGmi*r3inv*dx
-                                - dk2Gmi*r3inv*dk1dx + 3.*dk2Gmi*r5inv*dx*rdk1
-                                - dk1Gmi*r3inv*dk2dx + 3.*dk1Gmi*r5inv*dx*rdk2;
-                            particles_var2[j].ay -= Gmi * day 
-                                - ddGmi*r3inv*dy
-                                - dk2Gmi*r3inv*dk1dy + 3.*dk2Gmi*r5inv*dy*rdk1
-                                - dk1Gmi*r3inv*dk2dy + 3.*dk1Gmi*r5inv*dy*rdk2;
-                            particles_var2[j].az -= Gmi * daz 
-                                - ddGmi*r3inv*dz
-                                - dk2Gmi*r3inv*dk1dz + 3.*dk2Gmi*r5inv*dz*rdk1
-                                - dk1Gmi*r3inv*dk2dz + 3.*dk1Gmi*r5inv*dz*rdk2;
-                        }
-                        }
-                    }else{ //testparticle
-                        int i = vc.testparticle;
-                        particles_var2[0].ax = 0.; 
-                        particles_var2[0].ay = 0.; 
-                        particles_var2[0].az = 0.; 
-                        for (int j=0; j<_N_real; j++){
-                            if (i==j) continue;
-                            // TODO: Need to implement WH skipping
-                            //if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
-                            //if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
-                            const double dx = particles[i].x - particles[j].x;
-                            const double dy = particles[i].y - particles[j].y;
-                            const double dz = particles[i].z - particles[j].z;
-                            const double r2 = dx*dx + dy*dy + dz*dz;
-                            const double r  = sqrt(r2);
-                            const double r3inv = 1./(r2*r);
-                            const double r5inv = r3inv/r2;
-                            const double r7inv = r5inv/r2;
-                            const double ddx = particles_var2[0].x;
-                            const double ddy = particles_var2[0].y;
-                            const double ddz = particles_var2[0].z;
-                            const double Gmj = G * particles[j].m;
-                            
-                            // Variational equations
-                            // delta^(2) terms
-                            double dax =         ddx * ( 3.*dx*dx*r5inv - r3inv )
-                                       + ddy * ( 3.*dx*dy*r5inv )
-                                       + ddz * ( 3.*dx*dz*r5inv );
-                            double day =         ddx * ( 3.*dy*dx*r5inv )
-                                       + ddy * ( 3.*dy*dy*r5inv - r3inv )
-                                       + ddz * ( 3.*dy*dz*r5inv );
-                            double daz =         ddx * ( 3.*dz*dx*r5inv )
-                                       + ddy * ( 3.*dz*dy*r5inv )
-                                       + ddz * ( 3.*dz*dz*r5inv - r3inv );
-                            
-                            // delta^(1) delta^(1) terms
-                            const double dk1dx = particles_var1a[0].x;
-                            const double dk1dy = particles_var1a[0].y;
-                            const double dk1dz = particles_var1a[0].z;
-                            const double dk2dx = particles_var1b[0].x;
-                            const double dk2dy = particles_var1b[0].y;
-                            const double dk2dz = particles_var1b[0].z;
+                    particles_var2[i].ax += Gmj * dax 
+                        - ddGmj*r3inv*dx 
+                        - dk2Gmj*r3inv*dk1dx + 3.*dk2Gmj*r5inv*dx*rdk1
+                        - dk1Gmj*r3inv*dk2dx + 3.*dk1Gmj*r5inv*dx*rdk2;
+                    particles_var2[i].ay += Gmj * day 
+                        - ddGmj*r3inv*dy
+                        - dk2Gmj*r3inv*dk1dy + 3.*dk2Gmj*r5inv*dy*rdk1
+                        - dk1Gmj*r3inv*dk2dy + 3.*dk1Gmj*r5inv*dy*rdk2;
+                    particles_var2[i].az += Gmj * daz 
+                        - ddGmj*r3inv*dz
+                        - dk2Gmj*r3inv*dk1dz + 3.*dk2Gmj*r5inv*dz*rdk1
+                        - dk1Gmj*r3inv*dk2dz + 3.*dk1Gmj*r5inv*dz*rdk2;
+                                                                         
+                    particles_var2[j].ax -= Gmi * dax 
+                        - ddGmi*r3inv*dx
+                        - dk2Gmi*r3inv*dk1dx + 3.*dk2Gmi*r5inv*dx*rdk1
+                        - dk1Gmi*r3inv*dk2dx + 3.*dk1Gmi*r5inv*dx*rdk2;
+                    particles_var2[j].ay -= Gmi * day 
+                        - ddGmi*r3inv*dy
+                        - dk2Gmi*r3inv*dk1dy + 3.*dk2Gmi*r5inv*dy*rdk1
+                        - dk1Gmi*r3inv*dk2dy + 3.*dk1Gmi*r5inv*dy*rdk2;
+                    particles_var2[j].az -= Gmi * daz 
+                        - ddGmi*r3inv*dz
+                        - dk2Gmi*r3inv*dk1dz + 3.*dk2Gmi*r5inv*dz*rdk1
+                        - dk1Gmi*r3inv*dk2dz + 3.*dk1Gmi*r5inv*dz*rdk2;
+                }
+                }
+            }else{ //testparticle
+                int i = vc.testparticle;
+                particles_var2[0].ax = 0.; 
+                particles_var2[0].ay = 0.; 
+                particles_var2[0].az = 0.; 
+                for (int j=0; j<_N_real; j++){
+                    if (i==j) continue;
+                    // TODO: Need to implement WH skipping
+                    //if (_gravity_ignore_terms==1 && ((j==1 && i==0) || (i==1 && j==0))) continue;
+                    //if (_gravity_ignore_terms==2 && ((j==0 || i==0))) continue;
+                    const double dx = particles[i].x - particles[j].x;
+                    const double dy = particles[i].y - particles[j].y;
+                    const double dz = particles[i].z - particles[j].z;
+                    const double r2 = dx*dx + dy*dy + dz*dz;
+                    const double r  = sqrt(r2);
+                    const double r3inv = 1./(r2*r);
+                    const double r5inv = r3inv/r2;
+                    const double r7inv = r5inv/r2;
+                    const double ddx = particles_var2[0].x;
+                    const double ddy = particles_var2[0].y;
+                    const double ddz = particles_var2[0].z;
+                    const double Gmj = G * particles[j].m;
+                    
+                    // Variational equations
+                    // delta^(2) terms
+                    double dax =         ddx * ( 3.*dx*dx*r5inv - r3inv )
+                               + ddy * ( 3.*dx*dy*r5inv )
+                               + ddz * ( 3.*dx*dz*r5inv );
+                    double day =         ddx * ( 3.*dy*dx*r5inv )
+                               + ddy * ( 3.*dy*dy*r5inv - r3inv )
+                               + ddz * ( 3.*dy*dz*r5inv );
+                    double daz =         ddx * ( 3.*dz*dx*r5inv )
+                               + ddy * ( 3.*dz*dy*r5inv )
+                               + ddz * ( 3.*dz*dz*r5inv - r3inv );
+                    
+                    // delta^(1) delta^(1) terms
+                    const double dk1dx = particles_var1a[0].x;
+                    const double dk1dy = particles_var1a[0].y;
+                    const double dk1dz = particles_var1a[0].z;
+                    const double dk2dx = particles_var1b[0].x;
+                    const double dk2dy = particles_var1b[0].y;
+                    const double dk2dz = particles_var1b[0].z;
 
-                            const double rdk1 =  dx*dk1dx + dy*dk1dy + dz*dk1dz;
-                            const double rdk2 =  dx*dk2dx + dy*dk2dy + dz*dk2dz;
-                            const double dk1dk2 =  dk1dx*dk2dx + dk1dy*dk2dy + dk1dz*dk2dz;
-                            dax     +=        3.* r5inv * dk2dx * rdk1
-                                    + 3.* r5inv * dk1dx * rdk2
-                                    + 3.* r5inv    * dx * dk1dk2  
-                                        - 15.      * dx * r7inv * rdk1 * rdk2;
-                            day     +=        3.* r5inv * dk2dy * rdk1
-                                    + 3.* r5inv * dk1dy * rdk2
-                                    + 3.* r5inv    * dy * dk1dk2  
-                                        - 15.      * dy * r7inv * rdk1 * rdk2;
-                            daz     +=        3.* r5inv * dk2dz * rdk1
-                                    + 3.* r5inv * dk1dz * rdk2
-                                    + 3.* r5inv    * dz * dk1dk2  
-                                        - 15.      * dz * r7inv * rdk1 * rdk2;
-                            
-                            // No variational mass contributions for test particles!
+                    const double rdk1 =  dx*dk1dx + dy*dk1dy + dz*dk1dz;
+                    const double rdk2 =  dx*dk2dx + dy*dk2dy + dz*dk2dz;
+                    const double dk1dk2 =  dk1dx*dk2dx + dk1dy*dk2dy + dk1dz*dk2dz;
+                    dax     +=        3.* r5inv * dk2dx * rdk1
+                            + 3.* r5inv * dk1dx * rdk2
+                            + 3.* r5inv    * dx * dk1dk2  
+                                - 15.      * dx * r7inv * rdk1 * rdk2;
+                    day     +=        3.* r5inv * dk2dy * rdk1
+                            + 3.* r5inv * dk1dy * rdk2
+                            + 3.* r5inv    * dy * dk1dk2  
+                                - 15.      * dy * r7inv * rdk1 * rdk2;
+                    daz     +=        3.* r5inv * dk2dz * rdk1
+                            + 3.* r5inv * dk1dz * rdk2
+                            + 3.* r5inv    * dz * dk1dk2  
+                                - 15.      * dz * r7inv * rdk1 * rdk2;
+                    
+                    // No variational mass contributions for test particles!
 
-                            particles_var2[0].ax += Gmj * dax; 
-                            particles_var2[0].ay += Gmj * day;
-                            particles_var2[0].az += Gmj * daz;
-                        }
-                    }
+                    particles_var2[0].ax += Gmj * dax; 
+                    particles_var2[0].ay += Gmj * day;
+                    particles_var2[0].az += Gmj * daz;
                 }
             }
+        }
+    }
+}
+
+void reb_calculate_acceleration_var(struct reb_simulation* r){
+    const int N = r->N;
+    const int _N_real   = N - r->N_var;
+    switch (r->gravity){
+        case REB_GRAVITY_NONE: // Do nothing.
+        break;
+        case REB_GRAVITY_COMPENSATED:
+        {
+            struct reb_vec3d* restrict const cs = r->gravity_cs;
+#pragma omp parallel for schedule(guided)
+            for (int i=_N_real; i<N; i++){
+                cs[i].x = 0.;
+                cs[i].y = 0.;
+                cs[i].z = 0.;
+            }
+        }
+        case REB_GRAVITY_BASIC:
+            reb_calculate_acceleration_var1(r, 0);
+            reb_calculate_acceleration_var_other(r);
             break;
         default:
             reb_exit("Variational gravity calculation not yet implemented.");
@@ -901,6 +1183,19 @@ void reb_calculate_acceleration_var(struct reb_simulation* r){
 
 }
 
+void reb_calculate_acceleration_and_var(struct reb_simulation* r){
+    if (r->N_var && r->gravity==REB_GRAVITY_BASIC && r->softening==0. && r->ri_ias15.activeN==0
+            && r->nghostx==0 && r->nghosty==0 && r->nghostz==0 && !r->gravity_mixed_precision){
+        reb_calculate_acceleration_var1(r, 1);
+        reb_calculate_acceleration_var_other(r);
+    }else{
+        reb_calculate_acceleration(r);
+        if (r->N_var){
+            reb_calculate_acceleration_var(r);
+        }
+    }
+}
+
 void reb_calculate_and_apply_jerk(struct reb_simulation* r, const double v){
     struct reb_particle* const particles = r->particles;
     const int N = r->N;
@@ -909,18 +1204,115 @@ void reb_calculate_and_apply_jerk(struct reb_simulation* r, const double v){
     const int _N_real   = N  - r->N_var;
     const int _N_active = ((N_active==-1)?_N_real:N_active);
     const int _testparticle_type   = r->testparticle_type;
-    const int starti = (r->gravity_ignore_terms==0)?1:2;
-    const int startj = (r->gravity_ignore_terms==2)?1:0;
+    const int _gravity_ignore_terms = r->gravity_ignore_terms;
+    const int starti = (_gravity_ignore_terms==0)?1:2;
+    const int startj = (_gravity_ignore_terms==2)?1:0;
     switch (r->gravity){
         case REB_GRAVITY_NONE: // Do nothing.
         break;
         case REB_GRAVITY_BASIC:
+#ifdef OPENMP
+            // Every thread only updates its own particles. Each pair is therefore calculated twice.
+            // All interactions between active particles
+#pragma omp parallel for schedule(guided)
+            for (int i=0; i<_N_active; i++){
+                for (int j=0; j<_N_active; j++){
+                    if (i==j) continue;
+                    // Same pairs as the loop over j<i with i>=starti and j>=startj
+                    if ((i>j?i:j)<starti || (i<j?i:j)<startj) continue;
+                    const double dx = particles[i].x - particles[j].x; 
+                    const double dy = particles[i].y - particles[j].y; 
+                    const double dz = particles[i].z - particles[j].z; 
+                    
+                    const double dax = particles[i].ax - particles[j].ax; 
+                    const double day = particles[i].ay - particles[j].ay; 
+                    const double daz = particles[i].az - particles[j].az; 
+
+                    const double dr = sqrt(dx*dx + dy*dy + dz*dz);
+                    const double alphasum = dax*dx+day*dy+daz*dz;
+                    const double prefact2 = 2.*v*G /(dr*dr*dr);
+                    const double prefact2i = prefact2*particles[j].m;
+                    const double prefact1 = alphasum*prefact2/dr *3./dr;
+                    const double prefact1i = prefact1*particles[j].m;
+                    particles[i].vx    += dx*prefact1i - dax*prefact2i;
+                    particles[i].vy    += dy*prefact1i - day*prefact2i;
+                    particles[i].vz    += dz*prefact1i - daz*prefact2i;
+                }
+            }
+            // Interactions of test particles with active particles and other test particles
+            // (same pairs as the loop over j<i without OpenMP)
+#pragma omp parallel for schedule(guided)
+            for (int i=_N_active; i<_N_real; i++){
+                for (int j=startj; j<i; j++){
+                    const double dx = particles[i].x - particles[j].x; 
+                    const double dy = particles[i].y - particles[j].y; 
+                    const double dz = particles[i].z - particles[j].z; 
+                    
+                    const double dax = particles[i].ax - particles[j].ax; 
+                    const double day = particles[i].ay - particles[j].ay; 
+                    const double daz = particles[i].az - particles[j].az; 
+
+                    const double dr = sqrt(dx*dx + dy*dy + dz*dz);
+                    const double alphasum = dax*dx+day*dy+daz*dz;
+                    const double prefact2 = 2.*v*G /(dr*dr*dr);
+                    const double prefact1 = alphasum*prefact2/dr *3./dr;
+                    const double prefact1i = prefact1*particles[j].m;
+                    const double prefact2i = prefact2*particles[j].m;
+                    particles[i].vx    += dx*prefact1i - dax*prefact2i;
+                    particles[i].vy    += dy*prefact1i - day*prefact2i;
+                    particles[i].vz    += dz*prefact1i - daz*prefact2i;
+                }
+                if (_testparticle_type){
+                    // Test particles with a larger index
+                    for (int k=i+1; k<_N_real; k++){
+                        const double dx = particles[k].x - particles[i].x; 
+                        const double dy = particles[k].y - particles[i].y; 
+                        const double dz = particles[k].z - particles[i].z; 
+                        
+                        const double dax = particles[k].ax - particles[i].ax; 
+                        const double day = particles[k].ay - particles[i].ay; 
+                        const double daz = particles[k].az - particles[i].az; 
+
+                        const double dr = sqrt(dx*dx + dy*dy + dz*dz);
+                        const double alphasum = dax*dx+day*dy+daz*dz;
+                        const double prefact2 = 2.*v*G /(dr*dr*dr);
+                        const double prefact1 = alphasum*prefact2/dr *3./dr;
+                        const double prefact1j = prefact1*particles[k].m;
+                        const double prefact2j = prefact2*particles[k].m;
+                        particles[i].vx    += dax*prefact2j - dx*prefact1j;
+                        particles[i].vy    += day*prefact2j - dy*prefact1j;
+                        particles[i].vz    += daz*prefact2j - dz*prefact1j;
+                    }
+                }
+            }
+            if (_testparticle_type){
+#pragma omp parallel for schedule(guided)
+                for (int j=startj; j<_N_active; j++){
+                    for (int i=_N_active; i<_N_real; i++){
+                        const double dx = particles[i].x - particles[j].x; 
+                        const double dy = particles[i].y - particles[j].y; 
+                        const double dz = particles[i].z - particles[j].z; 
+                        
+                        const double dax = particles[i].ax - particles[j].ax; 
+                        const double day = particles[i].ay - particles[j].ay; 
+                        const double daz = particles[i].az - particles[j].az; 
+
+                        const double dr = sqrt(dx*dx + dy*dy + dz*dz);
+                        const double alphasum = dax*dx+day*dy+daz*dz;
+                        const double prefact2 = 2.*v*G /(dr*dr*dr);
+                        const double prefact1 = alphasum*prefact2/dr *3./dr;
+                        const double prefact1j = prefact1*particles[i].m;
+                        const double prefact2j = prefact2*particles[i].m;
+                        particles[j].vx    += dax*prefact2j - dx*prefact1j;
+                        particles[j].vy    += day*prefact2j - dy*prefact1j;
+                        particles[j].vz    += daz*prefact2j - dz*prefact1j;
+                    }
+                }
+            }
+#else // OPENMP
             // All interactions between active particles
-#pragma omp parallel for
             for (int i=starti; i<_N_active; i++){
-#ifndef OPENMP
                 if (reb_sigint) return;
-#endif // OPENMP
                 for (int j=startj; j<i; j++){
                     const double dx = particles[i].x - particles[j].x; 
                     const double dy = particles[i].y - particles[j].y; 
@@ -947,11 +1339,8 @@ void reb_calculate_and_apply_jerk(struct reb_simulation* r, const double v){
                 }
             }
             // Interactions between active particles and test particles
-#pragma omp parallel for
             for (int i=_N_active; i<_N_real; i++){
-#ifndef OPENMP
                 if (reb_sigint) return;
-#endif // OPENMP
                 for (int j=startj; j<i; j++){
                     const double dx = particles[i].x - particles[j].x; 
                     const double dy = particles[i].y - particles[j].y; 
@@ -979,6 +1368,7 @@ void reb_calculate_and_apply_jerk(struct reb_simulation* r, const double v){
                     }
                 }
             }
+#endif // OPENMP
             break;
         default:
             reb_error(r,"Jerk calculation only supported for BASIC gravity routine.");
@@ -986,6 +1376,77 @@ void reb_calculate_and_apply_jerk(struct reb_simulation* r, const double v){
     }
 }
 
+// Helper routines for mixed precision
+
+#define REB_GRAVITY_MIXED_BLOCK 128   ///< Number of active particles processed together in the mixed precision force calculation
+
+static void reb_calculate_acceleration_mixed_sources(struct reb_simulation* const r, const int N_active){
+    if (r->gravity_mixed_sources_allocatedN<N_active){
+        r->gravity_mixed_sources = realloc(r->gravity_mixed_sources,4*N_active*sizeof(double));
+        r->gravity_mixed_sources_allocatedN = N_active;
+    }
+    const struct reb_particle* const particles = r->particles;
+    double* const restrict sources = r->gravity_mixed_sources;
+    const double G = r->G;
+    for (int j=0; j<N_active; j++){
+        sources[j]            = particles[j].x;
+        sources[N_active+j]   = particles[j].y;
+        sources[2*N_active+j] = particles[j].z;
+        sources[3*N_active+j] = G*particles[j].m;
+    }
+}
+
+static void reb_calculate_acceleration_testparticle_mixed(struct reb_simulation* const r, const int i, const struct reb_ghostbox gb, const int startj, const int N_active, const int backreaction){
+    struct reb_particle* const particles = r->particles;
+    const double* const restrict xs  = r->gravity_mixed_sources;
+    const double* const restrict ys  = xs + N_active;
+    const double* const restrict zs  = xs + 2*N_active;
+    const double* const restrict Gms = xs + 3*N_active;
+    const float softening2 = r->softening*r->softening;
+    const float Gmi = r->G*particles[i].m;
+    const double xi = gb.shiftx+particles[i].x;
+    const double yi = gb.shifty+particles[i].y;
+    const double zi = gb.shiftz+particles[i].z;
+    double ax = 0.;
+    double ay = 0.;
+    double az = 0.;
+    for (int jb=startj; jb<N_active; jb+=REB_GRAVITY_MIXED_BLOCK){
+        const int n = N_active-jb < REB_GRAVITY_MIXED_BLOCK ? N_active-jb : REB_GRAVITY_MIXED_BLOCK;
+        float dx[REB_GRAVITY_MIXED_BLOCK];
+        float dy[REB_GRAVITY_MIXED_BLOCK];
+        float dz[REB_GRAVITY_MIXED_BLOCK];
+        float r2i[REB_GRAVITY_MIXED_BLOCK];
+        float rinv[REB_GRAVITY_MIXED_BLOCK];
+        // Differences are taken in double precision, everything else is single precision.
+        // This loop does not depend on the accumulation order and can be vectorized.
+        for (int k=0; k<n; k++){
+            dx[k] = xi - xs[jb+k];
+            dy[k] = yi - ys[jb+k];
+            dz[k] = zi - zs[jb+k];
+            r2i[k] = 1.f/(dx[k]*dx[k] + dy[k]*dy[k] + dz[k]*dz[k] + softening2);
+            rinv[k] = sqrtf(r2i[k]);
+        }
+        // G*m is multiplied first to avoid underflows at large distances.
+        for (int k=0; k<n; k++){
+            const float prefactj = (float)Gms[jb+k]*r2i[k]*rinv[k];
+            ax -= prefactj*dx[k];
+            ay -= prefactj*dy[k];
+            az -= prefactj*dz[k];
+        }
+        if (backreaction){
+            for (int k=0; k<n; k++){
+                const float prefacti = Gmi*r2i[k]*rinv[k];
+                particles[jb+k].ax += prefacti*dx[k];
+                particles[jb+k].ay += prefacti*dy[k];
+                particles[jb+k].az += prefacti*dz[k];
+            }
+        }
+    }
+    particles[i].ax += ax;
+    particles[i].ay += ay;
+    particles[i].az += az;
+}
+
 // Helper routines for REB_GRAVITY_TREE
 
 
@@ -1025,6 +1486,19 @@ static void reb_calculate_acceleration_for_particle_from_cell(const struct reb_s
                 }
             }
         } else {
+#ifndef QUADRUPOLE
+            if (r->gravity_mixed_precision){
+                // Far field. Single precision, double precision accumulation.
+                const float dxf = dx;
+                const float dyf = dy;
+                const float dzf = dz;
+                const float prefactf = -reb_gravity_prefact_float(dxf*dxf + dyf*dyf + dzf*dzf + (float)softening2, (float)G*(float)node->m);
+                particles[pt].ax += prefactf*dxf; 
+                particles[pt].ay += prefactf*dyf; 
+                particles[pt].az += prefactf*dzf; 
+                return;
+            }
+#endif // QUADRUPOLE
             double _r = sqrt(r2 + softening2);
             double prefact = -G/(_r*_r*_r)*node->m;
 #ifdef QUADRUPOLE
@@ -38,6 +38,13 @@ void reb_calculate_acceleration(struct reb_simulation* r);
   */
 void reb_calculate_acceleration_var(struct reb_simulation* r);
 
+/**
+  * Calculates the acceleration of the real and of the variational particles.
+  * For direct summation without ghost boxes and softening, the first order variational 
+  * equations share the pair geometry with the gravity calculation of the real particles.
+  */
+void reb_calculate_acceleration_and_var(struct reb_simulation* r);
+
 
 /**
   * The function calculates the jerk (derivative of the acceleration) and applies it to the particles' velocity.
@@ -29,6 +29,7 @@
 #include <time.h>
 #include <getopt.h>
 #include <string.h>
+#include <errno.h>
 #include "particle.h"
 #include "rebound.h"
 #include "collision.h"
@@ -177,6 +178,7 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
         CASE(TESTPARTICLETYPE,   &r->testparticle_type);
         CASE(HASHCTR,            &r->hash_ctr);
         CASE(OPENINGANGLE2,      &r->opening_angle2);
+        CASE(GRAVITYMIXEDPRECISION, &r->gravity_mixed_precision);
         CASE(STATUS,             &r->status);
         CASE(EXACTFINISHTIME,    &r->exact_finish_time);
         CASE(FORCEISVELOCITYDEP, &r->force_is_velocity_dependent);
@@ -211,6 +213,11 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
         CASE(MEGNOMEANT,         &r->megno_mean_t);
         CASE(MEGNOMEANY,         &r->megno_mean_Y);
         CASE(MEGNON,             &r->megno_n);
+        CASE(LYAPUNOVSPECTRUMN,  &r->lyapunov_spectrum_N);
+        CASE(LYAPUNOVSPECTRUMVARCONFIG, &r->lyapunov_spectrum_var_config);
+        CASE(LYAPUNOVSPECTRUMINTERVAL, &r->lyapunov_spectrum_interval);
+        CASE(LYAPUNOVSPECTRUMT0, &r->lyapunov_spectrum_t0);
+        CASE(LYAPUNOVSPECTRUMTLAST, &r->lyapunov_spectrum_t_last);
         CASE(SAVERSION,          &r->simulationarchive_version);
         CASE(SASIZEFIRST,        &r->simulationarchive_size_first);
         CASE(SASIZESNAPSHOT,     &r->simulationarchive_size_snapshot);
@@ -258,6 +265,9 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
         CASE(STEPSDONE,          &r->steps_done);
         CASE(SAAUTOSTEP,         &r->simulationarchive_auto_step);
         CASE(SANEXTSTEP,         &r->simulationarchive_next_step);
+        CASE(SAINDEX,            &r->simulationarchive_index);
+        CASE(SAASYNC,            &r->simulationarchive_async);
+        CASE(SACOMPRESS,         &r->simulationarchive_compress);
         CASE(SABA_TYPE,          &r->ri_saba.type);
         CASE(SABA_KEEPUNSYNC,    &r->ri_saba.keep_unsynchronized);
         CASE(EOS_PHI0,           &r->ri_eos.phi0);
@@ -265,6 +275,10 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
         CASE(EOS_N,              &r->ri_eos.n);
         CASE(EOS_SAFEMODE,       &r->ri_eos.safe_mode);
         CASE(EOS_ISSYNCHRON,     &r->ri_eos.is_synchronized);
+        CASE(IAS15_BLOCKLEVELS,  &r->ri_ias15.block_levels);
+        CASE(IAS15_PCTOLERANCE,  &r->ri_ias15.pc_tolerance);
+        CASE(IAS15_PCTOLERANCEEPSILON, &r->ri_ias15.pc_tolerance_epsilon);
+        CASE(IAS15_PCITERATIONSMAX, &r->ri_ias15.pc_iterations_max);
         // temporary solution for depreciated SABA k and corrector variables.
         // can be removed in future versions
         case 138: 
@@ -288,6 +302,11 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
         CASE(SABA_ISSYNCHRON,    &r->ri_saba.is_synchronized);
         CASE(WHFAST_CORRECTOR2,  &r->ri_whfast.corrector2);
         CASE(WHFAST_KERNEL,      &r->ri_whfast.kernel);
+        CASE(WHFAST_COMPENSATED, &r->ri_whfast.compensated);
+        CASE(WHFAST_SUBSTEPSMAX, &r->ri_whfast.substeps_max);
+        CASE(WHFAST_SUBSTEPSETA, &r->ri_whfast.substeps_eta);
+        CASE(WHFAST_TCS,         &r->ri_whfast.t_cs);
+        CASE(WHFAST_TLAST,       &r->ri_whfast.t_last);
         case REB_BINARY_FIELD_TYPE_PARTICLES:
             if(r->particles){
                 free(r->particles);
@@ -311,6 +330,30 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
                 }
             }
             break;
+        case REB_BINARY_FIELD_TYPE_PARTICLESDELTA:
+            {
+                // Only the particles which changed, each preceded by its index
+                const size_t size_entry = sizeof(uint32_t)+sizeof(struct reb_particle);
+                const size_t Ndelta = field.size/size_entry;
+                for (size_t l=0;l<Ndelta;l++){
+                    uint32_t index;
+                    struct reb_particle p;
+                    reb_fread(&index, sizeof(uint32_t),1,inf,mem_stream);
+                    reb_fread(&p, sizeof(struct reb_particle),1,inf,mem_stream);
+                    if (index>=(uint32_t)r->N || index>=(uint32_t)r->allocatedN){
+                        if (warnings){
+                            *warnings |= REB_INPUT_BINARY_WARNING_PARTICLES;
+                        }
+                        continue;
+                    }
+                    p.c = r->particles[index].c;
+                    p.ap = NULL;
+                    p.sim = r;
+                    r->particles[index] = p;
+                }
+                reb_fseek(inf,field.size-Ndelta*size_entry,SEEK_CUR,mem_stream);
+            }
+            break;
         case REB_BINARY_FIELD_TYPE_WHFAST_PJ:
             if(r->ri_whfast.p_jh){
                 free(r->ri_whfast.p_jh);
@@ -321,6 +364,16 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
                 reb_fread(r->ri_whfast.p_jh, field.size,1,inf,mem_stream);
             }
             break;
+        case REB_BINARY_FIELD_TYPE_WHFAST_PJCS:
+            if(r->ri_whfast.p_jh_cs){
+                free(r->ri_whfast.p_jh_cs);
+            }
+            r->ri_whfast.allocated_N_cs = (int)(field.size/(6*sizeof(double)));
+            if (field.size){
+                r->ri_whfast.p_jh_cs = malloc(field.size);
+                reb_fread(r->ri_whfast.p_jh_cs, field.size,1,inf,mem_stream);
+            }
+            break;
         case REB_BINARY_FIELD_TYPE_JANUS_PINT:
             if(r->ri_janus.p_int){
                 free(r->ri_janus.p_int);
@@ -343,6 +396,13 @@ int reb_input_field(struct reb_simulation* r, FILE* inf, enum reb_input_binary_m
                 }
             }
             break;
+        case REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMSUMS:
+            if (r->lyapunov_spectrum_sums){
+                free(r->lyapunov_spectrum_sums);
+            }
+            r->lyapunov_spectrum_sums = malloc(field.size);
+            reb_fread(r->lyapunov_spectrum_sums, field.size,1,inf,mem_stream);
+            break;
         case REB_BINARY_FIELD_TYPE_MERCURIUS_DCRIT:
             if(r->ri_mercurius.dcrit){
                 free(r->ri_mercurius.dcrit);
@@ -433,6 +493,11 @@ struct reb_simulation* reb_input_process_warnings(struct reb_simulation* r, enum
         if (r) free(r);
         return NULL;
     }
+    if (warnings & REB_INPUT_BINARY_ERROR_CORRUPT){
+        reb_error(r,"Binary file is corrupt. A field extends past the end of the file.");
+        if (r) reb_free_simulation(r);
+        return NULL;
+    }
     if (warnings & REB_INPUT_BINARY_WARNING_FIELD_UNKOWN){
         reb_warning(r,"Unknown field found in binary file.");
     }
@@ -444,6 +509,94 @@ struct reb_simulation* reb_input_process_warnings(struct reb_simulation* r, enum
     return r;
 }
 
+// Reads exactly size bytes from a file descriptor. Returns -1 on error or end of file.
+static int reb_input_read_fd(int fd, char* buf, size_t size){
+    size_t received = 0;
+    while (received<size){
+        const ssize_t n = read(fd, buf+received, size-received);
+        if (n<0 && errno==EINTR) continue;
+        if (n<=0) return -1;
+        received += n;
+    }
+    return 0;
+}
+
+// Makes sure buf can hold size bytes. Returns -1 if out of memory.
+static int reb_input_reserve(char** buf, size_t* allocatedsize, size_t size){
+    if (size<=*allocatedsize) return 0;
+    size_t newsize = *allocatedsize ? *allocatedsize : 1024;
+    while (newsize<size){
+        if (newsize>SIZE_MAX/2) return -1;
+        newsize *= 2;
+    }
+    char* newbuf = realloc(*buf, newsize);
+    if (newbuf==NULL) return -1;
+    *buf = newbuf;
+    *allocatedsize = newsize;
+    return 0;
+}
+
+void reb_create_simulation_from_fd_with_messages(struct reb_simulation* r, int fd, enum reb_input_binary_messages* warnings){
+    // Receive the binary one field at a time. The size of each field is known from its 
+    // header, so no data after the end of the binary is consumed.
+    const size_t size_header = 64;
+    char* buf = NULL;
+    size_t allocatedsize = 0;
+    size_t size = 0;
+    int error = reb_input_reserve(&buf, &allocatedsize, size_header) || reb_input_read_fd(fd, buf, size_header);
+    if (!error && strncmp(buf, "REBOUND Binary File", 19)!=0){
+        error = 1;
+    }
+    size = size_header;
+    while (!error){
+        struct reb_binary_field field;
+        if (reb_input_read_fd(fd, (char*)&field, sizeof(struct reb_binary_field))){
+            error = 1;
+            break;
+        }
+        // The binary ends with an END field followed by an (empty) SimulationArchive blob.
+        const size_t size_data = field.type==REB_BINARY_FIELD_TYPE_END ? sizeof(struct reb_simulationarchive_blob) : field.size;
+        if (size_data>SIZE_MAX-size-sizeof(struct reb_binary_field)
+                || reb_input_reserve(&buf, &allocatedsize, size+sizeof(struct reb_binary_field)+size_data)){
+            error = 1;
+            break;
+        }
+        memcpy(buf+size, &field, sizeof(struct reb_binary_field));
+        size += sizeof(struct reb_binary_field);
+        if (reb_input_read_fd(fd, buf+size, size_data)){
+            error = 1;
+            break;
+        }
+        size += size_data;
+        if (field.type==REB_BINARY_FIELD_TYPE_END){
+            break;
+        }
+    }
+    if (error){
+        free(buf);
+        *warnings |= REB_INPUT_BINARY_ERROR_NOFILE;
+        return;
+    }
+
+    reb_free_pointers(r);
+    memset(r,0,sizeof(struct reb_simulation));
+    reb_init_simulation(r);
+    r->simulationarchive_filename = NULL;
+    // Set to old version by default. Will be overwritten if new version was used.
+    r->simulationarchive_version = 0;
+    char* mem_stream = buf;
+    while(reb_input_field(r, NULL, warnings, &mem_stream)){ }
+    free(buf);
+}
+
+struct reb_simulation* reb_create_simulation_from_fd(int fd){
+    enum reb_input_binary_messages warnings = REB_INPUT_BINARY_WARNING_NONE;
+    struct reb_simulation* r = reb_create_simulation();
+    reb_create_simulation_from_fd_with_messages(r, fd, &warnings);
+    r = reb_input_process_warnings(r, warnings);
+    return r;
+}
+
 struct reb_simulation* reb_create_simulation_from_binary(char* filename){
     enum reb_input_binary_messages warnings = REB_INPUT_BINARY_WARNING_NONE;
     struct reb_simulation* r = reb_create_simulation();
@@ -170,10 +170,7 @@ void reb_update_acceleration(struct reb_simulation* r){
 	// This should probably go elsewhere
 	PROFILING_STOP(PROFILING_CAT_INTEGRATOR)
 	PROFILING_START()
-	reb_calculate_acceleration(r);
-	if (r->N_var){
-		reb_calculate_acceleration_var(r);
-	}
+	reb_calculate_acceleration_and_var(r);
 	if (r->additional_forces  && (r->integrator != REB_INTEGRATOR_MERCURIUS || r->ri_mercurius.mode==0)){
         // For Mercurius:
         // Additional forces are only calculated in the kick step, not during close encounter
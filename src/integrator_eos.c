@@ -37,20 +37,52 @@
 #define MIN(a, b) ((a) > (b) ? (b) : (a))    ///< Returns the minimum of a and b
 #define MAX(a, b) ((a) > (b) ? (a) : (b))    ///< Returns the maximum of a and b
 
-static const double lf4_a = 0.675603595979828817023843904485;
-
-static const double lf6_a[5] = {0.1867, 0.5554970237124784, 0.1294669489134754, -0.843265623387734, 0.9432033015235604};
-
-static const double lf8_a[9] = {0.128865979381443, 0.581514087105251, -0.410175371469850, 0.1851469357165877, -0.4095523434208514, 0.1444059410800120, 0.2783355003936797, 0.3149566839162949, -0.6269948254051343979}; 
-
-static const double lf4_2_a = 0.211324865405187117745425609749;
-
-static const double lf8_6_4_a[4] = {0.0711334264982231177779387300061549964174, 0.241153427956640098736487795326289649618, 0.521411761772814789212136078067994229991, -0.333698616227678005726562603400438876027};
-static const double lf8_6_4_b[4] = {0.183083687472197221961703757166430291072, 0.310782859898574869507522291054262796375, -0.0265646185119588006972121379164987592663, 0.0653961422823734184559721793911134363710};
-
-static const double pmlf6_a[2] = {-0.0682610383918630,0.568261038391863038121699}; 
-static const double pmlf6_b[2] = {0.2621129352517028, 0.475774129496594366806050}; 
-static const double pmlf6_c[2] = {0., 0.0164011128160783}; 
+// The coefficients are also defined as macros so that they can be used in the static
+// tables of reb_integrator_eos_coefficients().
+#define LF4_A 0.675603595979828817023843904485
+static const double lf4_a = LF4_A;
+
+#define LF6_A_0 0.1867
+#define LF6_A_1 0.5554970237124784
+#define LF6_A_2 0.1294669489134754
+#define LF6_A_3 (-0.843265623387734)
+#define LF6_A_4 0.9432033015235604
+static const double lf6_a[5] = {LF6_A_0, LF6_A_1, LF6_A_2, LF6_A_3, LF6_A_4};
+
+#define LF8_A_0 0.128865979381443
+#define LF8_A_1 0.581514087105251
+#define LF8_A_2 (-0.410175371469850)
+#define LF8_A_3 0.1851469357165877
+#define LF8_A_4 (-0.4095523434208514)
+#define LF8_A_5 0.1444059410800120
+#define LF8_A_6 0.2783355003936797
+#define LF8_A_7 0.3149566839162949
+#define LF8_A_8 (-0.6269948254051343979)
+static const double lf8_a[9] = {LF8_A_0, LF8_A_1, LF8_A_2, LF8_A_3, LF8_A_4, LF8_A_5, LF8_A_6, LF8_A_7, LF8_A_8};
+
+#define LF4_2_A 0.211324865405187117745425609749
+static const double lf4_2_a = LF4_2_A;
+
+#define LF8_6_4_A_0 0.0711334264982231177779387300061549964174
+#define LF8_6_4_A_1 0.241153427956640098736487795326289649618
+#define LF8_6_4_A_2 0.521411761772814789212136078067994229991
+#define LF8_6_4_A_3 (-0.333698616227678005726562603400438876027)
+static const double lf8_6_4_a[4] = {LF8_6_4_A_0, LF8_6_4_A_1, LF8_6_4_A_2, LF8_6_4_A_3};
+#define LF8_6_4_B_0 0.183083687472197221961703757166430291072
+#define LF8_6_4_B_1 0.310782859898574869507522291054262796375
+#define LF8_6_4_B_2 (-0.0265646185119588006972121379164987592663)
+#define LF8_6_4_B_3 0.0653961422823734184559721793911134363710
+static const double lf8_6_4_b[4] = {LF8_6_4_B_0, LF8_6_4_B_1, LF8_6_4_B_2, LF8_6_4_B_3};
+
+#define PMLF6_A_0 (-0.0682610383918630)
+#define PMLF6_A_1 0.568261038391863038121699
+static const double pmlf6_a[2] = {PMLF6_A_0, PMLF6_A_1};
+#define PMLF6_B_0 0.2621129352517028
+#define PMLF6_B_1 0.475774129496594366806050
+static const double pmlf6_b[2] = {PMLF6_B_0, PMLF6_B_1};
+#define PMLF6_C_0 0.
+#define PMLF6_C_1 0.0164011128160783
+static const double pmlf6_c[2] = {PMLF6_C_0, PMLF6_C_1};
 static const double pmlf6_z[6] = { 0.07943288242455420, 0.02974829169467665, -0.7057074964815896, 0.3190423451260838, -0.2869147334299646, 0.564398710666239478150885};
 static const double pmlf6_y[6] = {1.3599424487455264, -0.6505973747535132, -0.033542814598338416, -0.040129915275115030, 0.044579729809902803, -0.680252073928462652752103};
 static const double pmlf6_v[6] = {-0.034841228074994859, 0.031675672097525204, -0.005661054677711889, 0.004262222269023640, 0.005, -0.005};
@@ -58,8 +90,12 @@ static const double pmlf6_v[6] = {-0.034841228074994859, 0.031675672097525204, -
 static const double pmlf4_y[3] = {0.1859353996846055, 0.0731969797858114, -0.1576624269298081};
 static const double pmlf4_z[3] = {0.8749306155955435, -0.237106680151022, -0.5363539829039128};
 
-static const double plf7_6_4_a[2] = {0.5600879810924619,-0.060087981092461900000};
-static const double plf7_6_4_b[2] = {1.5171479707207228, -2.0342959414414456000};
+#define PLF7_6_4_A_0 0.5600879810924619
+#define PLF7_6_4_A_1 (-0.060087981092461900000)
+static const double plf7_6_4_a[2] = {PLF7_6_4_A_0, PLF7_6_4_A_1};
+#define PLF7_6_4_B_0 1.5171479707207228
+#define PLF7_6_4_B_1 (-2.0342959414414456000)
+static const double plf7_6_4_b[2] = {PLF7_6_4_B_0, PLF7_6_4_B_1};
 static const double plf7_6_4_z[6] = {-0.3346222298730800, 1.0975679907321640, -1.0380887460967830, 0.6234776317921379, -1.1027532063031910, -0.0141183222088869};
 static const double plf7_6_4_y[6] = {-1.6218101180868010, 0.0061709468110142, 0.8348493592472594, -0.0511253369989315, 0.5633782670698199, -0.5};
                 
@@ -74,6 +110,7 @@ static inline void reb_integrator_eos_interaction_shell0(struct reb_simulation*
     // Apply acceleration (jerk already applied)
     struct reb_particle* restrict const particles = r->particles;
     const int N = r->N;
+#pragma omp parallel for simd
     for (int i=0;i<N;i++){
         particles[i].vx += y*particles[i].ax;
         particles[i].vy += y*particles[i].ay;
@@ -81,7 +118,15 @@ static inline void reb_integrator_eos_interaction_shell0(struct reb_simulation*
     }
 }
 
-static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation* r, double y, double v){
+// The central object interacts with all other particles. Its own updates are accumulated 
+// in local variables so that the loops can be distributed among OpenMP threads. Without
+// OpenMP, the order of operations is the same as updating the central object directly.
+// These loops are not marked simd because a vectorized reduction would reorder the sums.
+// If drift is set, every particle is drifted by a directly after its kick. This is the 
+// same as calling reb_integrator_eos_drift_shell1() afterwards because the kick of one 
+// particle does not depend on the positions of other particles (except the central object,
+// which is drifted last). Variational particles are not supported in this case. 
+static inline void reb_integrator_eos_interaction_drift_shell1(struct reb_simulation* r, double y, double v, const int drift, const double a){
     const int N = r->N;
 	const int N_real   = N - r->N_var;
     const int N_active = r->N_active==-1?N_real:r->N_active;
@@ -89,142 +134,194 @@ static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation*
     struct reb_particle* restrict const particles = r->particles;
 
     const double G = r->G;
+    const double x0 = particles[0].x;
+    const double y0 = particles[0].y;
+    const double z0 = particles[0].z;
+    const double m0 = particles[0].m;
     
     if (v!=0.){ // is jerk even used?
         // Normal force calculation 
-        particles[0].ax = 0;
-        particles[0].ay = 0;
-        particles[0].az = 0;
+        double ax0 = 0;
+        double ay0 = 0;
+        double az0 = 0;
         // Interactions between central object and all other active particles
+#pragma omp parallel for reduction(+:ax0,ay0,az0)
         for (int j=1; j<N_active; j++){
-            const double dx = particles[0].x - particles[j].x;
-            const double dy = particles[0].y - particles[j].y;
-            const double dz = particles[0].z - particles[j].z;
+            const double dx = x0 - particles[j].x;
+            const double dy = y0 - particles[j].y;
+            const double dz = z0 - particles[j].z;
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
 
             const double prefact = G/(dr*dr*dr);
             const double prefactj = -prefact*particles[j].m;
-            particles[0].ax    += prefactj*dx;
-            particles[0].ay    += prefactj*dy;
-            particles[0].az    += prefactj*dz;
-            const double prefacti = prefact*particles[0].m;
+            ax0    += prefactj*dx;
+            ay0    += prefactj*dy;
+            az0    += prefactj*dz;
+            const double prefacti = prefact*m0;
             particles[j].ax    = prefacti*dx;
             particles[j].ay    = prefacti*dy;
             particles[j].az    = prefacti*dz;
         }
         // Interactions between central object and all test particles
+#pragma omp parallel for reduction(+:ax0,ay0,az0)
         for (int j=N_active; j<N_real; j++){
-            const double dx = particles[0].x - particles[j].x;
-            const double dy = particles[0].y - particles[j].y;
-            const double dz = particles[0].z - particles[j].z;
+            const double dx = x0 - particles[j].x;
+            const double dy = y0 - particles[j].y;
+            const double dz = z0 - particles[j].z;
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
 
             const double prefact = G/(dr*dr*dr);
-            const double prefacti = prefact*particles[0].m;
+            const double prefacti = prefact*m0;
             particles[j].ax    = prefacti*dx;
             particles[j].ay    = prefacti*dy;
             particles[j].az    = prefacti*dz;
             if (testparticle_type){
                 const double prefactj = -prefact*particles[j].m;
-                particles[0].ax    += prefactj*dx;
-                particles[0].ay    += prefactj*dy;
-                particles[0].az    += prefactj*dz;
+                ax0    += prefactj*dx;
+                ay0    += prefactj*dy;
+                az0    += prefactj*dz;
             }
         }
+        particles[0].ax = ax0;
+        particles[0].ay = ay0;
+        particles[0].az = az0;
         // Jerk calculation
+        double vx0 = particles[0].vx;
+        double vy0 = particles[0].vy;
+        double vz0 = particles[0].vz;
         // Interactions between central object and all other active particles
+#pragma omp parallel for reduction(+:vx0,vy0,vz0)
         for (int i=1; i<N_active; i++){
-            const double dx = particles[0].x - particles[i].x; 
-            const double dy = particles[0].y - particles[i].y; 
-            const double dz = particles[0].z - particles[i].z; 
+            const double dx = x0 - particles[i].x; 
+            const double dy = y0 - particles[i].y; 
+            const double dz = z0 - particles[i].z; 
             
-            const double dax = particles[0].ax - particles[i].ax; 
-            const double day = particles[0].ay - particles[i].ay; 
-            const double daz = particles[0].az - particles[i].az; 
+            const double dax = ax0 - particles[i].ax; 
+            const double day = ay0 - particles[i].ay; 
+            const double daz = az0 - particles[i].az; 
 
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
             const double alphasum = dax*dx+day*dy+daz*dz;
             const double prefact2 = 2.*v*G /(dr*dr*dr);
             const double prefact2i = prefact2*particles[i].m;
-            const double prefact2j = prefact2*particles[0].m;
+            const double prefact2j = prefact2*m0;
             const double prefact1 = alphasum*prefact2/dr *3./dr;
             const double prefact1i = prefact1*particles[i].m;
-            const double prefact1j = prefact1*particles[0].m;
-            particles[0].vx    += -dax*prefact2i + dx*prefact1i;
-            particles[0].vy    += -day*prefact2i + dy*prefact1i;
-            particles[0].vz    += -daz*prefact2i + dz*prefact1i;
+            const double prefact1j = prefact1*m0;
+            vx0    += -dax*prefact2i + dx*prefact1i;
+            vy0    += -day*prefact2i + dy*prefact1i;
+            vz0    += -daz*prefact2i + dz*prefact1i;
             particles[i].vx    += y*particles[i].ax + dax*prefact2j - dx*prefact1j;
             particles[i].vy    += y*particles[i].ay + day*prefact2j - dy*prefact1j;
             particles[i].vz    += y*particles[i].az + daz*prefact2j - dz*prefact1j;
+            if (drift){
+                particles[i].x += a*particles[i].vx;
+                particles[i].y += a*particles[i].vy;
+                particles[i].z += a*particles[i].vz;
+            }
         }
         // Interactions between central object and all test particles
+#pragma omp parallel for reduction(+:vx0,vy0,vz0)
         for (int i=N_active; i<N_real; i++){
-            const double dx = particles[0].x - particles[i].x; 
-            const double dy = particles[0].y - particles[i].y; 
-            const double dz = particles[0].z - particles[i].z; 
+            const double dx = x0 - particles[i].x; 
+            const double dy = y0 - particles[i].y; 
+            const double dz = z0 - particles[i].z; 
             
-            const double dax = particles[0].ax - particles[i].ax; 
-            const double day = particles[0].ay - particles[i].ay; 
-            const double daz = particles[0].az - particles[i].az; 
+            const double dax = ax0 - particles[i].ax; 
+            const double day = ay0 - particles[i].ay; 
+            const double daz = az0 - particles[i].az; 
 
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
             const double alphasum = dax*dx+day*dy+daz*dz;
             const double prefact2 = 2.*v*G /(dr*dr*dr);
-            const double prefact2j = prefact2*particles[0].m;
+            const double prefact2j = prefact2*m0;
             const double prefact1 = alphasum*prefact2/dr *3./dr;
-            const double prefact1j = prefact1*particles[0].m;
+            const double prefact1j = prefact1*m0;
             if (testparticle_type){
                 const double prefact2i = prefact2*particles[i].m;
                 const double prefact1i = prefact1*particles[i].m;
-                particles[0].vx    += -dax*prefact2i + dx*prefact1i;
-                particles[0].vy    += -day*prefact2i + dy*prefact1i;
-                particles[0].vz    += -daz*prefact2i + dz*prefact1i;
+                vx0    += -dax*prefact2i + dx*prefact1i;
+                vy0    += -day*prefact2i + dy*prefact1i;
+                vz0    += -daz*prefact2i + dz*prefact1i;
             }
             particles[i].vx    += y*particles[i].ax + dax*prefact2j - dx*prefact1j;
             particles[i].vy    += y*particles[i].ay + day*prefact2j - dy*prefact1j;
             particles[i].vz    += y*particles[i].az + daz*prefact2j - dz*prefact1j;
+            if (drift){
+                particles[i].x += a*particles[i].vx;
+                particles[i].y += a*particles[i].vy;
+                particles[i].z += a*particles[i].vz;
+            }
+        }
+        particles[0].vx = vx0 + y*ax0;
+        particles[0].vy = vy0 + y*ay0;
+        particles[0].vz = vz0 + y*az0;
+        if (drift){
+            particles[0].x += a*particles[0].vx;
+            particles[0].y += a*particles[0].vy;
+            particles[0].z += a*particles[0].vz;
         }
-        particles[0].vx += y*particles[0].ax;
-        particles[0].vy += y*particles[0].ay;
-        particles[0].vz += y*particles[0].az;
     }else{
         // Normal force calculation 
+        double vx0 = particles[0].vx;
+        double vy0 = particles[0].vy;
+        double vz0 = particles[0].vz;
         // Interactions between central object and all other active particles
+#pragma omp parallel for reduction(+:vx0,vy0,vz0)
         for (int j=1; j<N_active; j++){
-            const double dx = particles[0].x - particles[j].x;
-            const double dy = particles[0].y - particles[j].y;
-            const double dz = particles[0].z - particles[j].z;
+            const double dx = x0 - particles[j].x;
+            const double dy = y0 - particles[j].y;
+            const double dz = z0 - particles[j].z;
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
 
             const double prefact = y*G/(dr*dr*dr);
             const double prefactj = -prefact*particles[j].m;
-            particles[0].vx    += prefactj*dx;
-            particles[0].vy    += prefactj*dy;
-            particles[0].vz    += prefactj*dz;
-            const double prefacti = prefact*particles[0].m;
+            vx0    += prefactj*dx;
+            vy0    += prefactj*dy;
+            vz0    += prefactj*dz;
+            const double prefacti = prefact*m0;
             particles[j].vx    += prefacti*dx;
             particles[j].vy    += prefacti*dy;
             particles[j].vz    += prefacti*dz;
+            if (drift){
+                particles[j].x += a*particles[j].vx;
+                particles[j].y += a*particles[j].vy;
+                particles[j].z += a*particles[j].vz;
+            }
         }
         // Interactions between central object and all test particles
+#pragma omp parallel for reduction(+:vx0,vy0,vz0)
         for (int j=N_active; j<N_real; j++){
-            const double dx = particles[0].x - particles[j].x;
-            const double dy = particles[0].y - particles[j].y;
-            const double dz = particles[0].z - particles[j].z;
+            const double dx = x0 - particles[j].x;
+            const double dy = y0 - particles[j].y;
+            const double dz = z0 - particles[j].z;
             const double dr = sqrt(dx*dx + dy*dy + dz*dz);
 
             const double prefact = y*G/(dr*dr*dr);
-            const double prefacti = prefact*particles[0].m;
+            const double prefacti = prefact*m0;
             particles[j].vx    += prefacti*dx;
             particles[j].vy    += prefacti*dy;
             particles[j].vz    += prefacti*dz;
+            if (drift){
+                particles[j].x += a*particles[j].vx;
+                particles[j].y += a*particles[j].vy;
+                particles[j].z += a*particles[j].vz;
+            }
             if (testparticle_type){
                 const double prefactj = -prefact*particles[j].m;
-                particles[0].vx    += prefactj*dx;
-                particles[0].vy    += prefactj*dy;
-                particles[0].vz    += prefactj*dz;
+                vx0    += prefactj*dx;
+                vy0    += prefactj*dy;
+                vz0    += prefactj*dz;
             }
         }
+        particles[0].vx = vx0;
+        particles[0].vy = vy0;
+        particles[0].vz = vz0;
+        if (drift){
+            particles[0].x += a*particles[0].vx;
+            particles[0].y += a*particles[0].vy;
+            particles[0].z += a*particles[0].vz;
+        }
         for (int v=0;v<r->var_config_N;v++){
             struct reb_variational_configuration const vc = r->var_config[v];
             if (vc.order==1){
@@ -233,6 +330,10 @@ static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation*
                 //////////////////
                 struct reb_particle* const particles_var1 = particles + vc.index;
                 if (vc.testparticle<0){
+                    double dvx0 = particles_var1[0].vx;
+                    double dvy0 = particles_var1[0].vy;
+                    double dvz0 = particles_var1[0].vz;
+#pragma omp parallel for reduction(+:dvx0,dvy0,dvz0)
                     for (int j=1; j<N_active; j++){
                         const double dx = particles[0].x - particles[j].x;
                         const double dy = particles[0].y - particles[j].y;
@@ -262,14 +363,17 @@ static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation*
                         const double dGmi = y*G*particles_var1[0].m;
                         const double dGmj = y*G*particles_var1[j].m;
 
-                        particles_var1[0].vx += Gmj * dax - dGmj*r3inv*dx;
-                        particles_var1[0].vy += Gmj * day - dGmj*r3inv*dy;
-                        particles_var1[0].vz += Gmj * daz - dGmj*r3inv*dz;
+                        dvx0 += Gmj * dax - dGmj*r3inv*dx;
+                        dvy0 += Gmj * day - dGmj*r3inv*dy;
+                        dvz0 += Gmj * daz - dGmj*r3inv*dz;
 
                         particles_var1[j].vx -= Gmi * dax - dGmi*r3inv*dx;
                         particles_var1[j].vy -= Gmi * day - dGmi*r3inv*dy;
                         particles_var1[j].vz -= Gmi * daz - dGmi*r3inv*dz; 
                     }
+                    particles_var1[0].vx = dvx0;
+                    particles_var1[0].vy = dvy0;
+                    particles_var1[0].vz = dvz0;
                 }else{ //testparticle
                     int i = vc.testparticle;
                     const double dx = particles[i].x - particles[0].x;
@@ -305,6 +409,96 @@ static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation*
     }
 
 }
+static inline void reb_integrator_eos_interaction_shell1(struct reb_simulation* r, double y, double v){
+    reb_integrator_eos_interaction_drift_shell1(r, y, v, 0, 0.);
+}
+
+/**
+ * @brief Coefficients of an operator splitting scheme used for phi1.
+ * @details One step of length dt starts with a drift of drift[0]*dt. It is followed by stages 
+ * kicks of kick[k]*dt (with the modified kick kick_v[k]*dt^3/kick_v_div) which are separated by 
+ * drifts of drift[k+1]*dt. The step ends with another drift of drift[0]*dt. All schemes are symmetric.
+ */
+struct reb_eos_coefficients {
+    int stages;
+    double drift[17];
+    double kick[17];
+    double kick_v[17];
+    double kick_v_div;      // Kept separate so that PMLF4 evaluates dt^3/24 exactly as before.
+};
+
+// Coefficients of phi1 for every scheme. LF4 and LF4_2 are written out, LF6 and LF8 are symmetric 
+// compositions of leapfrog steps with the coefficients a, and LF8_6_4, PLF7_6_4 and PMLF6 use 
+// the coefficients a (drifts), b (kicks) and c (modified kicks).
+static const struct reb_eos_coefficients reb_eos_coefficients[] = {
+    [REB_EOS_LF] = {
+        .stages = 1,
+        .drift = {0.5},
+        .kick = {1.},
+        .kick_v_div = 24.,
+    },
+    [REB_EOS_LF4] = {
+        .stages = 3,
+        .drift = {LF4_A, 0.5-LF4_A, 0.5-LF4_A},
+        .kick = {2.*LF4_A, 1.-4.*LF4_A, 2.*LF4_A},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_LF6] = {
+        .stages = 9,
+        .drift = {LF6_A_0*0.5, (LF6_A_0+LF6_A_1)*0.5, (LF6_A_1+LF6_A_2)*0.5, (LF6_A_2+LF6_A_3)*0.5, (LF6_A_3+LF6_A_4)*0.5, (LF6_A_4+LF6_A_3)*0.5, (LF6_A_3+LF6_A_2)*0.5, (LF6_A_2+LF6_A_1)*0.5, (LF6_A_1+LF6_A_0)*0.5},
+        .kick = {LF6_A_0, LF6_A_1, LF6_A_2, LF6_A_3, LF6_A_4, LF6_A_3, LF6_A_2, LF6_A_1, LF6_A_0},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_LF8] = {
+        .stages = 17,
+        .drift = {LF8_A_0*0.5, (LF8_A_0+LF8_A_1)*0.5, (LF8_A_1+LF8_A_2)*0.5, (LF8_A_2+LF8_A_3)*0.5, (LF8_A_3+LF8_A_4)*0.5, (LF8_A_4+LF8_A_5)*0.5, (LF8_A_5+LF8_A_6)*0.5, (LF8_A_6+LF8_A_7)*0.5, (LF8_A_7+LF8_A_8)*0.5, (LF8_A_8+LF8_A_7)*0.5, (LF8_A_7+LF8_A_6)*0.5, (LF8_A_6+LF8_A_5)*0.5, (LF8_A_5+LF8_A_4)*0.5, (LF8_A_4+LF8_A_3)*0.5, (LF8_A_3+LF8_A_2)*0.5, (LF8_A_2+LF8_A_1)*0.5, (LF8_A_1+LF8_A_0)*0.5},
+        .kick = {LF8_A_0, LF8_A_1, LF8_A_2, LF8_A_3, LF8_A_4, LF8_A_5, LF8_A_6, LF8_A_7, LF8_A_8, LF8_A_7, LF8_A_6, LF8_A_5, LF8_A_4, LF8_A_3, LF8_A_2, LF8_A_1, LF8_A_0},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_LF4_2] = {
+        .stages = 2,
+        .drift = {LF4_2_A, 1.-2.*LF4_2_A},
+        .kick = {0.5, 0.5},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_LF8_6_4] = {
+        .stages = 7,
+        .drift = {LF8_6_4_A_0, LF8_6_4_A_1, LF8_6_4_A_2, LF8_6_4_A_3, LF8_6_4_A_3, LF8_6_4_A_2, LF8_6_4_A_1},
+        .kick = {LF8_6_4_B_0, LF8_6_4_B_1, LF8_6_4_B_2, LF8_6_4_B_3, LF8_6_4_B_2, LF8_6_4_B_1, LF8_6_4_B_0},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_PLF7_6_4] = {
+        .stages = 3,
+        .drift = {PLF7_6_4_A_0, PLF7_6_4_A_1, PLF7_6_4_A_1},
+        .kick = {PLF7_6_4_B_0, PLF7_6_4_B_1, PLF7_6_4_B_0},
+        .kick_v_div = 1.,
+    },
+    [REB_EOS_PMLF4] = {
+        .stages = 1,
+        .drift = {0.5},
+        .kick = {1.},
+        .kick_v = {1.},
+        .kick_v_div = 24.,
+    },
+    [REB_EOS_PMLF6] = {
+        .stages = 3,
+        .drift = {PMLF6_A_0, PMLF6_A_1, PMLF6_A_1},
+        .kick = {PMLF6_B_0, PMLF6_B_1, PMLF6_B_0},
+        .kick_v = {PMLF6_C_0, PMLF6_C_1, PMLF6_C_0},
+        .kick_v_div = 1.,
+    },
+};
+
+// Unknown schemes do nothing.
+static const struct reb_eos_coefficients reb_eos_coefficients_none = {.stages = 0, .kick_v_div = 1.};
+
+static const struct reb_eos_coefficients* reb_integrator_eos_coefficients(const enum REB_EOS_TYPE type){
+    if ((unsigned int)type<sizeof(reb_eos_coefficients)/sizeof(reb_eos_coefficients[0])){
+        return &reb_eos_coefficients[type];
+    }
+    return &reb_eos_coefficients_none;
+}
+
 static inline void reb_integrator_eos_preprocessor(struct reb_simulation* const r, double dt, enum REB_EOS_TYPE type, void (*drift_step)(struct reb_simulation* const r, double a), void (*interaction_step)(struct reb_simulation* const r, double y, double v)){
     switch(type){
         case REB_EOS_PMLF6:
@@ -355,7 +549,8 @@ static inline void reb_integrator_eos_postprocessor(struct reb_simulation* const
 }
 static void reb_integrator_eos_drift_shell1(struct reb_simulation* const r, double dt){
     struct reb_particle* restrict const particles = r->particles;
-    unsigned int N = r->N;
+    const int N = r->N;
+#pragma omp parallel for simd
     for (int i=0;i<N;i++){  
         particles[i].x += dt*particles[i].vx;
         particles[i].y += dt*particles[i].vy;
@@ -368,171 +563,29 @@ static void reb_integrator_eos_drift_shell0(struct reb_simulation* const r, doub
     const int n = reos->n;
     const double dt = _dt/n;
     reb_integrator_eos_preprocessor(r, dt, reos->phi1, reb_integrator_eos_drift_shell1, reb_integrator_eos_interaction_shell1);
-    switch(reos->phi1){
-        case REB_EOS_LF:
-            reb_integrator_eos_drift_shell1(r, dt*0.5); 
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt, 0.);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, dt);
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*0.5);
-            break;
-        case REB_EOS_LF4:
-            reb_integrator_eos_drift_shell1(r, dt*lf4_a);
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt*2.*lf4_a, 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(0.5-lf4_a));
-                reb_integrator_eos_interaction_shell1(r, dt*(1.-4.*lf4_a), 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(0.5-lf4_a));
-                reb_integrator_eos_interaction_shell1(r, dt*2.*lf4_a, 0.);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, dt*2.*lf4_a);
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*lf4_a);
-            break;
-        case REB_EOS_LF6:
-            reb_integrator_eos_drift_shell1(r, dt*lf6_a[0]*0.5);
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[0], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[0]+lf6_a[1])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[1], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[1]+lf6_a[2])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[2], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[2]+lf6_a[3])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[3], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[3]+lf6_a[4])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[4], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[3]+lf6_a[4])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[3], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[2]+lf6_a[3])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[2], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[1]+lf6_a[2])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[1], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf6_a[0]+lf6_a[1])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf6_a[0], 0.);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, dt*lf6_a[0]);
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*lf6_a[0]*0.5);
-            break; 
-        case REB_EOS_LF8: 
-            reb_integrator_eos_drift_shell1(r, dt*lf8_a[0]*0.5);
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[0], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[0]+lf8_a[1])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[1], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[1]+lf8_a[2])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[2], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[2]+lf8_a[3])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[3], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[3]+lf8_a[4])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[4], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[4]+lf8_a[5])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[5], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[5]+lf8_a[6])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[6], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[6]+lf8_a[7])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[7], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[7]+lf8_a[8])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[8], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[7]+lf8_a[8])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[7], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[6]+lf8_a[7])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[6], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[5]+lf8_a[6])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[5], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[4]+lf8_a[5])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[4], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[3]+lf8_a[4])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[3], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[2]+lf8_a[3])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[2], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[1]+lf8_a[2])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[1], 0.);
-                reb_integrator_eos_drift_shell1(r, dt*(lf8_a[0]+lf8_a[1])*0.5);
-                reb_integrator_eos_interaction_shell1(r, dt*lf8_a[0], 0.);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, dt*lf8_a[0]);
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*lf8_a[0]*0.5);
-            break;
-        case REB_EOS_LF4_2: 
-            reb_integrator_eos_drift_shell1(r, dt*lf4_2_a); 
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt*0.5, 0.); 
-                reb_integrator_eos_drift_shell1(r, dt*(1.-2.*lf4_2_a));
-                reb_integrator_eos_interaction_shell1(r, dt*0.5, 0.); 
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, 2.*dt*lf4_2_a); 
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*lf4_2_a); 
-            break;
-        case REB_EOS_LF8_6_4:
-            reb_integrator_eos_drift_shell1(r, dt*lf8_6_4_a[0]);   
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[0]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[1]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[1]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[2]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[2]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[3]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[3]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[3]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[2]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[2]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[1]*dt,0);
-                reb_integrator_eos_drift_shell1(r, lf8_6_4_a[1]*dt);   
-                reb_integrator_eos_interaction_shell1(r, lf8_6_4_b[0]*dt,0);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, 2.*dt*lf8_6_4_a[0]);   
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*lf8_6_4_a[0]);   
-            break;
-        case REB_EOS_PMLF4:
-            reb_integrator_eos_drift_shell1(r, dt*0.5); 
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt, dt*dt*dt/24.); 
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, dt);
-                }
-            }
-            reb_integrator_eos_drift_shell1(r, dt*0.5);
-            break;
-        case REB_EOS_PMLF6:
-            reb_integrator_eos_drift_shell1(r, dt*pmlf6_a[0]); 
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, dt*pmlf6_b[0], dt*dt*dt*pmlf6_c[0]); 
-                reb_integrator_eos_drift_shell1(r, dt*pmlf6_a[1]);
-                reb_integrator_eos_interaction_shell1(r, dt*pmlf6_b[1], dt*dt*dt*pmlf6_c[1]); 
-                reb_integrator_eos_drift_shell1(r, dt*pmlf6_a[1]);
-                reb_integrator_eos_interaction_shell1(r, dt*pmlf6_b[0], dt*dt*dt*pmlf6_c[0]);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, 2.*dt*pmlf6_a[0]);
-                }
+    const struct reb_eos_coefficients* const c = reb_integrator_eos_coefficients(reos->phi1);
+    // Every kick is combined with the following drift into one pass over the particles.
+    const int fused = r->var_config_N==0;
+    reb_integrator_eos_drift_shell1(r, dt*c->drift[0]);
+    for (int i=0;i<n;i++){
+        for (int k=0;k<c->stages;k++){
+            double a;
+            if (k<c->stages-1){
+                a = dt*c->drift[k+1];
+            }else if (i<n-1){
+                a = 2.*dt*c->drift[0]; // Combine drifts of consecutive steps
+            }else{
+                a = dt*c->drift[0];
             }
-            reb_integrator_eos_drift_shell1(r, dt*pmlf6_a[0]);
-            break;
-        case REB_EOS_PLF7_6_4:
-            reb_integrator_eos_drift_shell1(r, dt*plf7_6_4_a[0]);   
-            for (int i=0;i<n;i++){
-                reb_integrator_eos_interaction_shell1(r, plf7_6_4_b[0]*dt,0);
-                reb_integrator_eos_drift_shell1(r, plf7_6_4_a[1]*dt);   
-                reb_integrator_eos_interaction_shell1(r, plf7_6_4_b[1]*dt,0);
-                reb_integrator_eos_drift_shell1(r, plf7_6_4_a[1]*dt);   
-                reb_integrator_eos_interaction_shell1(r, plf7_6_4_b[0]*dt,0);
-                if (i<n-1){
-                    reb_integrator_eos_drift_shell1(r, 2.*dt*plf7_6_4_a[0]);   
-                }
+            const double y = dt*c->kick[k];
+            const double v = dt*dt*dt*c->kick_v[k]/c->kick_v_div;
+            if (fused){
+                reb_integrator_eos_interaction_drift_shell1(r, y, v, 1, a);
+            }else{
+                reb_integrator_eos_interaction_shell1(r, y, v);
+                reb_integrator_eos_drift_shell1(r, a);
             }
-            reb_integrator_eos_drift_shell1(r, dt*plf7_6_4_a[0]);   
-            break;
+        }
     }
     reb_integrator_eos_postprocessor(r, dt, reos->phi1, reb_integrator_eos_drift_shell1, reb_integrator_eos_interaction_shell1);
 }
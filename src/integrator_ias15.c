@@ -69,12 +69,17 @@ struct reb_dpconst7 {
 // Helper functions for resetting the b and e coefficients
 static void copybuffers(const struct reb_dpconst7 _a, const struct reb_dpconst7 _b, int N3);
 static void predict_next_step(double ratio, int N3,  const struct reb_dpconst7 _e, const struct reb_dpconst7 _b, const struct reb_dpconst7 e, const struct reb_dpconst7 b);
+// Helper function for block timesteps
+static void reb_integrator_ias15_block_positions(struct reb_simulation* const r, const int l, const int n);
 
 
 /////////////////////////
 //   Constants 
 
 static const double safety_factor           = 0.25; /**< Maximum increase/deacrease of consecutve timesteps. */
+#ifdef _OPENMP
+static const int omp_N3_min                 = 3072; /**< Shorter loops over the IAS15 arrays are not distributed among OpenMP threads. */
+#endif // _OPENMP
 
 // Gauss Radau spacings
 static const double h[8]    = { 0.0, 0.0562625605369221464656521910318, 0.180240691736892364987579942780, 0.352624717113169637373907769648, 0.547153626330555383001448554766, 0.734210177215410531523210605558, 0.885320946839095768090359771030, 0.977520613561287501891174488626};
@@ -195,43 +200,89 @@ void reb_integrator_ias15_alloc(struct reb_simulation* r){
 
 }
  
-// Does the actual timestep.
-static int reb_integrator_ias15_step(struct reb_simulation* r) {
-    reb_integrator_ias15_alloc(r);
+// Sets the coefficients to predict positions at the fraction h of the timestep dt.
+static void reb_integrator_ias15_position_coefficients(double* const s, const double dt, const double h){
+    s[0] = dt * h;
+    s[1] = s[0] * s[0] / 2.;
+    s[2] = s[1] * h / 3.;
+    s[3] = s[2] * h / 2.;
+    s[4] = 3. * s[3] * h / 5.;
+    s[5] = 2. * s[4] * h / 3.;
+    s[6] = 5. * s[5] * h / 7.;
+    s[7] = 3. * s[6] * h / 4.;
+    s[8] = 7. * s[7] * h / 9.;
+}
 
-    struct reb_particle* const particles = r->particles;
-    int N;
-    int* map; // this map allow for integrating only a selection of particles 
-    if (r->integrator==REB_INTEGRATOR_MERCURIUS){// mercurius close encounter
-        N = r->ri_mercurius.encounterN;
-        map = r->ri_mercurius.encounter_map;
-        if (map==NULL){
-            reb_error(r, "Cannot access MERCURIUS map from IAS15.");
-            return 0;
-        }
-    }else{ 
-        N = r->N;
-        map = r->ri_ias15.map; // identity map
+// Sets the coefficients to predict velocities at the fraction h of the timestep dt.
+static void reb_integrator_ias15_velocity_coefficients(double* const s, const double dt, const double h){
+    s[0] = dt * h;
+    s[1] =      s[0] * h / 2.;
+    s[2] = 2. * s[1] * h / 3.;
+    s[3] = 3. * s[2] * h / 4.;
+    s[4] = 4. * s[3] * h / 5.;
+    s[5] = 5. * s[4] * h / 6.;
+    s[6] = 6. * s[5] * h / 7.;
+    s[7] = 7. * s[6] * h / 8.;
+}
+
+// Predict positions using b values
+static void reb_integrator_ias15_predict_positions(struct reb_particle* const particles, const struct reb_simulation_integrator_ias15* const ri, const int N, const int* const map, const double* const s){
+    const double* restrict const csx = ri->csx; 
+    const double* restrict const x0 = ri->x0; 
+    const double* restrict const v0 = ri->v0; 
+    const double* restrict const a0 = ri->a0; 
+    const struct reb_dpconst7 b  = dpcast(ri->b);
+#pragma omp parallel for if(3*N>omp_N3_min)
+    for(int i=0;i<N;i++) {
+        int mi = map[i];
+        const int k0 = 3*i+0;
+        const int k1 = 3*i+1;
+        const int k2 = 3*i+2;
+
+        double xk0  = -csx[k0] + (s[8]*b.p6[k0] + s[7]*b.p5[k0] + s[6]*b.p4[k0] + s[5]*b.p3[k0] + s[4]*b.p2[k0] + s[3]*b.p1[k0] + s[2]*b.p0[k0] + s[1]*a0[k0] + s[0]*v0[k0] );
+        particles[mi].x = xk0 + x0[k0];
+        double xk1  = -csx[k1] + (s[8]*b.p6[k1] + s[7]*b.p5[k1] + s[6]*b.p4[k1] + s[5]*b.p3[k1] + s[4]*b.p2[k1] + s[3]*b.p1[k1] + s[2]*b.p0[k1] + s[1]*a0[k1] + s[0]*v0[k1] );
+        particles[mi].y = xk1 + x0[k1];
+        double xk2  = -csx[k2] + (s[8]*b.p6[k2] + s[7]*b.p5[k2] + s[6]*b.p4[k2] + s[5]*b.p3[k2] + s[4]*b.p2[k2] + s[3]*b.p1[k2] + s[2]*b.p0[k2] + s[1]*a0[k2] + s[0]*v0[k2] );
+        particles[mi].z = xk2 + x0[k2];
+    }
+}
+
+// Predict velocities using b values
+static void reb_integrator_ias15_predict_velocities(struct reb_particle* const particles, const struct reb_simulation_integrator_ias15* const ri, const int N, const int* const map, const double* const s){
+    const double* restrict const csv = ri->csv; 
+    const double* restrict const v0 = ri->v0; 
+    const double* restrict const a0 = ri->a0; 
+    const struct reb_dpconst7 b  = dpcast(ri->b);
+#pragma omp parallel for if(3*N>omp_N3_min)
+    for(int i=0;i<N;i++) {
+        int mi = map[i];
+        const int k0 = 3*i+0;
+        const int k1 = 3*i+1;
+        const int k2 = 3*i+2;
+
+        double vk0 =  -csv[k0] + s[7]*b.p6[k0] + s[6]*b.p5[k0] + s[5]*b.p4[k0] + s[4]*b.p3[k0] + s[3]*b.p2[k0] + s[2]*b.p1[k0] + s[1]*b.p0[k0] + s[0]*a0[k0];
+        particles[mi].vx = vk0 + v0[k0];
+        double vk1 =  -csv[k1] + s[7]*b.p6[k1] + s[6]*b.p5[k1] + s[5]*b.p4[k1] + s[4]*b.p3[k1] + s[3]*b.p2[k1] + s[2]*b.p1[k1] + s[1]*b.p0[k1] + s[0]*a0[k1];
+        particles[mi].vy = vk1 + v0[k1];
+        double vk2 =  -csv[k2] + s[7]*b.p6[k2] + s[6]*b.p5[k2] + s[5]*b.p4[k2] + s[4]*b.p3[k2] + s[3]*b.p2[k2] + s[2]*b.p1[k2] + s[1]*b.p0[k2] + s[0]*a0[k2];
+        particles[mi].vz = vk2 + v0[k2];
     }
+}
+
+// Stores the initial values and initializes g at the beginning of a timestep.
+static void reb_integrator_ias15_begin(struct reb_simulation* const r, const struct reb_simulation_integrator_ias15* const ri, const int N, const int* const map){
+    struct reb_particle* const particles = r->particles;
     const int N3 = 3*N;
-    
-    // reb_update_acceleration(); // Not needed. Forces are already calculated in main routine.
-    
-    double s[9];                // Summation coefficients 
-    double* restrict const csx = r->ri_ias15.csx; 
-    double* restrict const csv = r->ri_ias15.csv; 
-    double* restrict const csa0 = r->ri_ias15.csa0; 
-    double* restrict const at = r->ri_ias15.at; 
-    double* restrict const x0 = r->ri_ias15.x0; 
-    double* restrict const v0 = r->ri_ias15.v0; 
-    double* restrict const a0 = r->ri_ias15.a0; 
-    struct reb_vec3d* gravity_cs = r->gravity_cs; 
-    const struct reb_dpconst7 g  = dpcast(r->ri_ias15.g);
-    const struct reb_dpconst7 e  = dpcast(r->ri_ias15.e);
-    const struct reb_dpconst7 b  = dpcast(r->ri_ias15.b);
-    const struct reb_dpconst7 csb= dpcast(r->ri_ias15.csb);
-    const struct reb_dpconst7 er = dpcast(r->ri_ias15.er);
-    const struct reb_dpconst7 br = dpcast(r->ri_ias15.br);
+    double* restrict const csa0 = ri->csa0; 
+    double* restrict const x0 = ri->x0; 
+    double* restrict const v0 = ri->v0; 
+    double* restrict const a0 = ri->a0; 
+    const struct reb_vec3d* const gravity_cs = r->gravity_cs; 
+    const struct reb_dpconst7 g  = dpcast(ri->g);
+    const struct reb_dpconst7 b  = dpcast(ri->b);
+    const struct reb_dpconst7 csb= dpcast(ri->csb);
+#pragma omp parallel for if(N3>omp_N3_min)
     for(int k=0;k<N;k++) {
         int mk = map[k];
         x0[3*k]   = particles[mk].x;
@@ -245,6 +296,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
         a0[3*k+2] = particles[mk].az;
     }
     if (r->gravity==REB_GRAVITY_COMPENSATED){
+#pragma omp parallel for if(N3>omp_N3_min)
         for(int k=0;k<N;k++) {
             int mk = map[k];
             csa0[3*k]   = gravity_cs[mk].x;
@@ -252,11 +304,12 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
             csa0[3*k+2] = gravity_cs[mk].z;
         }
     }else{
-        gravity_cs = (struct reb_vec3d*)csa0; // Always 0.
+#pragma omp parallel for if(N3>omp_N3_min)
         for(int k=0;k<N3;k++) {
             csa0[k]   = 0;
         }
     }
+#pragma omp parallel for if(N3>omp_N3_min)
     for (int k=0;k<N3;k++){
         // Memset might be faster!
         csb.p0[k] = 0.;
@@ -268,6 +321,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
         csb.p6[k] = 0.;
     }
 
+#pragma omp parallel for if(N3>omp_N3_min)
     for(int k=0;k<N3;k++) {
         g.p0[k] = b.p6[k]*d[15] + b.p5[k]*d[10] + b.p4[k]*d[6] + b.p3[k]*d[3]  + b.p2[k]*d[1]  + b.p1[k]*d[0]  + b.p0[k];
         g.p1[k] = b.p6[k]*d[16] + b.p5[k]*d[11] + b.p4[k]*d[7] + b.p3[k]*d[4]  + b.p2[k]*d[2]  + b.p1[k];
@@ -277,6 +331,25 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
         g.p5[k] = b.p6[k]*d[20] + b.p5[k];
         g.p6[k] = b.p6[k];
     }
+}
+
+// Predictor corrector loop for the timestep dt. Returns the MEGNO integrand.
+// If block_level is not negative, particles on other levels are moved to the 
+// times at which forces are calculated.
+static double reb_integrator_ias15_predictor_corrector(struct reb_simulation* const r, const struct reb_simulation_integrator_ias15* const ri, const int N, const int* const map, const double dt, const int block_level){
+    struct reb_particle* const particles = r->particles;
+    const int N3 = 3*N;
+    double s[9];                // Summation coefficients 
+    double* restrict const csa0 = ri->csa0; 
+    double* restrict const at = ri->at; 
+    double* restrict const a0 = ri->a0; 
+    struct reb_vec3d* gravity_cs = r->gravity_cs; 
+    const struct reb_dpconst7 g  = dpcast(ri->g);
+    const struct reb_dpconst7 b  = dpcast(ri->b);
+    const struct reb_dpconst7 csb= dpcast(ri->csb);
+    if (r->gravity!=REB_GRAVITY_COMPENSATED){
+        gravity_cs = (struct reb_vec3d*)csa0; // Always 0.
+    }
 
     double integrator_megno_thisdt = 0.;
     double integrator_megno_thisdt_init = 0.;
@@ -287,20 +360,24 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
     double t_beginning = r->t;
     double predictor_corrector_error = 1e300;
     double predictor_corrector_error_last = 2;
-    int iterations = 0; 
+    const double pc_tolerance = fmax(ri->pc_tolerance, ri->pc_tolerance_epsilon*ri->epsilon);
+    const unsigned int pc_iterations_max = ri->pc_iterations_max>0?ri->pc_iterations_max:1;
+    unsigned int iterations = 0; 
     // Predictor corrector loop
     // Stops if one of the following conditions is satisfied: 
-    //   1) predictor_corrector_error better than 1e-16 
+    //   1) predictor_corrector_error better than pc_tolerance (default 1e-16) 
     //   2) predictor_corrector_error starts to oscillate
-    //   3) more than 12 iterations
+    //   3) more than pc_iterations_max iterations (default 12)
+    // The b values have been predicted from the previous timestep, so the loop 
+    // typically starts close to the converged values.
     while(1){
-        if(predictor_corrector_error<1e-16){
+        if(predictor_corrector_error<pc_tolerance){
             break;
         }
         if(iterations > 2 && predictor_corrector_error_last <= predictor_corrector_error){
             break;
         }
-        if (iterations>=12){
+        if (iterations>=pc_iterations_max){
             r->ri_ias15.iterations_max_exceeded++;
             const int integrator_iterations_warning = 10;
             if (r->ri_ias15.iterations_max_exceeded==integrator_iterations_warning ){
@@ -316,55 +393,18 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
 
         for(int n=1;n<8;n++) {                          // Loop over interval using Gauss-Radau spacings
 
-            s[0] = r->dt * h[n];
-            s[1] = s[0] * s[0] / 2.;
-            s[2] = s[1] * h[n] / 3.;
-            s[3] = s[2] * h[n] / 2.;
-            s[4] = 3. * s[3] * h[n] / 5.;
-            s[5] = 2. * s[4] * h[n] / 3.;
-            s[6] = 5. * s[5] * h[n] / 7.;
-            s[7] = 3. * s[6] * h[n] / 4.;
-            s[8] = 7. * s[7] * h[n] / 9.;
+            reb_integrator_ias15_position_coefficients(s, dt, h[n]);
             
             r->t = t_beginning + s[0];
 
             // Prepare particles arrays for force calculation
-            for(int i=0;i<N;i++) {                      // Predict positions at interval n using b values
-                int mi = map[i];
-                const int k0 = 3*i+0;
-                const int k1 = 3*i+1;
-                const int k2 = 3*i+2;
-
-                double xk0  = -csx[k0] + (s[8]*b.p6[k0] + s[7]*b.p5[k0] + s[6]*b.p4[k0] + s[5]*b.p3[k0] + s[4]*b.p2[k0] + s[3]*b.p1[k0] + s[2]*b.p0[k0] + s[1]*a0[k0] + s[0]*v0[k0] );
-                particles[mi].x = xk0 + x0[k0];
-                double xk1  = -csx[k1] + (s[8]*b.p6[k1] + s[7]*b.p5[k1] + s[6]*b.p4[k1] + s[5]*b.p3[k1] + s[4]*b.p2[k1] + s[3]*b.p1[k1] + s[2]*b.p0[k1] + s[1]*a0[k1] + s[0]*v0[k1] );
-                particles[mi].y = xk1 + x0[k1];
-                double xk2  = -csx[k2] + (s[8]*b.p6[k2] + s[7]*b.p5[k2] + s[6]*b.p4[k2] + s[5]*b.p3[k2] + s[4]*b.p2[k2] + s[3]*b.p1[k2] + s[2]*b.p0[k2] + s[1]*a0[k2] + s[0]*v0[k2] );
-                particles[mi].z = xk2 + x0[k2];
-            }
+            reb_integrator_ias15_predict_positions(particles, ri, N, map, s);   // Predict positions at interval n using b values
             if (r->calculate_megno || (r->additional_forces && r->force_is_velocity_dependent)){
-                s[0] = r->dt * h[n];
-                s[1] =      s[0] * h[n] / 2.;
-                s[2] = 2. * s[1] * h[n] / 3.;
-                s[3] = 3. * s[2] * h[n] / 4.;
-                s[4] = 4. * s[3] * h[n] / 5.;
-                s[5] = 5. * s[4] * h[n] / 6.;
-                s[6] = 6. * s[5] * h[n] / 7.;
-                s[7] = 7. * s[6] * h[n] / 8.;
-
-                for(int i=0;i<N;i++) {                  // Predict velocities at interval n using b values
-                    int mi = map[i];
-                    const int k0 = 3*i+0;
-                    const int k1 = 3*i+1;
-                    const int k2 = 3*i+2;
-
-                    double vk0 =  -csv[k0] + s[7]*b.p6[k0] + s[6]*b.p5[k0] + s[5]*b.p4[k0] + s[4]*b.p3[k0] + s[3]*b.p2[k0] + s[2]*b.p1[k0] + s[1]*b.p0[k0] + s[0]*a0[k0];
-                    particles[mi].vx = vk0 + v0[k0];
-                    double vk1 =  -csv[k1] + s[7]*b.p6[k1] + s[6]*b.p5[k1] + s[5]*b.p4[k1] + s[4]*b.p3[k1] + s[3]*b.p2[k1] + s[2]*b.p1[k1] + s[1]*b.p0[k1] + s[0]*a0[k1];
-                    particles[mi].vy = vk1 + v0[k1];
-                    double vk2 =  -csv[k2] + s[7]*b.p6[k2] + s[6]*b.p5[k2] + s[5]*b.p4[k2] + s[4]*b.p3[k2] + s[3]*b.p2[k2] + s[2]*b.p1[k2] + s[1]*b.p0[k2] + s[0]*a0[k2];
-                    particles[mi].vz = vk2 + v0[k2];
-                }
+                reb_integrator_ias15_velocity_coefficients(s, dt, h[n]);
+                reb_integrator_ias15_predict_velocities(particles, ri, N, map, s);  // Predict velocities at interval n using b values
+            }
+            if (block_level>=0){
+                reb_integrator_ias15_block_positions(r, block_level, n);
             }
 
 
@@ -373,6 +413,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                 integrator_megno_thisdt += w[n] * r->t * reb_tools_megno_deltad_delta(r);
             }
 
+#pragma omp parallel for if(N3>omp_N3_min)
             for(int k=0;k<N;++k) {
                 int mk = map[k];
                 at[3*k]   = particles[mk].ax;
@@ -381,6 +422,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
             }
             switch (n) {                            // Improve b and g values
                 case 1: 
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p0[k];
                         double gk = at[k];
@@ -391,6 +433,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                         add_cs(&(b.p0[k]), &(csb.p0[k]), g.p0[k]-tmp);
                     } break;
                 case 2: 
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p1[k];
                         double gk = at[k];
@@ -403,6 +446,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                         add_cs(&(b.p1[k]), &(csb.p1[k]), tmp);
                     } break;
                 case 3: 
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p2[k];
                         double gk = at[k];
@@ -416,6 +460,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                         add_cs(&(b.p2[k]), &(csb.p2[k]), tmp);
                     } break;
                 case 4:
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p3[k];
                         double gk = at[k];
@@ -430,6 +475,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                         add_cs(&(b.p3[k]), &(csb.p3[k]), tmp);
                     } break;
                 case 5:
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p4[k];
                         double gk = at[k];
@@ -445,6 +491,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                         add_cs(&(b.p4[k]), &(csb.p4[k]), tmp);
                     } break;
                 case 6:
+#pragma omp parallel for if(N3>omp_N3_min)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p5[k];
                         double gk = at[k];
@@ -464,6 +511,9 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
                 {
                     double maxak = 0.0;
                     double maxb6ktmp = 0.0;
+                    // Maxima do not depend on the order of evaluation, so the reduction 
+                    // gives the same result for any number of threads.
+#pragma omp parallel for if(N3>omp_N3_min) reduction(max:maxak,maxb6ktmp,predictor_corrector_error)
                     for(int k=0;k<N3;++k) {
                         double tmp = g.p6[k];
                         double gk = at[k];
@@ -508,8 +558,81 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
             }
         }
     }
+    r->ri_ias15.iterations_histogram[iterations<15?iterations:15]++;
     // Set time back to initial value (will be updated below) 
     r->t = t_beginning;
+    return integrator_megno_thisdt;
+}
+
+// Find new position and velocity values at end of the sequence
+static void reb_integrator_ias15_update(const struct reb_simulation_integrator_ias15* const ri, const int N3, const double dt_done){
+    double* restrict const csx = ri->csx; 
+    double* restrict const csv = ri->csv; 
+    double* restrict const x0 = ri->x0; 
+    double* restrict const v0 = ri->v0; 
+    double* restrict const a0 = ri->a0; 
+    const struct reb_dpconst7 b  = dpcast(ri->b);
+    const double dt_done2 = dt_done * dt_done;
+#pragma omp parallel for if(N3>omp_N3_min)
+    for(int k=0;k<N3;++k) {
+        {
+            add_cs(&(x0[k]), &(csx[k]), b.p6[k]/72.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p5[k]/56.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p4[k]/42.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p3[k]/30.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p2[k]/20.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p1[k]/12.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), b.p0[k]/6.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), a0[k]/2.*dt_done2);
+            add_cs(&(x0[k]), &(csx[k]), v0[k]*dt_done);
+        }
+        {
+            add_cs(&(v0[k]), &(csv[k]), b.p6[k]/8.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p5[k]/7.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p4[k]/6.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p3[k]/5.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p2[k]/4.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p1[k]/3.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), b.p0[k]/2.*dt_done);
+            add_cs(&(v0[k]), &(csv[k]), a0[k]*dt_done);
+        }
+    }
+}
+ 
+// Does the actual timestep.
+static int reb_integrator_ias15_step(struct reb_simulation* r) {
+    reb_integrator_ias15_alloc(r);
+
+    struct reb_particle* const particles = r->particles;
+    int N;
+    int* map; // this map allow for integrating only a selection of particles 
+    if (r->integrator==REB_INTEGRATOR_MERCURIUS){// mercurius close encounter
+        N = r->ri_mercurius.encounterN;
+        map = r->ri_mercurius.encounter_map;
+        if (map==NULL){
+            reb_error(r, "Cannot access MERCURIUS map from IAS15.");
+            return 0;
+        }
+    }else{ 
+        N = r->N;
+        map = r->ri_ias15.map; // identity map
+    }
+    const int N3 = 3*N;
+    
+    // reb_update_acceleration(); // Not needed. Forces are already calculated in main routine.
+    
+    double* restrict const at = r->ri_ias15.at; 
+    double* restrict const x0 = r->ri_ias15.x0; 
+    double* restrict const v0 = r->ri_ias15.v0; 
+    double* restrict const a0 = r->ri_ias15.a0; 
+    const struct reb_dpconst7 e  = dpcast(r->ri_ias15.e);
+    const struct reb_dpconst7 b  = dpcast(r->ri_ias15.b);
+    const struct reb_dpconst7 er = dpcast(r->ri_ias15.er);
+    const struct reb_dpconst7 br = dpcast(r->ri_ias15.br);
+
+    reb_integrator_ias15_begin(r, &(r->ri_ias15), N, map);
+    const double integrator_megno_thisdt = reb_integrator_ias15_predictor_corrector(r, &(r->ri_ias15), N, map, r->dt, -1);
+
     // Find new timestep
     const double dt_done = r->dt;
     
@@ -526,6 +649,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
         if (r->ri_ias15.epsilon_global){
             double maxak = 0.0;
             double maxb6k = 0.0;
+#pragma omp parallel for if(N3>omp_N3_min) reduction(max:maxak,maxb6k)
             for(int i=0;i<N;i++){ // Looping over all particles and all 3 components of the acceleration. 
                 int mi = map[i];
                 const double v2 = particles[mi].vx*particles[mi].vx+particles[mi].vy*particles[mi].vy+particles[mi].vz*particles[mi].vz;
@@ -545,6 +669,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
             }
             integrator_error = maxb6k/maxak;
         }else{
+#pragma omp parallel for if(N3>omp_N3_min) reduction(max:integrator_error)
             for(int k=0;k<N3;k++) {
                 const double ak  = at[k];
                 const double b6k = b.p6[k]; 
@@ -595,31 +720,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
         r->dt = dt_new;
     }
 
-    // Find new position and velocity values at end of the sequence
-    const double dt_done2 = dt_done * dt_done;
-    for(int k=0;k<N3;++k) {
-        {
-            add_cs(&(x0[k]), &(csx[k]), b.p6[k]/72.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p5[k]/56.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p4[k]/42.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p3[k]/30.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p2[k]/20.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p1[k]/12.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), b.p0[k]/6.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), a0[k]/2.*dt_done2);
-            add_cs(&(x0[k]), &(csx[k]), v0[k]*dt_done);
-        }
-        {
-            add_cs(&(v0[k]), &(csv[k]), b.p6[k]/8.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p5[k]/7.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p4[k]/6.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p3[k]/5.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p2[k]/4.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p1[k]/3.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), b.p0[k]/2.*dt_done);
-            add_cs(&(v0[k]), &(csv[k]), a0[k]*dt_done);
-        }
-    }
+    reb_integrator_ias15_update(&(r->ri_ias15), N3, dt_done);
 
     r->t += dt_done;
     r->dt_last_done = dt_done;
@@ -650,6 +751,7 @@ static int reb_integrator_ias15_step(struct reb_simulation* r) {
 static void predict_next_step(double ratio, int N3,  const struct reb_dpconst7 _e, const struct reb_dpconst7 _b, const struct reb_dpconst7 e, const struct reb_dpconst7 b){
     if (ratio>20.){
         // Do not predict if stepsize increase is very large. 
+#pragma omp parallel for if(N3>omp_N3_min)
         for(int k=0;k<N3;++k) {
             e.p0[k] = 0.; e.p1[k] = 0.; e.p2[k] = 0.; e.p3[k] = 0.; e.p4[k] = 0.; e.p5[k] = 0.; e.p6[k] = 0.;
             b.p0[k] = 0.; b.p1[k] = 0.; b.p2[k] = 0.; b.p3[k] = 0.; b.p4[k] = 0.; b.p5[k] = 0.; b.p6[k] = 0.;
@@ -667,6 +769,7 @@ static void predict_next_step(double ratio, int N3,  const struct reb_dpconst7 _
         const double q6 = q3 * q3;
         const double q7 = q3 * q4;
 
+#pragma omp parallel for if(N3>omp_N3_min)
         for(int k=0;k<N3;++k) {
             double be0 = _b.p0[k] - _e.p0[k];
             double be1 = _b.p1[k] - _e.p1[k];
@@ -697,6 +800,7 @@ static void predict_next_step(double ratio, int N3,  const struct reb_dpconst7 _
 }
 
 static void copybuffers(const struct reb_dpconst7 _a, const struct reb_dpconst7 _b, int N3){
+#pragma omp parallel for if(N3>omp_N3_min)
     for (int i=0;i<N3;i++){ 
         _b.p0[i] = _a.p0[i];
         _b.p1[i] = _a.p1[i];
@@ -712,6 +816,500 @@ static void copybuffers(const struct reb_dpconst7 _a, const struct reb_dpconst7
 //  }
 }
 
+/**
+ * @brief Internal state of IAS15 if block timesteps are used.
+ * @details Particles are sorted by their timestep level. The particles on level l 
+ * occupy the elements offset[l] to offset[l+1]-1 of order and (times three) of all 
+ * IAS15 arrays. Particles on level l are advanced with the timestep dt/2^l. 
+ */
+struct reb_ias15_block {
+    int N;                          ///< Number of particles when the levels were set up
+    int levels;                     ///< Number of levels
+    int* level;                     ///< Level of each particle
+    int* order;                     ///< Particles sorted by level
+    int* position;                  ///< Position of each particle in order
+    int* offset;                    ///< Position in order of the first particle on each level (levels+1 entries)
+    int* index;                     ///< Current substep of each level
+    double* dt_new;                 ///< Smallest timestep requested by each particle during this timestep
+    double* nodes;                  ///< Positions and velocities of particles on finer levels at the Gauss-Radau nodes of coarser levels
+    size_t allocated_nodes;         ///< Number of doubles allocated for nodes
+    struct reb_particle* backup;    ///< Particles at the beginning of the timestep
+    double* csx;                    ///< Compensated summation for x at the beginning of the timestep
+    double* csv;                    ///< Compensated summation for v at the beginning of the timestep
+    double t_beginning;             ///< Time at the beginning of the timestep
+    int rejected;                   ///< Set to 1 if the timestep needs to be repeated
+};
+
+static const int block_levels_max = 30; // Substeps are counted with int.
+
+static struct reb_dp7 dp7_offset(const struct reb_dp7 dp, const int k){
+    struct reb_dp7 dpo = {
+        .p0 = dp.p0+k, 
+        .p1 = dp.p1+k, 
+        .p2 = dp.p2+k, 
+        .p3 = dp.p3+k, 
+        .p4 = dp.p4+k, 
+        .p5 = dp.p5+k, 
+        .p6 = dp.p6+k, 
+    };
+    return dpo;
+}
+
+// Returns a copy of ri in which all arrays start at element k.
+static struct reb_simulation_integrator_ias15 reb_integrator_ias15_segment(const struct reb_simulation_integrator_ias15* const ri, const int k){
+    struct reb_simulation_integrator_ias15 seg = *ri;
+    seg.at   = ri->at+k;
+    seg.x0   = ri->x0+k;
+    seg.v0   = ri->v0+k;
+    seg.a0   = ri->a0+k;
+    seg.csx  = ri->csx+k;
+    seg.csv  = ri->csv+k;
+    seg.csa0 = ri->csa0+k;
+    seg.g    = dp7_offset(ri->g,k);
+    seg.b    = dp7_offset(ri->b,k);
+    seg.csb  = dp7_offset(ri->csb,k);
+    seg.e    = dp7_offset(ri->e,k);
+    seg.br   = dp7_offset(ri->br,k);
+    seg.er   = dp7_offset(ri->er,k);
+    return seg;
+}
+
+static void reb_integrator_ias15_block_free(struct reb_ias15_block* const block){
+    if (block==NULL){
+        return;
+    }
+    free(block->level);
+    free(block->order);
+    free(block->position);
+    free(block->offset);
+    free(block->index);
+    free(block->dt_new);
+    free(block->nodes);
+    free(block->backup);
+    free(block->csx);
+    free(block->csv);
+    free(block);
+}
+
+// Puts all particles on level 0.
+static void reb_integrator_ias15_block_init(struct reb_simulation* const r){
+    struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    reb_integrator_ias15_block_free(ri->block);
+    struct reb_ias15_block* const block = calloc(1,sizeof(struct reb_ias15_block));
+    const int N = r->N;
+    const int levels = ri->block_levels;
+    block->N = N;
+    block->levels = levels;
+    block->level = malloc(sizeof(int)*N);
+    block->order = malloc(sizeof(int)*N);
+    block->position = malloc(sizeof(int)*N);
+    block->offset = malloc(sizeof(int)*(levels+1));
+    block->index = calloc(levels,sizeof(int));
+    block->dt_new = malloc(sizeof(double)*N);
+    block->backup = malloc(sizeof(struct reb_particle)*N);
+    block->csx = malloc(sizeof(double)*3*N);
+    block->csv = malloc(sizeof(double)*3*N);
+    for (int i=0;i<N;i++){
+        block->level[i] = 0;
+        block->order[i] = i;
+        block->position[i] = i;
+        block->dt_new[i] = INFINITY;
+    }
+    block->offset[0] = 0;
+    for (int l=1;l<=levels;l++){
+        block->offset[l] = N;
+    }
+    ri->block = block;
+    // Coefficients from previous timesteps might be stored in a different order.
+    reb_integrator_ias15_clear(r);
+}
+
+// Returns the n-th node (n=1..7) of level m. Only the particles on finer levels are 
+// stored, ordered by their position (the first one being the particle at offset[m+1]).
+static double* reb_integrator_ias15_block_nodes(const struct reb_ias15_block* const block, const int m, const int n){
+    const int N = block->N;
+    size_t k = 0;
+    for (int j=0;j<m;j++){
+        k += 7*(size_t)(N-block->offset[j+1]);
+    }
+    return block->nodes + 6*(k + (size_t)(N-block->offset[m+1])*(n-1));
+}
+
+// Makes sure that the nodes of all levels fit into the nodes array. 
+// Returns 0 if the memory cannot be allocated.
+static int reb_integrator_ias15_block_alloc_nodes(struct reb_ias15_block* const block){
+    size_t size = 0;
+    for (int m=0;m<block->levels-1;m++){
+        size += 6*7*(size_t)(block->N-block->offset[m+1]);
+    }
+    if (size>block->allocated_nodes){
+        double* const nodes = realloc(block->nodes, sizeof(double)*size);
+        if (nodes==NULL){
+            return 0;
+        }
+        block->nodes = nodes;
+        block->allocated_nodes = size;
+    }
+    return 1;
+}
+
+// Moves the particles which are not on level l to the time of the n-th node 
+// of the current substep of level l. Particles on coarser levels are predicted, 
+// particles on finer levels have been stored in the nodes array.
+static void reb_integrator_ias15_block_positions(struct reb_simulation* const r, const int l, const int n){
+    const struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    const struct reb_ias15_block* const block = ri->block;
+    struct reb_particle* const particles = r->particles;
+    const int velocities = r->additional_forces && r->force_is_velocity_dependent;
+    double s[9];
+    for (int m=0;m<l;m++){
+        const int Nm = block->offset[m+1]-block->offset[m];
+        if (Nm==0) continue;
+        const double dtm = ldexp(r->dt,-m);
+        const double hm = ldexp(block->index[l]+h[n],m-l) - block->index[m];
+        const struct reb_simulation_integrator_ias15 seg = reb_integrator_ias15_segment(ri, 3*block->offset[m]);
+        reb_integrator_ias15_position_coefficients(s, dtm, hm);
+        reb_integrator_ias15_predict_positions(particles, &seg, Nm, block->order+block->offset[m], s);
+        if (velocities){
+            reb_integrator_ias15_velocity_coefficients(s, dtm, hm);
+            reb_integrator_ias15_predict_velocities(particles, &seg, Nm, block->order+block->offset[m], s);
+        }
+    }
+    if (n==0){
+        return; // Particles on finer levels are already at the beginning of the substep.
+    }
+    const int N = block->N;
+    const int k = block->offset[l+1];
+    const double* const nodes = reb_integrator_ias15_block_nodes(block, l, n);
+    for (int i=k;i<N;i++){
+        const int mi = block->order[i];
+        const double* const node = nodes+6*(i-k);
+        particles[mi].x = node[0];
+        particles[mi].y = node[1];
+        particles[mi].z = node[2];
+        if (velocities){
+            particles[mi].vx = node[3];
+            particles[mi].vy = node[4];
+            particles[mi].vz = node[5];
+        }
+    }
+}
+
+// Stores the particles on level l at those nodes of coarser levels which fall 
+// into the current substep of level l.
+static void reb_integrator_ias15_block_record(struct reb_simulation* const r, const int l, const struct reb_simulation_integrator_ias15* const seg, const int Nl, const int* const map, const double dt){
+    const struct reb_ias15_block* const block = r->ri_ias15.block;
+    struct reb_particle* const particles = r->particles;
+    double s[9];
+    for (int m=0;m<l;m++){
+        if (block->offset[m+1]==block->offset[m]) continue;
+        const int j = block->index[l] - (block->index[m]<<(l-m)); // Substep within the step of level m
+        for (int n=1;n<8;n++){
+            const double hl = ldexp(h[n],l-m) - j;
+            if (hl<0. || hl>=1.) continue;
+            reb_integrator_ias15_position_coefficients(s, dt, hl);
+            reb_integrator_ias15_predict_positions(particles, seg, Nl, map, s);
+            reb_integrator_ias15_velocity_coefficients(s, dt, hl);
+            reb_integrator_ias15_predict_velocities(particles, seg, Nl, map, s);
+            double* const nodes = reb_integrator_ias15_block_nodes(block, m, n) + 6*(block->offset[l]-block->offset[m+1]);
+            for (int i=0;i<Nl;i++){
+                const int mi = map[i];
+                double* const node = nodes+6*i;
+                node[0] = particles[mi].x;
+                node[1] = particles[mi].y;
+                node[2] = particles[mi].z;
+                node[3] = particles[mi].vx;
+                node[4] = particles[mi].vy;
+                node[5] = particles[mi].vz;
+            }
+        }
+    }
+}
+
+// Estimates the error for each particle individually and stores the timestep it requires.
+static void reb_integrator_ias15_block_error(struct reb_simulation* const r, const struct reb_simulation_integrator_ias15* const seg, const int Nl, const int* const map, const double dt){
+    struct reb_ias15_block* const block = r->ri_ias15.block;
+    const struct reb_particle* const particles = r->particles;
+    const double* const at = seg->at;
+    const double* const b6 = seg->b.p6;
+    for(int i=0;i<Nl;i++){
+        const int mi = map[i];
+        double integrator_error = 0.0;
+        if (r->ri_ias15.epsilon_global){
+            double maxak = 0.0;
+            double maxb6k = 0.0;
+            const double v2 = particles[mi].vx*particles[mi].vx+particles[mi].vy*particles[mi].vy+particles[mi].vz*particles[mi].vz;
+            const double x2 = particles[mi].x*particles[mi].x+particles[mi].y*particles[mi].y+particles[mi].z*particles[mi].z;
+            // Skip slowly varying accelerations
+            if (fabs(v2*dt*dt/x2) < 1e-16) continue;
+            for(int k=3*i;k<3*(i+1);k++) { 
+                const double ak  = fabs(at[k]);
+                if (isnormal(ak) && ak>maxak){
+                    maxak = ak;
+                }
+                const double b6k = fabs(b6[k]); 
+                if (isnormal(b6k) && b6k>maxb6k){
+                    maxb6k = b6k;
+                }
+            }
+            integrator_error = maxb6k/maxak;
+        }else{
+            for(int k=3*i;k<3*(i+1);k++) { 
+                const double errork = fabs(b6[k]/at[k]);
+                if (isnormal(errork) && errork>integrator_error){
+                    integrator_error = errork;
+                }
+            }
+        }
+        double dt_new;
+        if  (isnormal(integrator_error)){   
+            dt_new = sqrt7(r->ri_ias15.epsilon/integrator_error)*fabs(dt);
+        }else{
+            dt_new = fabs(dt)/safety_factor;
+        }
+        if (dt_new<r->ri_ias15.min_dt) dt_new = r->ri_ias15.min_dt;
+        if (dt_new/fabs(dt) < safety_factor){
+            block->rejected = 1; // Timestep is significantly too large.
+        }
+        if (dt_new<block->dt_new[mi]){
+            block->dt_new[mi] = dt_new;
+        }
+    }
+}
+
+// Sets the particles between positions i_start and i_end in order to their final values.
+static void reb_integrator_ias15_block_restore(struct reb_simulation* const r, const int i_start, const int i_end){
+    const struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    struct reb_particle* const particles = r->particles;
+    const int* const order = ri->block->order;
+    for (int i=i_start;i<i_end;i++){
+        const int mi = order[i];
+        particles[mi].x  = ri->x0[3*i+0];
+        particles[mi].y  = ri->x0[3*i+1];
+        particles[mi].z  = ri->x0[3*i+2];
+        particles[mi].vx = ri->v0[3*i+0];
+        particles[mi].vy = ri->v0[3*i+1];
+        particles[mi].vz = ri->v0[3*i+2];
+    }
+}
+
+// Advances the particles on level l (and all finer levels) by one substep of level l.
+static void reb_integrator_ias15_block_advance(struct reb_simulation* const r, const int l){
+    struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    struct reb_ias15_block* const block = ri->block;
+    const int k = block->offset[l];
+    const int Nl = block->offset[l+1]-k;
+    int* const map = block->order+k;
+    const double dt = ldexp(r->dt,-l);
+    const double t0 = block->t_beginning + dt*block->index[l];
+    const struct reb_simulation_integrator_ias15 seg = reb_integrator_ias15_segment(ri, 3*k);
+
+    if (Nl){
+        if (block->index[l]){ // Forces at the beginning of the timestep are already known.
+            reb_integrator_ias15_block_positions(r, l, 0);
+            r->t = t0;
+            ri->activeN = Nl;
+            ri->active_map = map;
+            reb_update_acceleration(r);
+            ri->activeN = 0;
+        }
+        reb_integrator_ias15_begin(r, &seg, Nl, map);
+    }
+    if (l+1<block->levels && block->offset[l+1]<block->N){
+        // Particles on finer levels are advanced first.
+        for (int j=0;j<2;j++){
+            block->index[l+1] = 2*block->index[l]+j;
+            reb_integrator_ias15_block_advance(r, l+1);
+            if (block->rejected){
+                return;
+            }
+        }
+    }
+    if (Nl==0){
+        return;
+    }
+
+    r->t = t0;
+    ri->activeN = Nl;
+    ri->active_map = map;
+    reb_integrator_ias15_predictor_corrector(r, &seg, Nl, map, dt, l);
+    ri->activeN = 0;
+
+    if (ri->epsilon>0){
+        reb_integrator_ias15_block_error(r, &seg, Nl, map, dt);
+        if (block->rejected){
+            return;
+        }
+    }
+    reb_integrator_ias15_block_record(r, l, &seg, Nl, map, dt);
+    reb_integrator_ias15_update(&seg, 3*Nl, dt);
+    reb_integrator_ias15_block_restore(r, k, block->N);
+
+    const int N3 = 3*Nl;
+    const struct reb_dpconst7 e  = dpcast(seg.e);
+    const struct reb_dpconst7 b  = dpcast(seg.b);
+    copybuffers(e,dpcast(seg.er),N3);       
+    copybuffers(b,dpcast(seg.br),N3);       
+    if (block->index[l] < (1<<l)-1){
+        // The next substep on this level has the same length.
+        // The last substep is predicted once the new levels are known.
+        predict_next_step(1., N3, e, b, e, b);
+    }
+}
+
+// Chooses a new timestep and a new level for each particle. After a successful 
+// timestep, b and e are also predicted for the next timestep. 
+static void reb_integrator_ias15_block_assign(struct reb_simulation* const r, const int rejected){
+    struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    struct reb_ias15_block* const block = ri->block;
+    const int N = block->N;
+    const int levels = block->levels;
+    double* const dt_new = block->dt_new;
+    const double dt = fabs(r->dt);
+    double dt_max = 0.;
+    double dt_min = INFINITY;
+    for (int i=0;i<N;i++){
+        const double dt_level = ldexp(dt,-block->level[i]);
+        if (rejected){
+            if (!(dt_new[i]<dt_level)){
+                dt_new[i] = dt_level; // Keep timestep
+            }
+        }else{
+            if (!(dt_new[i]<dt_level/safety_factor)){
+                dt_new[i] = dt_level/safety_factor; // Don't increase the timestep by too much.
+            }
+        }
+        if (dt_new[i]>dt_max) dt_max = dt_new[i];
+        if (dt_new[i]<dt_min) dt_min = dt_new[i];
+    }
+    if (dt_min*ldexp(1.,levels-1)<dt_max){
+        dt_max = dt_min*ldexp(1.,levels-1); // The finest level needs to resolve the shortest timestep.
+    }
+
+    int changed = 0;
+    for (int i=0;i<N;i++){
+        int l = 0;
+        while (l<levels-1 && ldexp(dt_max,-l)>dt_new[i]){
+            l++;
+        }
+        if (!rejected){
+            const struct reb_simulation_integrator_ias15 seg = reb_integrator_ias15_segment(ri, 3*block->position[i]);
+            const double ratio = ldexp(dt_max,-l)/ldexp(dt,-block->level[i]);
+            predict_next_step(ratio, 3, dpcast(seg.er), dpcast(seg.br), dpcast(seg.e), dpcast(seg.b));
+        }
+        if (l!=block->level[i]){
+            block->level[i] = l;
+            changed = 1;
+        }
+        dt_new[i] = INFINITY;
+    }
+    r->dt = copysign(dt_max,r->dt);
+    if (!changed){
+        return;
+    }
+
+    // Sort particles by level and reorder all coefficients that are kept between timesteps
+    int* const order = malloc(sizeof(int)*N);
+    for (int l=0;l<=levels;l++){
+        block->offset[l] = 0;
+    }
+    for (int i=0;i<N;i++){
+        block->offset[block->level[i]+1]++;
+    }
+    for (int l=0;l<levels;l++){
+        block->offset[l+1] += block->offset[l];
+    }
+    for (int l=0;l<levels;l++){
+        block->index[l] = block->offset[l];
+    }
+    for (int i=0;i<N;i++){
+        order[block->index[block->level[i]]++] = i;
+    }
+    double* const tmp = ri->at;
+    double* arrays[] = {ri->b.p0, ri->b.p1, ri->b.p2, ri->b.p3, ri->b.p4, ri->b.p5, ri->b.p6, 
+                        ri->e.p0, ri->e.p1, ri->e.p2, ri->e.p3, ri->e.p4, ri->e.p5, ri->e.p6, 
+                        ri->csx, ri->csv};
+    for (int a=0;a<16;a++){
+        double* const array = arrays[a];
+        for (int i=0;i<N;i++){
+            const int k = 3*block->position[order[i]];
+            tmp[3*i+0] = array[k+0];
+            tmp[3*i+1] = array[k+1];
+            tmp[3*i+2] = array[k+2];
+        }
+        memcpy(array, tmp, sizeof(double)*3*N);
+    }
+    for (int i=0;i<N;i++){
+        block->order[i] = order[i];
+        block->position[order[i]] = i;
+    }
+    free(order);
+}
+
+// Does one timestep with block timesteps.
+static int reb_integrator_ias15_block_step(struct reb_simulation* const r){
+    struct reb_simulation_integrator_ias15* const ri = &(r->ri_ias15);
+    reb_integrator_ias15_alloc(r);
+    if (ri->block==NULL || ri->block->N!=r->N || ri->block->levels!=(int)ri->block_levels){
+        reb_integrator_ias15_block_init(r);
+    }
+    struct reb_ias15_block* const block = ri->block;
+    if (!reb_integrator_ias15_block_alloc_nodes(block)){
+        reb_error(r, "Cannot allocate memory for IAS15 block timesteps.");
+        return 1; // Do not repeat the step. The integration stops because of the error.
+    }
+    const int N = r->N;
+    memcpy(block->backup, r->particles, sizeof(struct reb_particle)*N);
+    memcpy(block->csx, ri->csx, sizeof(double)*3*N);
+    memcpy(block->csv, ri->csv, sizeof(double)*3*N);
+    block->t_beginning = r->t;
+    block->rejected = 0;
+    block->index[0] = 0;
+
+    reb_integrator_ias15_block_advance(r, 0);
+    
+    const double dt_done = r->dt;
+    if (block->rejected){
+        memcpy(r->particles, block->backup, sizeof(struct reb_particle)*N);
+        memcpy(ri->csx, block->csx, sizeof(double)*3*N);
+        memcpy(ri->csv, block->csv, sizeof(double)*3*N);
+        r->t = block->t_beginning;
+        clear_dp7(&(ri->b),3*N);
+        clear_dp7(&(ri->e),3*N);
+        reb_integrator_ias15_block_assign(r, 1);
+        return 0; // Step rejected. Do again. 
+    }
+    r->t = block->t_beginning + dt_done;
+    r->dt_last_done = dt_done;
+    if (ri->epsilon>0){
+        reb_integrator_ias15_block_assign(r, 0);
+    }else{
+        predict_next_step(1., 3*N, dpcast(ri->er), dpcast(ri->br), dpcast(ri->e), dpcast(ri->b));
+    }
+    return 1; // Success.
+}
+
+// Returns 1 if block timesteps can be used. 
+static int reb_integrator_ias15_block_check(struct reb_simulation* const r){
+    if (r->integrator!=REB_INTEGRATOR_IAS15 || r->ri_ias15.block_levels<2){
+        return 0;
+    }
+    const char* error = NULL;
+    if (r->N_var){
+        error = "IAS15 block timesteps do not support variational particles. Using a global timestep instead.";
+    }else if (r->gravity!=REB_GRAVITY_BASIC && r->gravity!=REB_GRAVITY_NONE){
+        error = "IAS15 block timesteps require gravity BASIC or NONE. Using a global timestep instead.";
+    }else if (r->ri_ias15.block_levels>block_levels_max){
+        error = "IAS15 block timesteps support at most 30 levels. Using a global timestep instead.";
+    }
+    if (error){
+        reb_warning(r, error);
+        r->ri_ias15.block_levels = 0;
+        return 0;
+    }
+    return 1;
+}
+
 // Do nothing here. This is only used in a leapfrog-like DKD integrator. IAS15 performs one complete timestep.
 void reb_integrator_ias15_part1(struct reb_simulation* r){
     r->gravity_ignore_terms = 0;
@@ -721,6 +1319,10 @@ void reb_integrator_ias15_part2(struct reb_simulation* r){
 #ifdef GENERATE_CONSTANTS
     integrator_generate_constants();
 #endif  // GENERATE_CONSTANTS
+    if (reb_integrator_ias15_block_check(r)){
+        while(!reb_integrator_ias15_block_step(r));
+        return;
+    }
     // Try until a step was successful.
     while(!reb_integrator_ias15_step(r));
 }
@@ -772,6 +1374,8 @@ void reb_integrator_ias15_reset(struct reb_simulation* r){
     r->ri_ias15.csa0 =  NULL;
     free(r->ri_ias15.map);
     r->ri_ias15.map =  NULL;
+    reb_integrator_ias15_block_free(r->ri_ias15.block);
+    r->ri_ias15.block = NULL;
 }
 
 #ifdef GENERATE_CONSTANTS
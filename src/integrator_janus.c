@@ -49,14 +49,14 @@ struct reb_janus_scheme {
     double gamma[17];       ///< Coefficients (padded with 0 if not used)
 };
 
-static struct reb_janus_scheme s1odr2 = {
+static const struct reb_janus_scheme s1odr2 = {
     .order = 2,
     .stages = 1,
     .gamma = {  1.,
                 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}
 };
 
-static struct reb_janus_scheme s5odr4 = {
+static const struct reb_janus_scheme s5odr4 = {
     .order = 4,
     .stages = 5,
     .gamma= {   0.41449077179437573714,
@@ -66,7 +66,7 @@ static struct reb_janus_scheme s5odr4 = {
             }
 };
 
-static struct reb_janus_scheme s9odr6a = {
+static const struct reb_janus_scheme s9odr6a = {
     .order = 6,
     .stages = 9,
     .gamma= {   0.39216144400731413928,
@@ -78,7 +78,7 @@ static struct reb_janus_scheme s9odr6a = {
     }
 };
 
-static struct reb_janus_scheme s15odr8 = {
+static const struct reb_janus_scheme s15odr8 = {
     .order = 8,
     .stages = 15,
     .gamma= {   .74167036435061295345,
@@ -93,7 +93,7 @@ static struct reb_janus_scheme s15odr8 = {
     }
 };
 
-static struct reb_janus_scheme s33odr10c = {
+static const struct reb_janus_scheme s33odr10c = {
     .order = 10,
     .stages = 33,
     .gamma= {  0.12313526870982994083,
@@ -124,8 +124,27 @@ static double gg(struct reb_janus_scheme s, unsigned int stage){
     }
 }
 
+static struct reb_janus_scheme reb_integrator_janus_scheme(struct reb_simulation* r){
+    switch (r->ri_janus.order){
+        case 2:
+            return s1odr2;
+        case 4:
+            return s5odr4;
+        case 6:
+            return s9odr6a;
+        case 8:
+            return s15odr8;
+        case 10:
+            return s33odr10c;
+        default:
+            reb_error(r,"Order not supported in JANUS.");
+            return s1odr2;
+    }
+}
+
 
 static void to_int(struct reb_particle_int* psi, struct reb_particle* ps, unsigned int N, double scale_pos, double scale_vel){
+#pragma omp parallel for
     for(unsigned int i=0; i<N; i++){ 
         psi[i].x = ps[i].x/scale_pos; 
         psi[i].y = ps[i].y/scale_pos; 
@@ -136,6 +155,7 @@ static void to_int(struct reb_particle_int* psi, struct reb_particle* ps, unsign
     }
 }
 static void to_double(struct reb_particle* ps, struct reb_particle_int* psi, unsigned int N, double scale_pos, double scale_vel){
+#pragma omp parallel for
     for(unsigned int i=0; i<N; i++){ 
         ps[i].x = ((double)psi[i].x)*scale_pos; 
         ps[i].y = ((double)psi[i].y)*scale_pos; 
@@ -146,23 +166,35 @@ static void to_double(struct reb_particle* ps, struct reb_particle_int* psi, uns
     }
 }
 
-static void drift(struct reb_simulation* r, double dt, double scale_pos, double scale_vel){
-    struct reb_simulation_integrator_janus* ri_janus = &(r->ri_janus);
-    const unsigned int N = r->N;
-    for(unsigned int i=0; i<N; i++){
-        ri_janus->p_int[i].x += (REB_PARTICLE_INT_TYPE)(dt*(double)ri_janus->p_int[i].vx*scale_vel/scale_pos) ;
-        ri_janus->p_int[i].y += (REB_PARTICLE_INT_TYPE)(dt*(double)ri_janus->p_int[i].vy*scale_vel/scale_pos) ;
-        ri_janus->p_int[i].z += (REB_PARTICLE_INT_TYPE)(dt*(double)ri_janus->p_int[i].vz*scale_vel/scale_pos) ;
-    }
-}
-
-static void kick(struct reb_simulation* r, double dt, double scale_vel){
-    struct reb_simulation_integrator_janus* ri_janus = &(r->ri_janus);
+/**
+ * Kick (if dt_kick is not 0) followed by a drift. The new positions (and 
+ * velocities if requested) are converted to floating point in the same 
+ * pass. Each particle is updated independently with integer arithmetic, 
+ * so the result is exactly reversible and does not depend on the number 
+ * of threads.
+ **/
+static void kick_drift(struct reb_simulation* r, double dt_kick, double dt_drift, double scale_pos, double scale_vel, int velocities){
+    struct reb_particle_int* const p_int = r->ri_janus.p_int;
+    struct reb_particle* const particles = r->particles;
     const unsigned int N = r->N;
+#pragma omp parallel for
     for(unsigned int i=0; i<N; i++){
-        ri_janus->p_int[i].vx += (REB_PARTICLE_INT_TYPE)(dt*r->particles[i].ax/scale_vel) ;
-        ri_janus->p_int[i].vy += (REB_PARTICLE_INT_TYPE)(dt*r->particles[i].ay/scale_vel) ;
-        ri_janus->p_int[i].vz += (REB_PARTICLE_INT_TYPE)(dt*r->particles[i].az/scale_vel) ;
+        if (dt_kick!=0.){
+            p_int[i].vx += (REB_PARTICLE_INT_TYPE)(dt_kick*particles[i].ax/scale_vel) ;
+            p_int[i].vy += (REB_PARTICLE_INT_TYPE)(dt_kick*particles[i].ay/scale_vel) ;
+            p_int[i].vz += (REB_PARTICLE_INT_TYPE)(dt_kick*particles[i].az/scale_vel) ;
+        }
+        p_int[i].x += (REB_PARTICLE_INT_TYPE)(dt_drift*(double)p_int[i].vx*scale_vel/scale_pos) ;
+        p_int[i].y += (REB_PARTICLE_INT_TYPE)(dt_drift*(double)p_int[i].vy*scale_vel/scale_pos) ;
+        p_int[i].z += (REB_PARTICLE_INT_TYPE)(dt_drift*(double)p_int[i].vz*scale_vel/scale_pos) ;
+        particles[i].x = ((double)p_int[i].x)*scale_pos; 
+        particles[i].y = ((double)p_int[i].y)*scale_pos; 
+        particles[i].z = ((double)p_int[i].z)*scale_pos; 
+        if (velocities){
+            particles[i].vx = ((double)p_int[i].vx)*scale_vel; 
+            particles[i].vy = ((double)p_int[i].vy)*scale_vel; 
+            particles[i].vz = ((double)p_int[i].vz)*scale_vel; 
+        }
     }
 }
 
@@ -184,73 +216,29 @@ void reb_integrator_janus_part1(struct reb_simulation* r){
         ri_janus->recalculate_integer_coordinates_this_timestep = 0;
     }
 
-    struct reb_janus_scheme s;
-    switch (ri_janus->order){
-        case 2:
-            s = s1odr2;
-            break;
-        case 4:
-            s = s5odr4;
-            break;
-        case 6:
-            s = s9odr6a;
-            break;
-        case 8:
-            s = s15odr8;
-            break;
-        case 10:
-            s = s33odr10c;
-            break;
-        default:
-            s = s1odr2;
-            reb_error(r,"Order not supported in JANUS.");
-    }
+    const struct reb_janus_scheme s = reb_integrator_janus_scheme(r);
 
-    drift(r,gg(s,0)*dt/2.,scale_pos,scale_vel);
-    to_double(r->particles, r->ri_janus.p_int, r->N, scale_pos, scale_vel); 
+    // Floating point velocities are only needed within the timestep if additional forces might use them.
+    kick_drift(r,0.,s.gamma[0]*dt/2.,scale_pos,scale_vel,r->additional_forces!=NULL);
 }
 
 void reb_integrator_janus_part2(struct reb_simulation* r){
     struct reb_simulation_integrator_janus* ri_janus = &(r->ri_janus);
-    const unsigned int N = r->N;
     const double scale_vel  = ri_janus->scale_vel;
     const double scale_pos  = ri_janus->scale_pos;
     const double dt = r->dt;
     
-    struct reb_janus_scheme s;
-    switch (ri_janus->order){
-        case 2:
-            s = s1odr2;
-            break;
-        case 4:
-            s = s5odr4;
-            break;
-        case 6:
-            s = s9odr6a;
-            break;
-        case 8:
-            s = s15odr8;
-            break;
-        case 10:
-            s = s33odr10c;
-            break;
-        default:
-            s = s1odr2;
-            reb_error(r,"Order not supported in JANUS.");
-    }
+    const struct reb_janus_scheme s = reb_integrator_janus_scheme(r);
    
-    kick(r,gg(s,0)*dt, scale_vel);
+    double gamma = s.gamma[0];
     for (unsigned int i=1; i<s.stages; i++){
-        drift(r,(gg(s,i-1)+gg(s,i))*dt/2.,scale_pos,scale_vel);
-        to_double(r->particles, r->ri_janus.p_int, N, scale_pos, scale_vel); 
+        const double gamma_next = gg(s,i);
+        kick_drift(r,gamma*dt,(gamma+gamma_next)*dt/2.,scale_pos,scale_vel,r->additional_forces!=NULL);
         reb_update_acceleration(r);
-        kick(r,gg(s,i)*dt, scale_vel);
+        gamma = gamma_next;
     }
-    drift(r,gg(s,s.stages-1)*dt/2.,scale_pos,scale_vel);
-
-    // Small overhead here: Always get positions and velocities in floating point at 
-    // the end of the timestep.
-    reb_integrator_janus_synchronize(r);
+    // Always get positions and velocities in floating point at the end of the timestep.
+    kick_drift(r,gamma*dt,gamma*dt/2.,scale_pos,scale_vel,1);
 
     r->t += r->dt;
 }
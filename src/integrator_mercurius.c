@@ -260,8 +260,13 @@ void reb_integrator_mercurius_com_step(struct reb_simulation* const r, double dt
 void reb_integrator_mercurius_kepler_step(struct reb_simulation* const r, double dt){
     struct reb_particle* restrict const particles = r->particles;
     const int N = r->N;
-    for (int i=1;i<N;i++){
-        reb_whfast_kepler_solver(r,particles,r->G*particles[0].m,i,dt); // in dh
+    double M[REB_WHFAST_KEPLER_LANES];
+    for (int l=0;l<REB_WHFAST_KEPLER_LANES;l++){
+        M[l] = r->G*particles[0].m;
+    }
+    for (int i=1;i<N;i+=REB_WHFAST_KEPLER_LANES){
+        const int n = MIN(REB_WHFAST_KEPLER_LANES, N-i);
+        reb_whfast_kepler_solver_lanes(r,particles,M,i,n,dt); // in dh
     }
 }
 
@@ -78,6 +78,16 @@ static int reb_saba_stages(const int type){
 }
 
 
+// Index of the coefficient in reb_saba_d used for the j-th kick (the schemes are symmetric).
+static inline int reb_saba_kick_index(const int stages, const int j){
+    return j>(stages-1)/2 ? stages-j-1 : j;
+}
+
+// Index of the coefficient in reb_saba_c used for the j-th drift (the schemes are symmetric).
+static inline int reb_saba_drift_index(const int stages, const int j){
+    return j>stages/2 ? stages-j : j;
+}
+
 // Some coefficients appear multiple times to simplify the loop structures. 
 const static double reb_saba_c[10][5] = {
         {0.5, }, // SABA1
@@ -302,27 +312,18 @@ void reb_integrator_saba_part2(struct reb_simulation* const r){
         return;
     }
     
-    reb_whfast_interaction_step(r, reb_saba_d[type%0x100][0]*r->dt);
-  
-    for(int j=1;j<stages;j++){
-        {
-            int i = j;
-            if (j>stages/2){
-                i = stages-j;
-            }
-            reb_whfast_kepler_step(r, reb_saba_c[type%0x100][i]*r->dt);   
-            reb_whfast_com_step(r, reb_saba_c[type%0x100][i]*r->dt);
-        }
-        {
-            int i = j;
-            if (j>(stages-1)/2){
-                i = stages-j-1;
-            }
-            reb_transformations_jacobi_to_inertial_pos(particles, ri_whfast->p_jh, particles, N);
-            reb_update_acceleration(r);
-            reb_whfast_interaction_step(r, reb_saba_d[type%0x100][i]*r->dt);
-        }
+    // Stage j consists of the kick with d[reb_saba_kick_index(j)] and the following 
+    // drift with c[reb_saba_drift_index(j+1)]. Each kick and the following drift 
+    // are done in one pass over the particles.
+    for(int j=0;j<stages-1;j++){
+        const double dt_kick = reb_saba_d[type%0x100][reb_saba_kick_index(stages, j)]*r->dt;
+        const double dt_drift = reb_saba_c[type%0x100][reb_saba_drift_index(stages, j+1)]*r->dt;
+        reb_whfast_interaction_kepler_step(r, dt_kick, dt_drift);
+        reb_whfast_com_step(r, dt_drift);
+        reb_transformations_jacobi_to_inertial_pos(particles, ri_whfast->p_jh, particles, N);
+        reb_update_acceleration(r);
     } 
+    reb_whfast_interaction_step(r, reb_saba_d[type%0x100][reb_saba_kick_index(stages, stages-1)]*r->dt);
 
     if (ri_saba->type>=0x100){ // correctors on
         // Always need to do drift step if correctors are turned on
@@ -44,6 +44,7 @@
 
 static void operator_H012(double dt, const struct reb_simulation_integrator_sei ri_sei, struct reb_particle* p);
 static void operator_phi1(double dt, struct reb_particle* p);
+static void operator_shear_wrap(const struct reb_vec3d boxsize, const double OMEGA, const double offsetp1, const double offsetm1, struct reb_particle* p);
 
 
 void reb_integrator_sei_init(struct reb_simulation* const r){
@@ -71,10 +72,27 @@ void reb_integrator_sei_part1(struct reb_simulation* const r){
         reb_integrator_sei_init(r);
 	}
 	const struct reb_simulation_integrator_sei ri_sei = r->ri_sei;
+    // reb_step() checks the boundary after part1 only if a tree is used. 
+    // In that case the shear-periodic wrap is fused with the drift.
+    const int wrap = r->boundary==REB_BOUNDARY_SHEAR && (r->tree_needs_update || r->gravity==REB_GRAVITY_TREE || r->collision==REB_COLLISION_TREE || r->collision==REB_COLLISION_LINETREE);
+    if (wrap){
+        const struct reb_vec3d boxsize = r->boxsize;
+        const double OMEGA = r->ri_sei.OMEGA;
+        const double t = r->t+r->dt/2.;
+        const double offsetp1 = -fmod(-1.5*OMEGA*boxsize.x*t+boxsize.y/2.,boxsize.y)-boxsize.y/2.; 
+        const double offsetm1 = -fmod( 1.5*OMEGA*boxsize.x*t-boxsize.y/2.,boxsize.y)+boxsize.y/2.; 
 #pragma omp parallel for schedule(guided)
-	for (int i=0;i<N;i++){
-		operator_H012(r->dt, ri_sei, &(particles[i]));
-	}
+        for (int i=0;i<N;i++){
+            operator_H012(r->dt, ri_sei, &(particles[i]));
+            operator_shear_wrap(boxsize, OMEGA, offsetp1, offsetm1, &(particles[i]));
+        }
+    }else{
+#pragma omp parallel for schedule(guided)
+        for (int i=0;i<N;i++){
+            operator_H012(r->dt, ri_sei, &(particles[i]));
+        }
+    }
+    r->ri_sei.boundary_wrapped = wrap;
 	r->t+=r->dt/2.;
 }
 
@@ -82,11 +100,29 @@ void reb_integrator_sei_part2(struct reb_simulation* r){
 	const int N = r->N;
 	struct reb_particle* const particles = r->particles;
 	const struct reb_simulation_integrator_sei ri_sei = r->ri_sei;
+    // reb_step() always checks the boundary after part2. 
+    // The shear-periodic wrap is fused with the kick and drift.
+    const int wrap = r->boundary==REB_BOUNDARY_SHEAR;
+    if (wrap){
+        const struct reb_vec3d boxsize = r->boxsize;
+        const double OMEGA = r->ri_sei.OMEGA;
+        const double t = r->t+r->dt/2.;
+        const double offsetp1 = -fmod(-1.5*OMEGA*boxsize.x*t+boxsize.y/2.,boxsize.y)-boxsize.y/2.; 
+        const double offsetm1 = -fmod( 1.5*OMEGA*boxsize.x*t-boxsize.y/2.,boxsize.y)+boxsize.y/2.; 
 #pragma omp parallel for schedule(guided)
-	for (int i=0;i<N;i++){
-		operator_phi1(r->dt, &(particles[i]));
-		operator_H012(r->dt, ri_sei, &(particles[i]));
-	}
+        for (int i=0;i<N;i++){
+            operator_phi1(r->dt, &(particles[i]));
+            operator_H012(r->dt, ri_sei, &(particles[i]));
+            operator_shear_wrap(boxsize, OMEGA, offsetp1, offsetm1, &(particles[i]));
+        }
+    }else{
+#pragma omp parallel for schedule(guided)
+        for (int i=0;i<N;i++){
+            operator_phi1(r->dt, &(particles[i]));
+            operator_H012(r->dt, ri_sei, &(particles[i]));
+        }
+    }
+    r->ri_sei.boundary_wrapped = wrap;
 	r->t+=r->dt/2.;
 	r->dt_last_done = r->dt;
 }
@@ -97,6 +133,7 @@ void reb_integrator_sei_synchronize(struct reb_simulation* r){
 
 void reb_integrator_sei_reset(struct reb_simulation* r){
 	r->ri_sei.lastdt = 0;	
+	r->ri_sei.boundary_wrapped = 0;	
 }
 
 /**
@@ -156,3 +193,40 @@ static void operator_phi1(double dt, struct reb_particle* p){
 	p->vz += p->az * dt;
 }
 
+/**
+ * @brief This function applies the shear-periodic boundary conditions.
+ * @details Same as the REB_BOUNDARY_SHEAR case in reb_boundary_check(),
+ * but for a single particle so that it can be fused with the other operators.
+ * @param boxsize Size of the box
+ * @param OMEGA Epicyclic frequency
+ * @param offsetp1 Azimuthal offset for particles leaving the box in the positive x direction
+ * @param offsetm1 Azimuthal offset for particles leaving the box in the negative x direction
+ * @param p reb_particle to wrap.
+ */
+static void operator_shear_wrap(const struct reb_vec3d boxsize, const double OMEGA, const double offsetp1, const double offsetm1, struct reb_particle* p){
+	// Radial
+	while(p->x>boxsize.x/2.){
+		p->x -= boxsize.x;
+		p->y += offsetp1;
+		p->vy += 3./2.*OMEGA*boxsize.x;
+	}
+	while(p->x<-boxsize.x/2.){
+		p->x += boxsize.x;
+		p->y += offsetm1;
+		p->vy -= 3./2.*OMEGA*boxsize.x;
+	}
+	// Azimuthal
+	while(p->y>boxsize.y/2.){
+		p->y -= boxsize.y;
+	}
+	while(p->y<-boxsize.y/2.){
+		p->y += boxsize.y;
+	}
+	// Vertical
+	while(p->z>boxsize.z/2.){
+		p->z -= boxsize.z;
+	}
+	while(p->z<-boxsize.z/2.){
+		p->z += boxsize.z;
+	}
+}
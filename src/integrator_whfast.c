@@ -81,6 +81,64 @@ static inline double fastabs(double x){
         return (x > 0.) ? x : -x;
 }
 
+// Compensated (Kahan) summation, same as in IAS15
+static inline void add_cs(double* p, double* csp, double inp){
+    const double y = inp - *csp;
+    const double t = *p + y;
+    *csp = (t - *p) - y;
+    *p = t;
+}
+
+// Returns the compensation terms of particle i if compensated summation is used for p_j, NULL otherwise.
+static inline double* reb_whfast_cs(const struct reb_simulation* const r, const struct reb_particle* const p_j, const unsigned int i){
+    const struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
+    if (ri_whfast->compensated && ri_whfast->p_jh_cs && p_j==ri_whfast->p_jh && i<ri_whfast->allocated_N_cs){
+        return ri_whfast->p_jh_cs+6*i;
+    }
+    return NULL;
+}
+
+// Adds increments to the position of a particle. Uses compensated summation if cs is not NULL.
+static inline void reb_whfast_add_pos(struct reb_particle* const p, double* const cs, const double dx, const double dy, const double dz){
+    if (cs){
+        add_cs(&p->x, &cs[0], dx);
+        add_cs(&p->y, &cs[1], dy);
+        add_cs(&p->z, &cs[2], dz);
+    }else{
+        p->x += dx;
+        p->y += dy;
+        p->z += dz;
+    }
+}
+
+// Adds increments to the velocity of a particle. Uses compensated summation if cs is not NULL.
+static inline void reb_whfast_add_vel(struct reb_particle* const p, double* const cs, const double dvx, const double dvy, const double dvz){
+    if (cs){
+        add_cs(&p->vx, &cs[3], dvx);
+        add_cs(&p->vy, &cs[4], dvy);
+        add_cs(&p->vz, &cs[5], dvz);
+    }else{
+        p->vx += dvx;
+        p->vy += dvy;
+        p->vz += dvz;
+    }
+}
+
+// Advances the simulation time. Uses compensated summation in compensated mode.
+static void reb_whfast_advance_time(struct reb_simulation* const r, const double dt){
+    struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
+    if (ri_whfast->compensated){
+        if (r->t != ri_whfast->t_last){
+            // Time has been changed since the last step. Compensation term is no longer valid.
+            ri_whfast->t_cs = 0.;
+        }
+        add_cs(&r->t, &ri_whfast->t_cs, dt);
+        ri_whfast->t_last = r->t;
+    }else{
+        r->t += dt;
+    }
+}
+
 static void stumpff_cs(double *restrict cs, double z) {
     unsigned int n = 0;
     while(fastabs(z)>0.1){
@@ -157,6 +215,52 @@ static void stiefel_Gs3(double *restrict Gs, double beta, double X) {
     return;
 }
 
+static void stiefel_Gs3_lanes(double (*restrict Gs)[REB_WHFAST_KEPLER_LANES], const double* restrict beta, const double* restrict X, const unsigned int n) {
+    // Same arithmetic as stiefel_Gs3(), but for n orbits at once.
+    // The number of range reductions differs between lanes and is applied with a mask.
+    double z[REB_WHFAST_KEPLER_LANES];
+    unsigned int nred[REB_WHFAST_KEPLER_LANES];
+    unsigned int nred_max = 0;
+    for (unsigned int l=0;l<n;l++){
+        z[l] = beta[l]*(X[l]*X[l]);
+        nred[l] = 0;
+        while(fabs(z[l])>0.1){
+            z[l] = z[l]/4.;
+            nred[l]++;
+        }
+        nred_max = MAX(nred_max, nred[l]);
+    }
+    const int nmax = 13;
+    for (unsigned int l=0;l<n;l++){
+        double c_odd  = invfactorial[nmax];
+        double c_even = invfactorial[nmax-1];
+        for(int np=nmax-2;np>=3;np-=2){
+            c_odd  = invfactorial[np]    - z[l] *c_odd;
+            c_even = invfactorial[np-1]  - z[l] *c_even;
+        }
+        Gs[3][l] = c_odd;
+        Gs[2][l] = c_even;
+        Gs[1][l] = invfactorial[1]  - z[l] *c_odd;
+        Gs[0][l] = invfactorial[0]  - z[l] *c_even;
+    }
+    for (unsigned int k=0;k<nred_max;k++){
+        for (unsigned int l=0;l<n;l++){
+            if (k<nred[l]){
+                Gs[3][l] = (Gs[2][l]+Gs[0][l]*Gs[3][l])*0.25;
+                Gs[2][l] = Gs[1][l]*Gs[1][l]*0.5;
+                Gs[1][l] = Gs[0][l]*Gs[1][l];
+                Gs[0][l] = 2.*Gs[0][l]*Gs[0][l]-1.;
+            }
+        }
+    }
+    for (unsigned int l=0;l<n;l++){
+        const double X2 = X[l]*X[l];
+        Gs[1][l] *= X[l]; 
+        Gs[2][l] *= X2; 
+        Gs[3][l] *= X2*X[l];
+    }
+}
+
 #define WHFAST_NMAX_QUART 64    ///< Maximum number of iterations for quartic solver
 #define WHFAST_NMAX_NEWT  32    ///< Maximum number of iterations for Newton's method
 /************************************
@@ -212,7 +316,7 @@ void reb_whfast_kepler_solver(const struct reb_simulation* const r, struct reb_p
         // Quartic solver
         // Linear initial guess
         X = beta*_dt/M;
-        static double prevX[WHFAST_NMAX_QUART+1];
+        double prevX[WHFAST_NMAX_QUART+1];
         for(int n_lag=1; n_lag < WHFAST_NMAX_QUART; n_lag++){
             stiefel_Gs3(Gs, beta, X);
             const double f = r0*X + eta0*Gs[2] + zeta0*Gs[3] - _dt;
@@ -303,13 +407,9 @@ void reb_whfast_kepler_solver(const struct reb_simulation* const r, struct reb_p
     double fd = -M*Gs[1]*r0i*ri; 
     double gd = -M*Gs[2]*ri; 
         
-    p_j[i].x += f*p1.x + g*p1.vx;
-    p_j[i].y += f*p1.y + g*p1.vy;
-    p_j[i].z += f*p1.z + g*p1.vz;
-        
-    p_j[i].vx += fd*p1.x + gd*p1.vx;
-    p_j[i].vy += fd*p1.y + gd*p1.vy;
-    p_j[i].vz += fd*p1.z + gd*p1.vz;
+    double* const cs = reb_whfast_cs(r, p_j, i);
+    reb_whfast_add_pos(&p_j[i], cs, f*p1.x + g*p1.vx, f*p1.y + g*p1.vy, f*p1.z + g*p1.vz);
+    reb_whfast_add_vel(&p_j[i], cs, fd*p1.x + gd*p1.vx, fd*p1.y + gd*p1.vy, fd*p1.z + gd*p1.vz);
 
     //Variations
     for (int v=0;v<r->var_config_N;v++){
@@ -347,6 +447,125 @@ void reb_whfast_kepler_solver(const struct reb_simulation* const r, struct reb_p
 
 }
 
+/************************************
+ * Keplerian motion for n planets with
+ * consecutive indices, solved together */
+void reb_whfast_kepler_solver_lanes(const struct reb_simulation* const r, struct reb_particle* const restrict p_j, const double* const restrict M, unsigned int i, unsigned int n, double _dt){
+    if (r->var_config_N){
+        // Variational equations need the full set of Stiefel functions. Use the scalar solver.
+        for (unsigned int l=0;l<n;l++){
+            reb_whfast_kepler_solver(r, p_j, M[l], i+l, _dt);
+        }
+        return;
+    }
+    double r0[REB_WHFAST_KEPLER_LANES];
+    double r0i[REB_WHFAST_KEPLER_LANES];
+    double beta[REB_WHFAST_KEPLER_LANES] = {0};
+    double eta0[REB_WHFAST_KEPLER_LANES];
+    double zeta0[REB_WHFAST_KEPLER_LANES];
+    double X[REB_WHFAST_KEPLER_LANES] = {0};
+    double oldX[REB_WHFAST_KEPLER_LANES];
+    double oldX2[REB_WHFAST_KEPLER_LANES];
+    double ri[REB_WHFAST_KEPLER_LANES];
+    double Gs[4][REB_WHFAST_KEPLER_LANES];
+    double Gs_new[4][REB_WHFAST_KEPLER_LANES];
+    int active[REB_WHFAST_KEPLER_LANES];   // Newton iteration still running
+    int scalar[REB_WHFAST_KEPLER_LANES];   // Lane needs the quartic solver or bisection
+
+    for (unsigned int l=0;l<n;l++){
+        const struct reb_particle p1 = p_j[i+l];
+        r0[l] = sqrt(p1.x*p1.x + p1.y*p1.y + p1.z*p1.z);
+        r0i[l] = 1./r0[l];
+        const double v2 =  p1.vx*p1.vx + p1.vy*p1.vy + p1.vz*p1.vz;
+        beta[l] = 2.*M[l]*r0i[l] - v2;
+        eta0[l] = p1.x*p1.vx + p1.y*p1.vy + p1.z*p1.vz;
+        zeta0[l] = M[l] - beta[l]*r0[l];
+        if (beta[l]>0.){
+            // Elliptic orbit
+            const double sqrt_beta = sqrt(beta[l]);
+            const double invperiod = sqrt_beta*beta[l]/(2.*M_PI*M[l]);
+            if (fabs(_dt)*invperiod>1. && r->ri_whfast.timestep_warning == 0){
+                ((struct reb_simulation* const)r)->ri_whfast.timestep_warning++;
+                reb_warning((struct reb_simulation* const)r,"WHFast convergence issue. Timestep is larger than at least one orbital period.");
+            }
+            const double dtr0i = _dt*r0i[l];
+            X[l] = dtr0i * (1. - dtr0i*eta0[l]*0.5*r0i[l]); // second order guess
+        }else{
+            // Hyperbolic orbit
+            X[l] = 0.; // Initial guess 
+        }
+        oldX[l] = X[l];
+    }
+
+    // Do one Newton step
+    stiefel_Gs3_lanes(Gs, beta, X, n);
+    for (unsigned int l=0;l<n;l++){
+        const double eta0Gs1zeta0Gs2 = eta0[l]*Gs[1][l] + zeta0[l]*Gs[2][l];
+        ri[l] = 1./(r0[l] + eta0Gs1zeta0Gs2);
+        X[l]  = ri[l]*(X[l]*eta0Gs1zeta0Gs2-eta0[l]*Gs[2][l]-zeta0[l]*Gs[3][l]+_dt);
+        // Large steps need the quartic solver. Hyperbolic orbits always use Newton's method.
+        scalar[l] = beta[l]>0. && fastabs(X[l]-oldX[l]) > 0.01*(2.*M_PI/sqrt(beta[l]));
+        active[l] = !scalar[l];
+        oldX2[l] = nan("");
+    }
+
+    // Newton's method, all lanes advance together until every lane has converged
+    for (int n_hg=1;n_hg<WHFAST_NMAX_NEWT;n_hg++){
+        int n_active = 0;
+        for (unsigned int l=0;l<n;l++){
+            n_active += active[l];
+        }
+        if (n_active==0){
+            break;
+        }
+        stiefel_Gs3_lanes(Gs_new, beta, X, n);
+        for (unsigned int l=0;l<n;l++){
+            if (active[l]){
+                Gs[0][l] = Gs_new[0][l];
+                Gs[1][l] = Gs_new[1][l];
+                Gs[2][l] = Gs_new[2][l];
+                Gs[3][l] = Gs_new[3][l];
+                oldX2[l] = oldX[l];
+                oldX[l] = X[l];
+                const double eta0Gs1zeta0Gs2 = eta0[l]*Gs[1][l] + zeta0[l]*Gs[2][l];
+                ri[l] = 1./(r0[l] + eta0Gs1zeta0Gs2);
+                X[l]  = ri[l]*(X[l]*eta0Gs1zeta0Gs2-eta0[l]*Gs[2][l]-zeta0[l]*Gs[3][l]+_dt);
+                if (X[l]==oldX[l]||X[l]==oldX2[l]){
+                    // Converged.
+                    active[l] = 0;
+                }
+            }
+        }
+    }
+
+    for (unsigned int l=0;l<n;l++){
+        if (scalar[l] || active[l]){
+            // Not converged. The scalar solver falls back to the quartic solver or bisection. 
+            // The particle has not been modified yet.
+            reb_whfast_kepler_solver(r, p_j, M[l], i+l, _dt);
+            continue;
+        }
+        if (isnan(ri[l])){
+            // Exception for (almost) straight line motion in hyperbolic case
+            ri[l] = 0.;
+            Gs[1][l] = 0.;
+            Gs[2][l] = 0.;
+            Gs[3][l] = 0.;
+        }
+        const struct reb_particle p1 = p_j[i+l];
+        
+        // Note: These are not the traditional f and g functions.
+        double f = -M[l]*Gs[2][l]*r0i[l];
+        double g = _dt - M[l]*Gs[3][l];
+        double fd = -M[l]*Gs[1][l]*r0i[l]*ri[l]; 
+        double gd = -M[l]*Gs[2][l]*ri[l]; 
+            
+        double* const cs = reb_whfast_cs(r, p_j, i+l);
+        reb_whfast_add_pos(&p_j[i+l], cs, f*p1.x + g*p1.vx, f*p1.y + g*p1.vy, f*p1.z + g*p1.vz);
+        reb_whfast_add_vel(&p_j[i+l], cs, fd*p1.x + gd*p1.vx, fd*p1.y + gd*p1.vy, fd*p1.z + gd*p1.vz);
+    }
+}
+
 /***************************** 
  * Interaction Hamiltonian  */
 void reb_whfast_interaction_step(struct reb_simulation* const r, const double _dt){
@@ -374,12 +593,11 @@ void reb_whfast_interaction_step(struct reb_simulation* const r, const double _d
                 // Eq 132
                 const struct reb_particle pji = p_j[i];
                 eta += pji.m;
-                static double rj2i;
-                static double rj3iM;
-                static double prefac1;
-                p_j[i].vx += _dt * pji.ax;
-                p_j[i].vy += _dt * pji.ay;
-                p_j[i].vz += _dt * pji.az;
+                double rj2i = 0.;
+                double rj3iM = 0.;
+                double prefac1 = 0.;
+                double* const cs = reb_whfast_cs(r, p_j, i);
+                reb_whfast_add_vel(&p_j[i], cs, _dt * pji.ax, _dt * pji.ay, _dt * pji.az);
                 if (r->gravity != REB_GRAVITY_JACOBI){ 
                     // If Jacobi terms have not been added in update_acceleration, then add them here:
                     if (i>1){
@@ -387,9 +605,7 @@ void reb_whfast_interaction_step(struct reb_simulation* const r, const double _d
                         const double rji  = sqrt(rj2i);
                         rj3iM = rji*rj2i*G*eta;
                         prefac1 = _dt*rj3iM;
-                        p_j[i].vx += prefac1*pji.x;
-                        p_j[i].vy += prefac1*pji.y;
-                        p_j[i].vz += prefac1*pji.z;
+                        reb_whfast_add_vel(&p_j[i], cs, prefac1*pji.x, prefac1*pji.y, prefac1*pji.z);
                     }
                 }
                 for(int v=0;v<r->var_config_N;v++){
@@ -413,18 +629,14 @@ void reb_whfast_interaction_step(struct reb_simulation* const r, const double _d
         case REB_WHFAST_COORDINATES_DEMOCRATICHELIOCENTRIC:
 #pragma omp parallel for 
             for (unsigned int i=1;i<N_real;i++){
-                p_j[i].vx += _dt*particles[i].ax;
-                p_j[i].vy += _dt*particles[i].ay;
-                p_j[i].vz += _dt*particles[i].az;
+                reb_whfast_add_vel(&p_j[i], reb_whfast_cs(r, p_j, i), _dt*particles[i].ax, _dt*particles[i].ay, _dt*particles[i].az);
             }
             break;
         case REB_WHFAST_COORDINATES_WHDS:
 #pragma omp parallel for 
             for (unsigned int i=1;i<N_real;i++){
                 const double mi = particles[i].m;
-                p_j[i].vx += _dt*(m0+mi)*particles[i].ax/m0;
-                p_j[i].vy += _dt*(m0+mi)*particles[i].ay/m0;
-                p_j[i].vz += _dt*(m0+mi)*particles[i].az/m0;
+                reb_whfast_add_vel(&p_j[i], reb_whfast_cs(r, p_j, i), _dt*(m0+mi)*particles[i].ax/m0, _dt*(m0+mi)*particles[i].ay/m0, _dt*(m0+mi)*particles[i].az/m0);
             }
             break;
     };
@@ -482,27 +694,81 @@ void reb_whfast_jump_step(const struct reb_simulation* const r, const double _dt
 /***************************** 
  * DKD Scheme                */
 
-void reb_whfast_kepler_step(const struct reb_simulation* const r, const double _dt){
+static void reb_whfast_kepler_step_N(const struct reb_simulation* const r, const double _dt, const int N_real){
     const double m0 = r->particles[0].m;
     const double G = r->G;
-    const unsigned int N_real = r->N-r->N_var;
     const int coordinates = r->ri_whfast.coordinates;
     struct reb_particle* const p_j = r->ri_whfast.p_jh;
-    double eta = m0;
+    if (coordinates==REB_WHFAST_COORDINATES_JACOBI){
+        // Jacobi masses are a running sum. Process groups in order. 
+        double eta = m0;
+        for (int i=1;i<N_real;i+=REB_WHFAST_KEPLER_LANES){
+            const int n = MIN(REB_WHFAST_KEPLER_LANES, N_real-i);
+            double M[REB_WHFAST_KEPLER_LANES];
+            for (int l=0;l<n;l++){
+                eta += p_j[i+l].m;
+                M[l] = eta*G;
+            }
+            reb_whfast_kepler_solver_lanes(r, p_j, M, i, n, _dt);
+        }
+    }else{
 #pragma omp parallel for 
-    for (unsigned int i=1;i<N_real;i++){
-        switch (coordinates){
-            case REB_WHFAST_COORDINATES_JACOBI:
-                eta += p_j[i].m;
-                break;
-            case REB_WHFAST_COORDINATES_DEMOCRATICHELIOCENTRIC:
-                //  eta = m0
-                break;
-            case REB_WHFAST_COORDINATES_WHDS:
-                eta = m0+p_j[i].m;
-                break;
-        };
-        reb_whfast_kepler_solver(r, p_j, eta*G, i, _dt);
+        for (int i=1;i<N_real;i+=REB_WHFAST_KEPLER_LANES){
+            const int n = MIN(REB_WHFAST_KEPLER_LANES, N_real-i);
+            double M[REB_WHFAST_KEPLER_LANES];
+            for (int l=0;l<n;l++){
+                double eta = m0;
+                if (coordinates==REB_WHFAST_COORDINATES_WHDS){
+                    eta = m0+p_j[i+l].m;
+                }
+                M[l] = eta*G;
+            }
+            reb_whfast_kepler_solver_lanes(r, p_j, M, i, n, _dt);
+        }
+    }
+}
+
+void reb_whfast_kepler_step(const struct reb_simulation* const r, const double _dt){
+    reb_whfast_kepler_step_N(r, _dt, r->N-r->N_var);
+}
+
+void reb_whfast_interaction_kepler_step(struct reb_simulation* const r, const double dt_kick, const double dt_drift){
+    struct reb_particle* const p_j = r->ri_whfast.p_jh;
+    if (r->ri_whfast.coordinates!=REB_WHFAST_COORDINATES_JACOBI || r->var_config_N || r->ri_whfast.compensated){
+        reb_whfast_interaction_step(r, dt_kick);
+        reb_whfast_kepler_step(r, dt_drift);
+        return;
+    }
+    const int N_real = r->N-r->N_var;
+    const double G = r->G;
+    const double softening = r->softening;
+    const int jacobi_terms = r->gravity != REB_GRAVITY_JACOBI;
+    reb_transformations_inertial_to_jacobi_acc(r->particles, p_j, r->particles, N_real);
+    // Every group of particles is kicked and then drifted while it is in cache.
+    // Kicks only depend on the particle itself, so the order does not matter.
+    double eta = r->particles[0].m;
+    for (int i=1;i<N_real;i+=REB_WHFAST_KEPLER_LANES){
+        const int n = MIN(REB_WHFAST_KEPLER_LANES, N_real-i);
+        double M[REB_WHFAST_KEPLER_LANES];
+        for (int l=0;l<n;l++){
+            // Same as in reb_whfast_interaction_step (Eq 132)
+            const struct reb_particle pji = p_j[i+l];
+            eta += pji.m;
+            p_j[i+l].vx += dt_kick * pji.ax;
+            p_j[i+l].vy += dt_kick * pji.ay;
+            p_j[i+l].vz += dt_kick * pji.az;
+            if (jacobi_terms && i+l>1){
+                const double rj2i = 1./(pji.x*pji.x + pji.y*pji.y + pji.z*pji.z + softening*softening);
+                const double rji  = sqrt(rj2i);
+                const double rj3iM = rji*rj2i*G*eta;
+                const double prefac1 = dt_kick*rj3iM;
+                p_j[i+l].vx += prefac1*pji.x;
+                p_j[i+l].vy += prefac1*pji.y;
+                p_j[i+l].vz += prefac1*pji.z;
+            }
+            M[l] = eta*G;
+        }
+        reb_whfast_kepler_solver_lanes(r, p_j, M, i, n, dt_drift);
     }
 }
 
@@ -776,6 +1042,11 @@ int reb_integrator_whfast_init(struct reb_simulation* const r){
         ri_whfast->p_jh = realloc(ri_whfast->p_jh,sizeof(struct reb_particle)*N);
         ri_whfast->recalculate_coordinates_this_timestep = 1;
     }
+    if (ri_whfast->compensated && ri_whfast->allocated_N_cs != N){
+        ri_whfast->allocated_N_cs = N;
+        ri_whfast->p_jh_cs = realloc(ri_whfast->p_jh_cs,sizeof(double)*6*N);
+        memset(ri_whfast->p_jh_cs,0,sizeof(double)*6*N);
+    }
     return 0;
 }
 
@@ -786,6 +1057,10 @@ void reb_integrator_whfast_from_inertial(struct reb_simulation* const r){
     const int N_real = N-r->N_var;
     const int N_active = r->N_active==-1?r->N:r->N_active;
     
+    if (ri_whfast->p_jh_cs){
+        // New coordinates. Discard compensation terms.
+        memset(ri_whfast->p_jh_cs,0,sizeof(double)*6*ri_whfast->allocated_N_cs);
+    }
     switch (ri_whfast->coordinates){
         case REB_WHFAST_COORDINATES_JACOBI:
             reb_transformations_inertial_to_jacobi_posvel(particles, ri_whfast->p_jh, particles, N_real);
@@ -861,6 +1136,314 @@ void reb_integrator_whfast_debug_operator_interaction(struct reb_simulation* con
     reb_integrator_whfast_to_inertial(r);
 }
 
+/***************************** 
+ * Test particle fast path   */
+
+// With democratic heliocentric coordinates, safe_mode on and testparticle_type 0,
+// test particles do not influence the massive bodies nor each other. The massive bodies
+// are advanced first, then each test particle's drift, coordinate transformation and kick 
+// are applied in a single pass. The result is bit-wise identical to the general path.
+static int reb_whfast_testparticle_fast_path(const struct reb_simulation* const r){
+    const struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
+    const int N_real = r->N-r->N_var;
+    return ri_whfast->coordinates == REB_WHFAST_COORDINATES_DEMOCRATICHELIOCENTRIC
+        && ri_whfast->kernel == REB_WHFAST_KERNEL_DEFAULT
+        && ri_whfast->safe_mode == 1
+        && ri_whfast->keep_unsynchronized == 0
+        && ri_whfast->compensated == 0
+        && r->testparticle_type == 0
+        && r->N_active > 0
+        && r->N_active < N_real
+        && r->var_config_N == 0;
+}
+
+// Test particles on orbits with small pericenter distances can be sub-cycled in the fast path.
+// The massive bodies are advanced first. Their heliocentric positions during the timestep are 
+// then interpolated with a quartic polynomial which matches the positions and velocities at the 
+// beginning and the end of the timestep as well as the positions at the midpoint. A sub-cycled 
+// test particle uses the same DKD scheme with a smaller timestep. When sub-cycling is enabled,
+// test particles also receive the jump step so that their splitting matches that of the 
+// massive bodies.
+static int reb_whfast_substeps_enabled(const struct reb_simulation* const r){
+    return r->ri_whfast.substeps_max > 1
+        && r->gravity == REB_GRAVITY_BASIC
+        && r->additional_forces == NULL
+        && r->nghostx == 0 && r->nghosty == 0 && r->nghostz == 0;
+}
+
+// Returns the number of substeps for a test particle (at least 1, at most substeps_max).
+static unsigned int reb_whfast_substeps_N(const struct reb_simulation* const r, const struct reb_particle p, const struct reb_particle star){
+    const double GM = r->G*star.m;
+    const double dx = p.x - star.x;
+    const double dy = p.y - star.y;
+    const double dz = p.z - star.z;
+    const double dvx = p.vx - star.vx;
+    const double dvy = p.vy - star.vy;
+    const double dvz = p.vz - star.vz;
+    const double d = sqrt(dx*dx + dy*dy + dz*dz);
+    const double v2 = dvx*dvx + dvy*dvy + dvz*dvz;
+    const double rv = dx*dvx + dy*dvy + dz*dvz;
+    const double hx = dy*dvz - dz*dvy;
+    const double hy = dz*dvx - dx*dvz;
+    const double hz = dx*dvy - dy*dvx;
+    const double h2 = hx*hx + hy*hy + hz*hz;
+    const double ex = ((v2-GM/d)*dx - rv*dvx)/GM;
+    const double ey = ((v2-GM/d)*dy - rv*dvy)/GM;
+    const double ez = ((v2-GM/d)*dz - rv*dvz)/GM;
+    const double e = sqrt(ex*ex + ey*ey + ez*ez);
+    const double q = h2/(GM*(1.+e));
+    const double T_q = 2.*M_PI*sqrt(q*q*q/GM);
+    const double n = ceil(fabs(r->dt)/(r->ri_whfast.substeps_eta*T_q));
+    if (!(n>1.)){ // also catches nan
+        return 1;
+    }
+    if (n>r->ri_whfast.substeps_max){
+        return r->ri_whfast.substeps_max;
+    }
+    return (unsigned int)n;
+}
+
+// Stores the momentum of the massive bodies divided by the star's mass (used for the jump step of test particles).
+static void reb_whfast_substeps_momentum(const struct reb_simulation* const r, double* const P){
+    const struct reb_particle* const p_h = r->ri_whfast.p_jh;
+    double px=0, py=0, pz=0;
+    for(int i=1;i<r->N_active;i++){
+        const double m = r->particles[i].m;
+        px += m * p_h[i].vx;
+        py += m * p_h[i].vy;
+        pz += m * p_h[i].vz;
+    }
+    const double m0 = r->particles[0].m;
+    P[0] = px/m0;
+    P[1] = py/m0;
+    P[2] = pz/m0;
+}
+
+// Advances test particle k by one full timestep using n substeps.
+static void reb_whfast_substeps_step(const struct reb_simulation* const r, const int k, const unsigned int n){
+    struct reb_particle* const p_h = r->ri_whfast.p_jh;
+    const struct reb_particle* const particles = r->particles;
+    const double* const planets = r->ri_whfast.substeps_planets;
+    const double* const P1 = planets;   // Momentum before the massive bodies' kick
+    const double* const P2 = planets+3; // Momentum after the massive bodies' kick
+    const int N_active = r->N_active;
+    const double G = r->G;
+    const double M = particles[0].m*G;
+    const double softening2 = r->softening*r->softening;
+    const double h = r->dt/n;
+    reb_whfast_kepler_solver(r, p_h, M, k, h/2.);
+    for (unsigned int s=0;s<n;s++){
+        const double tau = (s+0.5)/n;
+        const double* const Pa = tau<=0.5 ? P1 : P2;
+        p_h[k].x += h/2.*Pa[0];
+        p_h[k].y += h/2.*Pa[1];
+        p_h[k].z += h/2.*Pa[2];
+        double ax = 0.;
+        double ay = 0.;
+        double az = 0.;
+        for (int j=1;j<N_active;j++){
+            const double* const pl = planets+15*j;
+            const double xj = pl[0] + tau*(pl[3] + tau*(pl[6]  + tau*(pl[9]  + tau*pl[12])));
+            const double yj = pl[1] + tau*(pl[4] + tau*(pl[7]  + tau*(pl[10] + tau*pl[13])));
+            const double zj = pl[2] + tau*(pl[5] + tau*(pl[8]  + tau*(pl[11] + tau*pl[14])));
+            const double dx = p_h[k].x - xj;
+            const double dy = p_h[k].y - yj;
+            const double dz = p_h[k].z - zj;
+            const double _r = sqrt(dx*dx + dy*dy + dz*dz + softening2);
+            const double prefact = -G/(_r*_r*_r)*particles[j].m;
+            ax += prefact*dx;
+            ay += prefact*dy;
+            az += prefact*dz;
+        }
+        p_h[k].vx += h*ax;
+        p_h[k].vy += h*ay;
+        p_h[k].vz += h*az;
+        const double* const Pb = tau<0.5 ? P1 : P2;
+        p_h[k].x += h/2.*Pb[0];
+        p_h[k].y += h/2.*Pb[1];
+        p_h[k].z += h/2.*Pb[2];
+        reb_whfast_kepler_solver(r, p_h, M, k, s<n-1 ? h : h/2.);
+    }
+}
+
+static void reb_whfast_testparticle_part1(struct reb_simulation* const r){
+    struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
+    struct reb_particle* restrict const particles = r->particles;
+    struct reb_particle* const p_h = ri_whfast->p_jh;
+    const int N_real = r->N-r->N_var;
+    const int N_active = r->N_active;
+    const double dt2 = r->dt/2.;
+    const struct reb_particle star = particles[0];   // Position at beginning of timestep
+    const int substeps_enabled = reb_whfast_substeps_enabled(r);
+    if (substeps_enabled){
+        if (ri_whfast->allocated_N_substeps < r->N){
+            ri_whfast->allocated_N_substeps = r->N;
+            ri_whfast->substeps = realloc(ri_whfast->substeps, sizeof(unsigned int)*r->N);
+            ri_whfast->substeps_planets = realloc(ri_whfast->substeps_planets, sizeof(double)*15*r->N);
+        }
+        // Heliocentric positions and velocities (times dt) at the beginning of the timestep
+        for (int j=1;j<N_active;j++){
+            double* const pl = ri_whfast->substeps_planets+15*j;
+            pl[0] = particles[j].x - star.x;
+            pl[1] = particles[j].y - star.y;
+            pl[2] = particles[j].z - star.z;
+            pl[3] = (particles[j].vx - star.vx)*r->dt;
+            pl[4] = (particles[j].vy - star.vy)*r->dt;
+            pl[5] = (particles[j].vz - star.vz)*r->dt;
+        }
+    }
+
+    // Massive bodies
+    reb_transformations_inertial_to_democraticheliocentric_posvel_testparticles(particles, p_h, N_active, N_active);
+    ri_whfast->recalculate_coordinates_this_timestep = 0;
+    reb_whfast_kepler_step_N(r, dt2, N_active);
+    reb_whfast_com_step(r, dt2);
+    if (substeps_enabled){
+        reb_whfast_substeps_momentum(r, ri_whfast->substeps_planets);
+    }
+    reb_whfast_jump_step(r, dt2);
+    reb_transformations_democraticheliocentric_to_inertial_posvel_testparticles(particles, p_h, N_active, N_active);
+    if (substeps_enabled){
+        // Heliocentric positions at the midpoint
+        for (int j=1;j<N_active;j++){
+            double* const pl = ri_whfast->substeps_planets+15*j;
+            pl[6] = particles[j].x - particles[0].x;
+            pl[7] = particles[j].y - particles[0].y;
+            pl[8] = particles[j].z - particles[0].z;
+        }
+    }
+
+    // Test particles
+    double M[REB_WHFAST_KEPLER_LANES];
+    for (int l=0;l<REB_WHFAST_KEPLER_LANES;l++){
+        M[l] = star.m*r->G;
+    }
+#pragma omp parallel for schedule(guided)
+    for (int i=N_active;i<N_real;i+=REB_WHFAST_KEPLER_LANES){
+        const int n = MIN(REB_WHFAST_KEPLER_LANES, N_real-i);
+        struct reb_particle p_start[REB_WHFAST_KEPLER_LANES];
+        for (int k=i;k<i+n;k++){
+            p_h[k].x  = particles[k].x  - star.x;
+            p_h[k].y  = particles[k].y  - star.y;
+            p_h[k].z  = particles[k].z  - star.z;
+            p_h[k].vx = particles[k].vx - p_h[0].vx;
+            p_h[k].vy = particles[k].vy - p_h[0].vy;
+            p_h[k].vz = particles[k].vz - p_h[0].vz;
+            p_h[k].m  = particles[k].m;
+            if (substeps_enabled){
+                ri_whfast->substeps[k] = reb_whfast_substeps_N(r, particles[k], star);
+                p_start[k-i] = p_h[k];
+            }
+        }
+        reb_whfast_kepler_solver_lanes(r, p_h, M, i, n, dt2);
+        for (int k=i;k<i+n;k++){
+            if (substeps_enabled && ri_whfast->substeps[k]>1){
+                // Sub-cycled particles are advanced in part2. 
+                p_h[k] = p_start[k-i];
+                continue;
+            }
+            if (substeps_enabled){
+                const double* const P1 = ri_whfast->substeps_planets;
+                p_h[k].x += dt2*P1[0];
+                p_h[k].y += dt2*P1[1];
+                p_h[k].z += dt2*P1[2];
+            }
+            particles[k].x  = p_h[k].x  + particles[0].x;
+            particles[k].y  = p_h[k].y  + particles[0].y;
+            particles[k].z  = p_h[k].z  + particles[0].z;
+            particles[k].vx = p_h[k].vx + p_h[0].vx;
+            particles[k].vy = p_h[k].vy + p_h[0].vy;
+            particles[k].vz = p_h[k].vz + p_h[0].vz;
+        }
+    }
+
+    r->t+=dt2;
+}
+
+static void reb_whfast_testparticle_part2(struct reb_simulation* const r){
+    struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
+    struct reb_particle* restrict const particles = r->particles;
+    struct reb_particle* const p_h = ri_whfast->p_jh;
+    const int N_real = r->N-r->N_var;
+    const int N_active = r->N_active;
+    const double dt = r->dt;
+    const double dt2 = r->dt/2.;
+
+    // Massive bodies
+    for (int i=1;i<N_active;i++){
+        p_h[i].vx += dt*particles[i].ax;
+        p_h[i].vy += dt*particles[i].ay;
+        p_h[i].vz += dt*particles[i].az;
+    }
+    const int substeps_enabled = reb_whfast_substeps_enabled(r);
+    if (substeps_enabled){
+        reb_whfast_substeps_momentum(r, ri_whfast->substeps_planets+3);
+    }
+    reb_whfast_jump_step(r, dt2);
+    reb_whfast_kepler_step_N(r, dt2, N_active);
+    reb_whfast_com_step(r, dt2);
+    reb_transformations_democraticheliocentric_to_inertial_posvel_testparticles(particles, p_h, N_active, N_active);
+    if (substeps_enabled){
+        // Coefficients of the interpolating polynomial x(tau) = x0 + v0*dt*tau + c2*tau^2 + c3*tau^3 + c4*tau^4 
+        for (int j=1;j<N_active;j++){
+            double* const pl = ri_whfast->substeps_planets+15*j;
+            const double x1[3] = {particles[j].x - particles[0].x, particles[j].y - particles[0].y, particles[j].z - particles[0].z};
+            const double v1[3] = {(particles[j].vx - particles[0].vx)*dt, (particles[j].vy - particles[0].vy)*dt, (particles[j].vz - particles[0].vz)*dt};
+            for (int d=0;d<3;d++){
+                const double A = pl[6+d] - pl[d] - 0.5*pl[3+d];
+                const double B = x1[d] - pl[d] - pl[3+d];
+                const double C = v1[d] - pl[3+d];
+                pl[6+d]  = 16.*A - 5.*B + C;
+                pl[9+d]  = -32.*A + 14.*B - 3.*C;
+                pl[12+d] = 16.*A - 8.*B + 2.*C;
+            }
+        }
+    }
+    
+    // Test particles
+    double M[REB_WHFAST_KEPLER_LANES];
+    for (int l=0;l<REB_WHFAST_KEPLER_LANES;l++){
+        M[l] = particles[0].m*r->G;
+    }
+#pragma omp parallel for schedule(guided)
+    for (int i=N_active;i<N_real;i+=REB_WHFAST_KEPLER_LANES){
+        const int n = MIN(REB_WHFAST_KEPLER_LANES, N_real-i);
+        struct reb_particle p_start[REB_WHFAST_KEPLER_LANES];
+        for (int k=i;k<i+n;k++){
+            if (substeps_enabled && ri_whfast->substeps[k]>1){
+                p_start[k-i] = p_h[k];
+                continue;
+            }
+            p_h[k].vx += dt*particles[k].ax;
+            p_h[k].vy += dt*particles[k].ay;
+            p_h[k].vz += dt*particles[k].az;
+            if (substeps_enabled){
+                const double* const P2 = ri_whfast->substeps_planets+3;
+                p_h[k].x += dt2*P2[0];
+                p_h[k].y += dt2*P2[1];
+                p_h[k].z += dt2*P2[2];
+            }
+        }
+        reb_whfast_kepler_solver_lanes(r, p_h, M, i, n, dt2);
+        for (int k=i;k<i+n;k++){
+            if (substeps_enabled && ri_whfast->substeps[k]>1){
+                p_h[k] = p_start[k-i];
+                reb_whfast_substeps_step(r, k, ri_whfast->substeps[k]);
+            }
+            particles[k].x  = p_h[k].x  + particles[0].x;
+            particles[k].y  = p_h[k].y  + particles[0].y;
+            particles[k].z  = p_h[k].z  + particles[0].z;
+            particles[k].vx = p_h[k].vx + p_h[0].vx;
+            particles[k].vy = p_h[k].vy + p_h[0].vy;
+            particles[k].vz = p_h[k].vz + p_h[0].vz;
+        }
+    }
+
+    ri_whfast->is_synchronized = 1;
+    r->t+=dt2;
+    r->dt_last_done = r->dt;
+}
+
 void reb_integrator_whfast_part1(struct reb_simulation* const r){
     struct reb_simulation_integrator_whfast* const ri_whfast = &(r->ri_whfast);
     struct reb_particle* restrict const particles = r->particles;
@@ -870,6 +1453,10 @@ void reb_integrator_whfast_part1(struct reb_simulation* const r){
         // Non recoverable error occured.
         return;
     }
+    if (ri_whfast->is_synchronized && reb_whfast_testparticle_fast_path(r)){
+        reb_whfast_testparticle_part1(r);
+        return;
+    }
     
     // Only recalculate Jacobi coordinates if needed
     if (ri_whfast->safe_mode || ri_whfast->recalculate_coordinates_this_timestep){
@@ -930,7 +1517,7 @@ void reb_integrator_whfast_part1(struct reb_simulation* const r){
         }
     }
 
-    r->t+=r->dt/2.;
+    reb_whfast_advance_time(r, r->dt/2.);
 }
 
 void reb_integrator_whfast_synchronize(struct reb_simulation* const r){
@@ -1003,6 +1590,10 @@ void reb_integrator_whfast_part2(struct reb_simulation* const r){
         // Skipping rest of integration to avoid segmentation fault.
         return;
     }
+    if (reb_whfast_testparticle_fast_path(r)){
+        reb_whfast_testparticle_part2(r);
+        return;
+    }
     
     switch (ri_whfast->kernel){
         case REB_WHFAST_KERNEL_DEFAULT: 
@@ -1097,7 +1688,7 @@ void reb_integrator_whfast_part2(struct reb_simulation* const r){
         reb_integrator_whfast_synchronize(r);
     }
     
-    r->t+=r->dt/2.;
+    reb_whfast_advance_time(r, r->dt/2.);
     r->dt_last_done = r->dt;
 
     
@@ -1184,8 +1775,15 @@ void reb_integrator_whfast_reset(struct reb_simulation* const r){
     ri_whfast->is_synchronized = 1;
     ri_whfast->keep_unsynchronized = 0;
     ri_whfast->safe_mode = 1;
+    ri_whfast->compensated = 0;
+    ri_whfast->substeps_max = 0;
+    ri_whfast->substeps_eta = 0.05;
+    ri_whfast->t_cs = 0.;
+    ri_whfast->t_last = 0.;
     ri_whfast->recalculate_coordinates_this_timestep = 0;
     ri_whfast->allocated_N = 0;
+    ri_whfast->allocated_N_cs = 0;
+    ri_whfast->allocated_N_substeps = 0;
     ri_whfast->allocated_Ntemp = 0;
     ri_whfast->timestep_warning = 0;
     ri_whfast->recalculate_coordinates_but_not_synchronized_warning = 0;
@@ -1197,4 +1795,16 @@ void reb_integrator_whfast_reset(struct reb_simulation* const r){
         free(ri_whfast->p_temp);
         ri_whfast->p_temp = NULL;
     }
+    if (ri_whfast->p_jh_cs){
+        free(ri_whfast->p_jh_cs);
+        ri_whfast->p_jh_cs = NULL;
+    }
+    if (ri_whfast->substeps){
+        free(ri_whfast->substeps);
+        ri_whfast->substeps = NULL;
+    }
+    if (ri_whfast->substeps_planets){
+        free(ri_whfast->substeps_planets);
+        ri_whfast->substeps_planets = NULL;
+    }
 }
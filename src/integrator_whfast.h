@@ -27,10 +27,14 @@
 
 #include "rebound.h"
 
+#define REB_WHFAST_KEPLER_LANES 8   ///< Number of orbits solved together by reb_whfast_kepler_solver_lanes()
+
 void reb_integrator_whfast_part1(struct reb_simulation* r);		///< Internal function used to call a specific integrator
 void reb_integrator_whfast_part2(struct reb_simulation* r);		///< Internal function used to call a specific integrator
 void reb_integrator_whfast_synchronize(struct reb_simulation* r);	///< Internal function used to call a specific integrator
 void reb_whfast_kepler_solver(const struct reb_simulation* const r, struct reb_particle* const restrict p_j, const double M, unsigned int i, double _dt);   ///< Internal function (Main WHFast Kepler Solver)
+void reb_whfast_kepler_solver_lanes(const struct reb_simulation* const r, struct reb_particle* const restrict p_j, const double* const restrict M, unsigned int i, unsigned int n, double _dt);   ///< Internal function (Kepler solver for particles i..i+n-1, n<=REB_WHFAST_KEPLER_LANES)
 void reb_whfast_calculate_jerk(struct reb_simulation* r);       ///< Calculates "jerk" term
+void reb_whfast_interaction_kepler_step(struct reb_simulation* const r, const double dt_kick, const double dt_drift);   ///< Internal function (Interaction step followed by a Kepler step in one pass, Jacobi coordinates only)
 
 #endif
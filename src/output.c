@@ -28,6 +28,7 @@
 #include <math.h>
 #include <time.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/time.h>
 #include "particle.h"
 #include "rebound.h"
@@ -176,6 +177,101 @@ void reb_output_timing(struct reb_simulation* r, const double tmax){
 }
 
 
+// Maximum length of a double formatted with %e, e.g. -1.234567e+308
+#define REB_OUTPUT_E_MAX 14
+
+/**
+ * @brief Formats a double exactly like printf("%e",v) does.
+ * @details Most numbers are formatted with a single multiplication by an exactly
+ * representable power of ten. If the result could round differently than 
+ * the exact decimal value (ties, very large or small exponents, inf, nan), 
+ * snprintf is used instead. The output is therefore always identical to printf.
+ * @return Number of characters written (at most REB_OUTPUT_E_MAX, no terminating zero).
+ */
+static int reb_output_format_e(char* buf, const double v){
+    static const double powers[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    char* p = buf;
+    const double a = fabs(v);
+    if (a==0.){
+        if (signbit(v)){
+            *p++ = '-';
+        }
+        memcpy(p, "0.000000e+00", 12);
+        return p-buf+12;
+    }
+    if (a>=1e-15 && a<1e28){
+        int E = (int)floor(log10(a));
+        for (int iter=0;iter<2;iter++){
+            // 7 significant digits: scaled is in [1e6,1e7) if E is correct
+            const int k = 6-E;
+            if (k<-22 || k>22) break;
+            const double scaled = k>=0 ? a*powers[k] : a/powers[-k]; // Only one rounding error (<1e-9)
+            if (scaled<999999.5){
+                E--;
+                continue;
+            }
+            if (scaled>=1e7){
+                E++;
+                continue;
+            }
+            double m = floor(scaled);
+            const double frac = scaled - m;
+            if (fabs(frac-0.5)<1e-7) break; // Too close to call
+            if (frac>0.5){
+                m += 1.;
+            }
+            if (m>=1e7){  // Rounded up to next power of ten
+                m = 1e6;
+                E++;
+            }
+            long digits = (long)m;
+            char d[7];
+            for (int i=6;i>=0;i--){
+                d[i] = '0' + digits%10;
+                digits /= 10;
+            }
+            if (v<0.){
+                *p++ = '-';
+            }
+            *p++ = d[0];
+            *p++ = '.';
+            memcpy(p, d+1, 6);
+            p += 6;
+            *p++ = 'e';
+            *p++ = E<0 ? '-' : '+';
+            const int Eabs = E<0 ? -E : E;
+            *p++ = '0' + Eabs/10;
+            *p++ = '0' + Eabs%10;
+            return p-buf;
+        }
+    }
+    char tmp[32];
+    const int length = snprintf(tmp, 32, "%e", v);
+    memcpy(buf, tmp, length);
+    return length;
+}
+
+// Formats N doubles separated by tabs and terminated by a newline. Returns the number of characters written.
+static int reb_output_format_row(char* buf, const double* values, const int N){
+    char* p = buf;
+    for (int i=0;i<N;i++){
+        p += reb_output_format_e(p, values[i]);
+        *p++ = i==N-1 ? '\n' : '\t';
+    }
+    return p-buf;
+}
+
+// Copies rows formatted into fixed size slots into a contiguous buffer. Returns the total length.
+static size_t reb_output_compact_rows(char* buf, const int* lengths, const int N, const size_t slot){
+    size_t size = 0;
+    for (int i=0;i<N;i++){
+        memmove(buf+size, buf+i*slot, lengths[i]);
+        size += lengths[i];
+    }
+    return size;
+}
+
 void reb_output_ascii(struct reb_simulation* r, char* filename){
     const int N = r->N;
 #ifdef MPI
@@ -189,10 +285,19 @@ void reb_output_ascii(struct reb_simulation* r, char* filename){
         reb_error(r, "Can not open file.");
         return;
     }
+    // Rows are formatted in parallel and then written with a single call.
+    const size_t slot = 6*(REB_OUTPUT_E_MAX+1);
+    char* buf = malloc(slot*N);
+    int* lengths = malloc(sizeof(int)*N);
+#pragma omp parallel for schedule(guided)
     for (int i=0;i<N;i++){
-        struct reb_particle p = r->particles[i];
-        fprintf(of,"%e\t%e\t%e\t%e\t%e\t%e\n",p.x,p.y,p.z,p.vx,p.vy,p.vz);
+        const struct reb_particle p = r->particles[i];
+        const double values[6] = {p.x, p.y, p.z, p.vx, p.vy, p.vz};
+        lengths[i] = reb_output_format_row(buf+i*slot, values, 6);
     }
+    fwrite(buf, reb_output_compact_rows(buf, lengths, N, slot), 1, of);
+    free(lengths);
+    free(buf);
     fclose(of);
 }
 
@@ -209,50 +314,177 @@ void reb_output_orbits(struct reb_simulation* r, char* filename){
         reb_error(r, "Can not open file.");
         return;
     }
-    struct reb_particle com = r->particles[0];
+    if (N<2){
+        fclose(of);
+        return;
+    }
+    // Jacobi primaries: com[i] is the center of mass of particles 0..i-1
+    struct reb_particle* com = malloc(sizeof(struct reb_particle)*N);
+    com[1] = r->particles[0];
+    for (int i=2;i<N;i++){
+        com[i] = reb_get_com_of_pair(com[i-1],r->particles[i-1]);
+    }
+    // Orbits are calculated and formatted in parallel and then written with a single call.
+    const size_t slot = 9*(REB_OUTPUT_E_MAX+1);
+    char* buf = malloc(slot*(N-1));
+    int* lengths = malloc(sizeof(int)*(N-1));
+#pragma omp parallel for schedule(guided)
     for (int i=1;i<N;i++){
-        struct reb_orbit o = reb_tools_particle_to_orbit(r->G, r->particles[i],com);
-        fprintf(of,"%e\t%e\t%e\t%e\t%e\t%e\t%e\t%e\t%e\n",r->t,o.a,o.e,o.inc,o.Omega,o.omega,o.l,o.P,o.f);
-        com = reb_get_com_of_pair(com,r->particles[i]);
+        struct reb_orbit o = reb_tools_particle_to_orbit(r->G, r->particles[i],com[i]);
+        const double values[9] = {r->t,o.a,o.e,o.inc,o.Omega,o.omega,o.l,o.P,o.f};
+        lengths[i-1] = reb_output_format_row(buf+(i-1)*slot, values, 9);
     }
+    fwrite(buf, reb_output_compact_rows(buf, lengths, N-1, slot), 1, of);
+    free(lengths);
+    free(buf);
+    free(com);
     fclose(of);
 }
 
-void static inline reb_save_dp7(struct reb_dp7* dp7, const int N3, char** bufp, size_t* sizep, size_t* allocatedsize){
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p0,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p1,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p2,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p3,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p4,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p5,sizeof(double)*N3);
-    reb_output_stream_write(bufp, allocatedsize, sizep, dp7->p6,sizeof(double)*N3);
+// One field of the reference binary.
+struct reb_output_stream_ref {
+    uint32_t type;
+    size_t pos;
+    size_t size;
+    int seen;
+};
+
+// Destination of a binary. Either a buffer that grows as needed, or a file to which
+// only the fields that differ from a reference binary are written (diff mode).
+struct reb_output_stream {
+    char* buf;
+    size_t allocatedsize;
+    size_t size;                    // Size of the complete binary, also in diff mode
+    FILE* of;                       // Only set in diff mode
+    const char* ref;                // Reference binary
+    struct reb_output_stream_ref* fields;
+    long N;                         // Number of fields in the reference binary
+    long next;                      // Index of the reference field expected next
+    int skip;                       // Set to 1 for the header, END and the blob in diff mode
+    struct reb_binary_field field;  // Current field
+    const char* field_ref;          // Data of the current field in ref if it is equal so far, NULL otherwise
+    size_t field_pos;               // Number of bytes of the current field compared so far
+    size_t size_written;            // Number of bytes written to the file
+    char* out;                      // Collects small writes to the file
+    size_t out_capacity;
+    size_t out_size;
+};
+
+// Returns the index of the first field with the given type in the reference binary, -1 if there is none.
+static long reb_output_stream_find(struct reb_output_stream* s, uint32_t type){
+    if (s->next<s->N && s->fields[s->next].type==type){
+        return s->next;
+    }
+    for (long j=0;j<s->N;j++){
+        if (s->fields[j].type==type){
+            return j;
+        }
+    }
+    return -1;
+}
+
+static void reb_output_stream_flush(struct reb_output_stream* s){
+    fwrite(s->out, s->out_size, 1, s->of);
+    s->out_size = 0;
+}
+
+// Writes to the file in diff mode. Many writes are small (single particles).
+static void reb_output_stream_out(struct reb_output_stream* s, const void* data, size_t size){
+    if (s->out_size+size>s->out_capacity){
+        reb_output_stream_flush(s);
+    }
+    if (size>=s->out_capacity){
+        fwrite(data, size, 1, s->of);
+    }else{
+        memcpy(s->out+s->out_size, data, size);
+        s->out_size += size;
+    }
+    s->size_written += size;
+}
+
+static void reb_output_stream_field(struct reb_output_stream* s, uint32_t type, size_t size){
+    // Memset forces padding to be set to 0 (not necessary but
+    // helps when comparing binary files)
+    struct reb_binary_field field;
+    memset(&field,0,sizeof(struct reb_binary_field));
+    field.type = type;
+    field.size = size;
+    if (s->of==NULL){
+        reb_output_stream_write(&s->buf, &s->allocatedsize, &s->size, &field, sizeof(struct reb_binary_field));
+        return;
+    }
+    s->size += sizeof(struct reb_binary_field);
+    s->field = field;
+    s->field_ref = NULL;
+    s->field_pos = 0;
+    s->skip = type==REB_BINARY_FIELD_TYPE_END;
+    if (s->skip){
+        return;
+    }
+    const long j = reb_output_stream_find(s, type);
+    if (j>=0){
+        s->fields[j].seen = 1;
+        s->next = j+1;
+        if (s->fields[j].size==size){
+            // Only written once it differs from the reference
+            s->field_ref = s->ref+s->fields[j].pos;
+            return;
+        }
+    }
+    reb_output_stream_out(s, &field, sizeof(struct reb_binary_field));
+}
+
+static void reb_output_stream_data(struct reb_output_stream* s, const void* data, size_t size){
+    if (s->of==NULL){
+        reb_output_stream_write(&s->buf, &s->allocatedsize, &s->size, (void*)data, size);
+        return;
+    }
+    s->size += size;
+    if (s->skip){
+        return;
+    }
+    if (s->field_ref){
+        if (memcmp(s->field_ref+s->field_pos, data, size)==0){
+            s->field_pos += size;
+            return;
+        }
+        // First difference. The part compared so far is the same as in the reference.
+        reb_output_stream_out(s, &s->field, sizeof(struct reb_binary_field));
+        reb_output_stream_out(s, s->field_ref, s->field_pos);
+        s->field_ref = NULL;
+    }
+    reb_output_stream_out(s, data, size);
+}
+
+void static inline reb_save_dp7(struct reb_dp7* dp7, const int N3, struct reb_output_stream* s){
+    reb_output_stream_data(s, dp7->p0,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p1,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p2,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p3,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p4,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p5,sizeof(double)*N3);
+    reb_output_stream_data(s, dp7->p6,sizeof(double)*N3);
 }
 
 // Macro to write a single field to a binary file.
-// Memset forces padding to be set to 0 (not necessary but
-// helps when comparing binary files)
 #define WRITE_FIELD(typename, value, length) {\
-        struct reb_binary_field field;\
-        memset(&field,0,sizeof(struct reb_binary_field));\
-        field.type = REB_BINARY_FIELD_TYPE_##typename;\
-        field.size = (length);\
-        reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));\
-        reb_output_stream_write(bufp, &allocatedsize, sizep, value,field.size);\
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_##typename, (length));\
+        reb_output_stream_data(s, value, (length));\
     }
 
 
 void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t* sizep){
-    size_t allocatedsize = 0;
-    *bufp = NULL;
-    *sizep = 0;
     // Init integrators. This helps with bit-by-bit reproducibility.
     reb_integrator_init(r);
+    reb_output_binary_to_stream_without_init(r, bufp, sizep);
+}
 
+static void reb_output_binary_to_output_stream(struct reb_simulation* r, struct reb_output_stream* s){
     // Output header.
     char header[64] = "\0";
     int cwritten = sprintf(header,"REBOUND Binary File. Version: %s",reb_version_str);
     snprintf(header+cwritten+1,64-cwritten-1,"%s",reb_githash_str);
-    reb_output_stream_write(bufp, &allocatedsize, sizep, header,sizeof(char)*64);
+    reb_output_stream_data(s, header,sizeof(char)*64);
    
     WRITE_FIELD(T,                  &r->t,                              sizeof(double));
     WRITE_FIELD(G,                  &r->G,                              sizeof(double));
@@ -266,6 +498,7 @@ void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t*
     WRITE_FIELD(TESTPARTICLETYPE,   &r->testparticle_type,              sizeof(int));
     WRITE_FIELD(HASHCTR,            &r->hash_ctr,                       sizeof(int));
     WRITE_FIELD(OPENINGANGLE2,      &r->opening_angle2,                 sizeof(double));
+    WRITE_FIELD(GRAVITYMIXEDPRECISION, &r->gravity_mixed_precision,     sizeof(unsigned int));
     WRITE_FIELD(STATUS,             &r->status,                         sizeof(int));
     WRITE_FIELD(EXACTFINISHTIME,    &r->exact_finish_time,              sizeof(int));
     WRITE_FIELD(FORCEISVELOCITYDEP, &r->force_is_velocity_dependent,    sizeof(unsigned int));
@@ -300,6 +533,11 @@ void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t*
     WRITE_FIELD(MEGNOMEANT,         &r->megno_mean_t,                   sizeof(double));
     WRITE_FIELD(MEGNOMEANY,         &r->megno_mean_Y,                   sizeof(double));
     WRITE_FIELD(MEGNON,             &r->megno_n,                        sizeof(long));
+    WRITE_FIELD(LYAPUNOVSPECTRUMN,  &r->lyapunov_spectrum_N,            sizeof(int));
+    WRITE_FIELD(LYAPUNOVSPECTRUMVARCONFIG, &r->lyapunov_spectrum_var_config, sizeof(int));
+    WRITE_FIELD(LYAPUNOVSPECTRUMINTERVAL, &r->lyapunov_spectrum_interval, sizeof(double));
+    WRITE_FIELD(LYAPUNOVSPECTRUMT0, &r->lyapunov_spectrum_t0,           sizeof(double));
+    WRITE_FIELD(LYAPUNOVSPECTRUMTLAST, &r->lyapunov_spectrum_t_last,    sizeof(double));
     WRITE_FIELD(SAVERSION,          &r->simulationarchive_version,      sizeof(int));
     WRITE_FIELD(SASIZESNAPSHOT,     &r->simulationarchive_size_snapshot,sizeof(long));
     WRITE_FIELD(SAAUTOINTERVAL,     &r->simulationarchive_auto_interval, sizeof(double));
@@ -349,17 +587,27 @@ void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t*
     WRITE_FIELD(STEPSDONE,          &r->steps_done,                     sizeof(unsigned long long));
     WRITE_FIELD(SAAUTOSTEP,         &r->simulationarchive_auto_step,    sizeof(unsigned long long));
     WRITE_FIELD(SANEXTSTEP,         &r->simulationarchive_next_step,    sizeof(unsigned long long));
+    WRITE_FIELD(SAINDEX,            &r->simulationarchive_index,        sizeof(int));
+    WRITE_FIELD(SAASYNC,            &r->simulationarchive_async,        sizeof(int));
+    WRITE_FIELD(SACOMPRESS,         &r->simulationarchive_compress,     sizeof(int));
     WRITE_FIELD(SABA_TYPE,          &r->ri_saba.type,                   sizeof(unsigned int));
     WRITE_FIELD(SABA_SAFEMODE,      &r->ri_saba.safe_mode,              sizeof(unsigned int));
     WRITE_FIELD(SABA_ISSYNCHRON,    &r->ri_saba.is_synchronized,        sizeof(unsigned int));
     WRITE_FIELD(SABA_KEEPUNSYNC,    &r->ri_saba.keep_unsynchronized,    sizeof(unsigned int));
     WRITE_FIELD(WHFAST_CORRECTOR2,  &r->ri_whfast.corrector2,           sizeof(unsigned int));
     WRITE_FIELD(WHFAST_KERNEL,      &r->ri_whfast.kernel,               sizeof(unsigned int));
+    WRITE_FIELD(WHFAST_COMPENSATED, &r->ri_whfast.compensated,          sizeof(unsigned int));
+    WRITE_FIELD(WHFAST_SUBSTEPSMAX, &r->ri_whfast.substeps_max,         sizeof(unsigned int));
+    WRITE_FIELD(WHFAST_SUBSTEPSETA, &r->ri_whfast.substeps_eta,         sizeof(double));
     WRITE_FIELD(EOS_PHI0,           &r->ri_eos.phi0,                    sizeof(unsigned int));
     WRITE_FIELD(EOS_PHI1,           &r->ri_eos.phi1,                    sizeof(unsigned int));
     WRITE_FIELD(EOS_N,              &r->ri_eos.n,                       sizeof(unsigned int));
     WRITE_FIELD(EOS_SAFEMODE,       &r->ri_eos.safe_mode,               sizeof(unsigned int));
     WRITE_FIELD(EOS_ISSYNCHRON,     &r->ri_eos.is_synchronized,         sizeof(unsigned int));
+    WRITE_FIELD(IAS15_BLOCKLEVELS,  &r->ri_ias15.block_levels,          sizeof(unsigned int));
+    WRITE_FIELD(IAS15_PCTOLERANCE,  &r->ri_ias15.pc_tolerance,          sizeof(double));
+    WRITE_FIELD(IAS15_PCTOLERANCEEPSILON, &r->ri_ias15.pc_tolerance_epsilon, sizeof(double));
+    WRITE_FIELD(IAS15_PCITERATIONSMAX, &r->ri_ias15.pc_iterations_max,  sizeof(unsigned int));
     int functionpointersused = 0;
     if (r->coefficient_of_restitution ||
         r->collision_resolve ||
@@ -371,23 +619,27 @@ void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t*
     }
     WRITE_FIELD(FUNCTIONPOINTERS,   &functionpointersused,              sizeof(int));
     {
-        struct reb_binary_field field;
-        memset(&field,0,sizeof(struct reb_binary_field));
-        field.type = REB_BINARY_FIELD_TYPE_PARTICLES;
-        field.size = sizeof(struct reb_particle)*r->N;
-        reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_PARTICLES, sizeof(struct reb_particle)*r->N);
         // output one particle at a time to sanitize pointers.
         for (int l=0;l<r->N;l++){
             struct reb_particle op = r->particles[l];
             op.c = NULL;
             op.ap = NULL;
             op.sim = NULL;
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &op,sizeof(struct reb_particle));
+            reb_output_stream_data(s, &op,sizeof(struct reb_particle));
         }
     } 
     if (r->var_config){
         WRITE_FIELD(VARCONFIG,      r->var_config,                      sizeof(struct reb_variational_configuration)*r->var_config_N);
     }
+    if (r->lyapunov_spectrum_sums){
+        WRITE_FIELD(LYAPUNOVSPECTRUMSUMS, r->lyapunov_spectrum_sums,    sizeof(double)*r->lyapunov_spectrum_N);
+    }
+    if (r->ri_whfast.p_jh_cs){
+        WRITE_FIELD(WHFAST_PJCS,    r->ri_whfast.p_jh_cs,               sizeof(double)*6*r->ri_whfast.allocated_N_cs);
+        WRITE_FIELD(WHFAST_TCS,     &r->ri_whfast.t_cs,                 sizeof(double));
+        WRITE_FIELD(WHFAST_TLAST,   &r->ri_whfast.t_last,               sizeof(double));
+    }
     if (r->ri_ias15.allocatedN){
         int N3 = r->ri_ias15.allocatedN;
         WRITE_FIELD(IAS15_AT,   r->ri_ias15.at,     sizeof(double)*N3);
@@ -397,44 +649,70 @@ void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t*
         WRITE_FIELD(IAS15_CSX,  r->ri_ias15.csx,    sizeof(double)*N3);
         WRITE_FIELD(IAS15_CSV,  r->ri_ias15.csv,    sizeof(double)*N3);
         WRITE_FIELD(IAS15_CSA0, r->ri_ias15.csa0,   sizeof(double)*N3);
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_G, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.g),N3,bufp,sizep,&allocatedsize);
-        }
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_B, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.b),N3,bufp,sizep,&allocatedsize);
-        }
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_CSB, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.csb),N3,bufp,sizep,&allocatedsize);
-        }
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_E, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.e),N3,bufp,sizep,&allocatedsize);
-        }
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_BR, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.br),N3,bufp,sizep,&allocatedsize);
-        }
-        {
-            struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_IAS15_ER, .size = sizeof(double)*N3*7};
-            reb_output_stream_write(bufp, &allocatedsize, sizep, &field,sizeof(struct reb_binary_field));
-            reb_save_dp7(&(r->ri_ias15.er),N3,bufp,sizep,&allocatedsize);
-        }
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_G, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.g),N3,s);
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_B, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.b),N3,s);
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_CSB, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.csb),N3,s);
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_E, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.e),N3,s);
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_BR, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.br),N3,s);
+        reb_output_stream_field(s, REB_BINARY_FIELD_TYPE_IAS15_ER, sizeof(double)*N3*7);
+        reb_save_dp7(&(r->ri_ias15.er),N3,s);
     }
     // To output size of binary file, need to calculate it first. 
-    r->simulationarchive_size_first = (*sizep)+sizeof(struct reb_binary_field)*2+sizeof(long)+sizeof(struct reb_simulationarchive_blob);
+    r->simulationarchive_size_first = s->size+sizeof(struct reb_binary_field)*2+sizeof(long)+sizeof(struct reb_simulationarchive_blob);
     WRITE_FIELD(SASIZEFIRST,        &r->simulationarchive_size_first,   sizeof(long));
     int end_null = 0;
     WRITE_FIELD(END, &end_null, 0);
     struct reb_simulationarchive_blob blob = {0};
-    reb_output_stream_write(bufp, &allocatedsize, sizep, &blob, sizeof(struct reb_simulationarchive_blob));
+    reb_output_stream_data(s, &blob, sizeof(struct reb_simulationarchive_blob));
+}
+
+void reb_output_binary_to_stream_without_init(struct reb_simulation* r, char** bufp, size_t* sizep){
+    struct reb_output_stream s = {0};
+    reb_output_binary_to_output_stream(r, &s);
+    *bufp = s.buf;
+    *sizep = s.size;
+}
+
+size_t reb_output_binary_diff_to_file(struct reb_simulation* r, const char* buf_ref, size_t size_ref, FILE* of, char* buf, size_t capacity){
+    struct reb_output_stream s = {.of = of, .ref = buf_ref, .skip = 1, .out = buf, .out_capacity = capacity};
+    // Index the fields of the reference binary
+    long allocatedN = 0;
+    size_t pos = 64;
+    while(pos+sizeof(struct reb_binary_field)<=size_ref){
+        struct reb_binary_field field;
+        memcpy(&field, buf_ref+pos, sizeof(struct reb_binary_field));
+        pos += sizeof(struct reb_binary_field);
+        if (field.type==REB_BINARY_FIELD_TYPE_END || field.size>size_ref-pos){
+            break;
+        }
+        if (s.N==allocatedN){
+            allocatedN = allocatedN ? allocatedN*2 : 128;
+            s.fields = realloc(s.fields, sizeof(struct reb_output_stream_ref)*allocatedN);
+        }
+        s.fields[s.N] = (struct reb_output_stream_ref){.type = field.type, .pos = pos, .size = field.size, .seen = 0};
+        s.N++;
+        pos += field.size;
+    }
+
+    reb_output_binary_to_output_stream(r, &s);
+
+    // Fields which are no longer present are written with size 0
+    for (long j=0;j<s.N;j++){
+        if (!s.fields[j].seen){
+            struct reb_binary_field field;
+            memset(&field,0,sizeof(struct reb_binary_field));
+            field.type = s.fields[j].type;
+            reb_output_stream_out(&s, &field, sizeof(struct reb_binary_field));
+        }
+    }
+    reb_output_stream_flush(&s);
+    free(s.fields);
+    return s.size_written;
 }
 
 void reb_output_binary(struct reb_simulation* r, const char* filename){
@@ -457,6 +735,25 @@ void reb_output_binary(struct reb_simulation* r, const char* filename){
     fclose(of);
 }
 
+int reb_output_binary_to_fd(struct reb_simulation* r, int fd){
+    char* bufp;
+    size_t sizep;
+    reb_output_binary_to_stream(r, &bufp,&sizep);
+    // Pipes and sockets may accept fewer bytes than requested.
+    size_t written = 0;
+    while (written<sizep){
+        const ssize_t n = write(fd, bufp+written, sizep-written);
+        if (n<0){
+            if (errno==EINTR) continue;
+            free(bufp);
+            return -1;
+        }
+        written += n;
+    }
+    free(bufp);
+    return 0;
+}
+
 void reb_output_binary_positions(struct reb_simulation* r, const char* filename){
     const int N = r->N;
 #ifdef MPI
@@ -28,6 +28,8 @@ struct reb_simulation;
 
 #include <stdio.h>
 void reb_output_binary_to_stream(struct reb_simulation* r, char** bufp, size_t* sizep);
+void reb_output_binary_to_stream_without_init(struct reb_simulation* r, char** bufp, size_t* sizep); ///< Same without calling reb_integrator_init(). Does not modify r.
+size_t reb_output_binary_diff_to_file(struct reb_simulation* r, const char* buf_ref, size_t size_ref, FILE* of, char* buf, size_t capacity); ///< Writes only the fields that differ from the binary buf_ref (without END) to of, collecting small writes in buf. Returns the number of bytes written.
 void reb_output_stream_write(char** bufp, size_t* allocatedsize, size_t* sizep, void* restrict data, size_t size); ///< Replacement for memstream
 
 #ifdef PROFILING
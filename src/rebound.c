@@ -46,10 +46,12 @@
 #include "tree.h"
 #include "output.h"
 #include "tools.h"
+#include "transformations.h"
 #include "particle.h"
 #include "input.h"
 #include "binarydiff.h"
 #include "simulationarchive.h"
+#include "trajectory.h"
 #ifdef MPI
 #include "communication_mpi.h"
 #endif
@@ -81,6 +83,7 @@ void reb_step(struct reb_simulation* const r){
         r->pre_timestep_modifications(r);
         r->ri_whfast.recalculate_coordinates_this_timestep = 1;
         r->ri_mercurius.recalculate_coordinates_this_timestep = 1;
+        r->ri_sei.boundary_wrapped = 0;
     }
    
     reb_integrator_part1(r);
@@ -120,10 +123,7 @@ void reb_step(struct reb_simulation* const r){
     }
 
     // Calculate accelerations. 
-    reb_calculate_acceleration(r);
-    if (r->N_var){
-        reb_calculate_acceleration_var(r);
-    }
+    reb_calculate_acceleration_and_var(r);
     // Calculate non-gravity accelerations. 
     if (r->additional_forces) r->additional_forces(r);
     PROFILING_STOP(PROFILING_CAT_GRAVITY)
@@ -137,6 +137,14 @@ void reb_step(struct reb_simulation* const r){
         r->post_timestep_modifications(r);
         r->ri_whfast.recalculate_coordinates_this_timestep = 1;
         r->ri_mercurius.recalculate_coordinates_this_timestep = 1;
+        r->ri_sei.boundary_wrapped = 0;
+    }
+    if (r->lyapunov_spectrum_N && r->t!=r->lyapunov_spectrum_t_last && fabs(r->t-r->lyapunov_spectrum_t_last) >= r->lyapunov_spectrum_interval){
+        reb_integrator_synchronize(r);
+        reb_tools_lyapunov_spectrum_orthonormalize(r);
+        r->ri_whfast.recalculate_coordinates_this_timestep = 1;
+        r->ri_mercurius.recalculate_coordinates_this_timestep = 1;
+        r->ri_sei.boundary_wrapped = 0;
     }
     PROFILING_STOP(PROFILING_CAT_INTEGRATOR)
 
@@ -294,6 +302,8 @@ void reb_free_simulation(struct reb_simulation* const r){
 
 void reb_free_pointers(struct reb_simulation* const r){
     free(r->simulationarchive_filename);
+    reb_simulationarchive_free_writer(r);
+    reb_trajectory_free_writer(r);
     reb_tree_delete(r);
     if(r->display_data){
         pthread_mutex_destroy(&(r->display_data->mutex));
@@ -305,7 +315,9 @@ void reb_free_pointers(struct reb_simulation* const r){
         free(r->display_data); // TODO: Free other pointers in display_data
     }
     free(r->gravity_cs  );
+    free(r->gravity_mixed_sources);
     free(r->collisions  );
+    free(r->lyapunov_spectrum_sums);
     reb_integrator_whfast_reset(r);
     reb_integrator_ias15_reset(r);
     reb_integrator_mercurius_reset(r);
@@ -331,6 +343,10 @@ void reb_reset_temporary_pointers(struct reb_simulation* const r){
     // Note: this will not clear the particle array.
     r->gravity_cs_allocatedN    = 0;
     r->gravity_cs           = NULL;
+    r->gravity_mixed_sources_allocatedN = 0;
+    r->gravity_mixed_sources = NULL;
+    r->simulationarchive_writer = NULL;
+    r->trajectory_writer    = NULL;
     r->collisions_allocatedN    = 0;
     r->collisions           = NULL;
     r->extras               = NULL;
@@ -344,6 +360,11 @@ void reb_reset_temporary_pointers(struct reb_simulation* const r){
     r->ri_whfast.allocated_Ntemp= 0;
     r->ri_whfast.p_jh           = NULL;
     r->ri_whfast.p_temp         = NULL;
+    r->ri_whfast.allocated_N_cs = 0;
+    r->ri_whfast.p_jh_cs        = NULL;
+    r->ri_whfast.allocated_N_substeps = 0;
+    r->ri_whfast.substeps       = NULL;
+    r->ri_whfast.substeps_planets = NULL;
     r->ri_whfast.keep_unsynchronized = 0;
     // ********** IAS15
     r->ri_ias15.allocatedN      = 0;
@@ -363,6 +384,9 @@ void reb_reset_temporary_pointers(struct reb_simulation* const r){
     r->ri_ias15.at          = NULL;
     r->ri_ias15.map_allocated_N      = 0;
     r->ri_ias15.map         = NULL;
+    r->ri_ias15.block       = NULL;
+    r->ri_ias15.activeN     = 0;
+    r->ri_ias15.active_map  = NULL;
     // ********** MERCURIUS
     r->ri_mercurius.allocatedN = 0;
     r->ri_mercurius.allocatedN_additionalforces = 0;
@@ -413,9 +437,11 @@ struct reb_simulation* reb_create_simulation(){
 
 
 void _reb_copy_simulation_with_messages(struct reb_simulation* r_copy,  struct reb_simulation* r, enum reb_input_binary_messages* warnings){
+    // The copy goes through the binary format. The source is not modified,
+    // the integrators are initialized on the copy instead.
     char* bufp;
     size_t sizep;
-    reb_output_binary_to_stream(r, &bufp,&sizep);
+    reb_output_binary_to_stream_without_init(r, &bufp,&sizep);
     
     reb_reset_temporary_pointers(r_copy);
     reb_reset_function_pointers(r_copy);
@@ -428,6 +454,8 @@ void _reb_copy_simulation_with_messages(struct reb_simulation* r_copy,  struct r
     while(reb_input_field(r_copy, NULL, warnings, &bufp)){ }
     free(bufp_beginning);
     
+    // Same state as if the source had been initialized before writing the binary.
+    reb_integrator_init(r_copy);
 }
 
 int reb_diff_simulations(struct reb_simulation* r1, struct reb_simulation* r2, int output_option){
@@ -500,6 +528,12 @@ void reb_init_simulation(struct reb_simulation* r){
     r->force_is_velocity_dependent = 0;
     r->gravity_ignore_terms    = 0;
     r->calculate_megno  = 0;
+    r->lyapunov_spectrum_N  = 0;
+    r->lyapunov_spectrum_var_config = 0;
+    r->lyapunov_spectrum_interval = 0.;
+    r->lyapunov_spectrum_t0 = 0.;
+    r->lyapunov_spectrum_t_last = 0.;
+    r->lyapunov_spectrum_sums = NULL;
     r->output_timing_last   = -1;
     r->save_messages = 0;
     r->track_energy_offset = 0;
@@ -520,6 +554,9 @@ void reb_init_simulation(struct reb_simulation* r){
     r->simulationarchive_next          = 0.;    
     r->simulationarchive_next_step     = 0;    
     r->simulationarchive_filename      = NULL;    
+    r->simulationarchive_index         = 0;    
+    r->simulationarchive_async         = 0;    
+    r->simulationarchive_compress      = 0;    
     
     // Default modules
 #ifdef OPENGL
@@ -542,6 +579,11 @@ void reb_init_simulation(struct reb_simulation* r){
     r->ri_whfast.kernel = 0;
     r->ri_whfast.coordinates = REB_WHFAST_COORDINATES_JACOBI;
     r->ri_whfast.safe_mode = 1;
+    r->ri_whfast.compensated = 0;
+    r->ri_whfast.substeps_max = 0;
+    r->ri_whfast.substeps_eta = 0.05;
+    r->ri_whfast.t_cs = 0;
+    r->ri_whfast.t_last = 0;
     r->ri_whfast.recalculate_coordinates_this_timestep = 0;
     r->ri_whfast.is_synchronized = 1;
     r->ri_whfast.timestep_warning = 0;
@@ -557,11 +599,17 @@ void reb_init_simulation(struct reb_simulation* r){
     r->ri_ias15.min_dt      = 0;
     r->ri_ias15.epsilon_global  = 1;
     r->ri_ias15.iterations_max_exceeded = 0;    
+    r->ri_ias15.block_levels    = 0;
+    r->ri_ias15.pc_tolerance    = 1e-16;
+    r->ri_ias15.pc_tolerance_epsilon = 0;
+    r->ri_ias15.pc_iterations_max = 12;
+    memset(r->ri_ias15.iterations_histogram, 0, sizeof(r->ri_ias15.iterations_histogram));
     
     // ********** SEI
     r->ri_sei.OMEGA     = 1;
     r->ri_sei.OMEGAZ    = -1;
     r->ri_sei.lastdt    = 0;
+    r->ri_sei.boundary_wrapped = 0;
     
     // ********** MERCURIUS
     r->ri_mercurius.mode = 0;
@@ -583,6 +631,7 @@ void reb_init_simulation(struct reb_simulation* r){
     r->tree_needs_update= 0;
     r->tree_root        = NULL;
     r->opening_angle2   = 0.25;
+    r->gravity_mixed_precision = 0;
 
 #ifdef MPI
     r->mpi_id = 0;                            
@@ -823,6 +872,7 @@ enum REB_STATUS reb_integrate(struct reb_simulation* const r, double tmax){
             }
             break;
     }
+    reb_simulationarchive_flush(r);
     return r->status;
 }
 
@@ -831,6 +881,10 @@ enum REB_STATUS reb_integrate(struct reb_simulation* const r, double tmax){
 void reb_omp_set_num_threads(int num_threads){
     omp_set_num_threads(num_threads);
 }
+
+void reb_omp_set_deterministic(int deterministic){
+    reb_omp_deterministic = deterministic;
+}
 #endif // OPENMP
 
 const char* reb_logo[26] = {
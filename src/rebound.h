@@ -51,6 +51,7 @@ extern "C" {
 #include <inttypes.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/types.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
@@ -74,7 +75,9 @@ extern volatile sig_atomic_t reb_sigint;  ///< Graceful global interrupt handler
 // Forward declarations
 struct reb_simulation;
 struct reb_display_data;
+struct reb_simulationarchive_writer;
 struct reb_treecell;
+struct reb_ias15_block;
 
 /**
  * @brief Structure representing one REBOUND particle.
@@ -167,6 +170,50 @@ struct reb_simulation_integrator_ias15 {
      **/
     unsigned int epsilon_global;
 
+    /**
+     * @brief Number of timestep levels used for individual (block) timesteps.
+     * @details If set to a value larger than 1, each particle is advanced with its own 
+     * timestep dt/2^l, where 0 <= l < block_levels. The level of each particle is chosen with the same 
+     * error estimate that is otherwise used for the global timestep. Forces are only 
+     * calculated for the particles on the levels being advanced. The timestep dt is then the 
+     * timestep of the slowest particles. Coarser particles are interpolated with their
+     * predictor polynomial when finer particles need them, so the energy error is typically
+     * larger than with a global timestep for the same epsilon. Requires gravity BASIC (or NONE)
+     * and no variational particles. The default is 0 (all particles share one timestep).
+     **/
+    unsigned int block_levels;
+
+    /**
+     * @brief Convergence criterion of the predictor corrector loop.
+     * @details The loop is considered converged once the last correction of the b coefficients 
+     * relative to the acceleration (measured in the same way as the timestep error, see 
+     * epsilon_global) is smaller than max(pc_tolerance, pc_tolerance_epsilon*epsilon). 
+     * The default is 1e-16, i.e. the loop iterates to machine precision.
+     **/
+    double pc_tolerance;
+
+    /**
+     * @brief Convergence criterion of the predictor corrector loop relative to epsilon.
+     * @details See pc_tolerance. Setting this to a small number such as 1e-3 saves iterations 
+     * (and therefore force evaluations) if an accuracy of the order of epsilon is sufficient. 
+     * The default is 0.
+     **/
+    double pc_tolerance_epsilon;
+
+    /**
+     * @brief Maximum number of iterations of the predictor corrector loop.
+     * @details The loop also stops early if the correction stops decreasing. The default is 12. 
+     **/
+    unsigned int pc_iterations_max;
+
+    /**
+     * @brief Number of predictor corrector loops that needed a given number of iterations.
+     * @details Element i counts the loops that needed i iterations, the last element counts all 
+     * loops with 15 or more iterations. Every iteration costs 7 force evaluations. Rejected 
+     * timesteps are included. Set all elements to 0 to reset the statistics. The histogram is 
+     * not stored in binary files, so it does not affect SimulationArchive snapshots or comparisons.
+     **/
+    unsigned long iterations_histogram[16];
 
     
     /**
@@ -201,6 +248,10 @@ struct reb_simulation_integrator_ias15 {
 
     int* map;               // map to particles (identity map for non-mercurius simulations)
     int map_allocated_N;    // allocated size for map
+
+    struct reb_ias15_block* block;  ///< Internal state used for block timesteps
+    int activeN;            ///< Number of particles for which forces are needed (block timesteps only, 0 otherwise)
+    int* active_map;        ///< Particles for which forces are needed (block timesteps only)
     /**
      * @endcond
      */
@@ -291,6 +342,7 @@ struct reb_simulation_integrator_sei {
     double tandt;       ///< Cached tan() 
     double sindtz;      ///< Cached sin(), z axis
     double tandtz;      ///< Cached tan(), z axis
+    unsigned int boundary_wrapped; ///< Set if the last integrator pass already applied the shear-periodic boundary conditions
     /** @endcond */
 };
 
@@ -429,6 +481,39 @@ struct reb_simulation_integrator_whfast {
      */
     unsigned int keep_unsynchronized;
 
+    /**
+     * @brief Use compensated summation for the time and the Jacobi/heliocentric coordinates.
+     * @details If set to 1, the simulation time is accumulated with compensated 
+     * (Kahan) summation and the position and velocity increments of the Kepler 
+     * and interaction steps are added with compensated summation. This reduces
+     * the round-off error in very long integrations. The compensation terms are
+     * discarded whenever the Jacobi/heliocentric coordinates are recalculated,
+     * so this is most useful together with safe_mode set to 0.
+     * Default is 0.
+     */
+    unsigned int compensated;
+
+    /**
+     * @brief Maximum number of substeps for test particles.
+     * @details If larger than 1, test particles on orbits with a small pericenter 
+     * distance are sub-cycled within each timestep. A test particle uses 
+     * n = ceil(dt/(substeps_eta*T_q)) substeps, where T_q = 2*pi*sqrt(q^3/(G*M_0)) 
+     * is the period of a circular orbit at the pericenter distance q, but at most 
+     * substeps_max. During the substeps, the positions of the massive bodies are 
+     * interpolated with a quartic polynomial matching the positions and velocities 
+     * at the beginning and end of the timestep and the positions at the midpoint. 
+     * When sub-cycling is enabled, all test particles also receive the jump step.
+     * Sub-cycling is only used with democratic heliocentric coordinates, the default 
+     * kernel, safe_mode, testparticle_type 0, BASIC gravity and no additional forces.
+     * Default is 0 (no sub-cycling).
+     */
+    unsigned int substeps_max;
+
+    /**
+     * @brief Accuracy parameter for sub-cycling test particles. See substeps_max. Default is 0.05.
+     */
+    double substeps_eta;
+
     /**
      * @cond PRIVATE
      * Internal data structures below. Nothing to be changed by the user.
@@ -439,6 +524,13 @@ struct reb_simulation_integrator_whfast {
     unsigned int allocated_Ntemp;   ///< Space allocated in p_temp array
     unsigned int timestep_warning;  ///< Counter of timestep warnings
     unsigned int recalculate_coordinates_but_not_synchronized_warning;   ///< Counter of Jacobi synchronization errors
+    unsigned int allocated_N_cs;    ///< Space allocated in p_jh_cs array (number of particles)
+    double* REBOUND_RESTRICT p_jh_cs;   ///< Compensation terms for x, y, z, vx, vy, vz of p_jh (compensated mode only)
+    double t_cs;                    ///< Compensation term for the simulation time (compensated mode only)
+    double t_last;                  ///< Simulation time after the last compensated update
+    unsigned int allocated_N_substeps;  ///< Space allocated in the substeps and substeps_planets arrays (number of particles)
+    unsigned int* substeps;         ///< Number of substeps of each particle in the current timestep
+    double* substeps_planets;       ///< Interpolation coefficients for the heliocentric positions of the massive bodies
     /**
      * @endcond
      */
@@ -712,8 +804,30 @@ enum REB_BINARY_FIELD_TYPE {
     REB_BINARY_FIELD_TYPE_EOS_N = 150,
     REB_BINARY_FIELD_TYPE_EOS_SAFEMODE = 151,
     REB_BINARY_FIELD_TYPE_EOS_ISSYNCHRON = 152,
+    REB_BINARY_FIELD_TYPE_IAS15_BLOCKLEVELS = 153,
+    REB_BINARY_FIELD_TYPE_IAS15_PCTOLERANCE = 154,
+    REB_BINARY_FIELD_TYPE_IAS15_PCTOLERANCEEPSILON = 155,
+    REB_BINARY_FIELD_TYPE_IAS15_PCITERATIONSMAX = 156,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMN = 158,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMVARCONFIG = 159,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMINTERVAL = 160,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMT0 = 161,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMTLAST = 162,
+    REB_BINARY_FIELD_TYPE_LYAPUNOVSPECTRUMSUMS = 163,
+    REB_BINARY_FIELD_TYPE_WHFAST_COMPENSATED = 164,
+    REB_BINARY_FIELD_TYPE_WHFAST_PJCS = 165,
+    REB_BINARY_FIELD_TYPE_WHFAST_TCS = 166,
+    REB_BINARY_FIELD_TYPE_WHFAST_TLAST = 167,
+    REB_BINARY_FIELD_TYPE_GRAVITYMIXEDPRECISION = 168,
+    REB_BINARY_FIELD_TYPE_WHFAST_SUBSTEPSMAX = 169,
+    REB_BINARY_FIELD_TYPE_WHFAST_SUBSTEPSETA = 170,
+    REB_BINARY_FIELD_TYPE_SAINDEX = 171,
+    REB_BINARY_FIELD_TYPE_SAASYNC = 172,
+    REB_BINARY_FIELD_TYPE_SACOMPRESS = 173,
+    REB_BINARY_FIELD_TYPE_PARTICLESDELTA = 174, // Only the particles which changed, see reb_binary_diff_to_buffer()
 
     REB_BINARY_FIELD_TYPE_HEADER = 1329743186,  // Corresponds to REBO (first characters of header text)
+    REB_BINARY_FIELD_TYPE_SACOMPRESSED = 9997,  // Compressed SA snapshot
     REB_BINARY_FIELD_TYPE_SABLOB = 9998,        // SA Blob
     REB_BINARY_FIELD_TYPE_END = 9999,
 };
@@ -735,6 +849,89 @@ struct reb_simulationarchive_blob {
     int16_t offset_next;                   ///< Offset to end of following blob (size of following blob).
 };
 
+/**
+ * @brief One entry of a SimulationArchive index file.
+ * @details The index file has the same name as the SimulationArchive 
+ * with the suffix .idx appended. It contains one entry per snapshot.
+ */
+struct reb_simulationarchive_index_entry {
+    double t;                              ///< Simulation time of the snapshot
+    uint64_t offset;                       ///< Offset of the snapshot in the SimulationArchive file
+    uint64_t size;                         ///< Size of the snapshot in bytes (including the trailing blob)
+};
+
+
+/**
+ * @brief Header of a compressed SimulationArchive snapshot.
+ * @details A compressed snapshot consists of a T field, followed by a field of type
+ * REB_BINARY_FIELD_TYPE_SACOMPRESSED which contains this header and the compressed data.
+ * The data is the complete binary of the simulation, delta encoded against the binary
+ * of another snapshot (reference) and then compressed.
+ */
+struct reb_simulationarchive_compressed {
+    uint64_t size;                          ///< Size of the uncompressed binary in bytes
+    int64_t reference;                      ///< Snapshot used as reference. 0 corresponds to the initial binary.
+};
+
+/**
+ * @brief Length of a chain of compressed snapshots. The first snapshot of a chain is delta 
+ * encoded against the initial binary, the following ones against the previous snapshot. 
+ * At most this many snapshots need to be decompressed to read one snapshot.
+ */
+#define REB_SIMULATIONARCHIVE_KEYFRAME_INTERVAL 8
+
+/**
+ * @brief A serialized snapshot waiting to be written by the background writer thread.
+ */
+struct reb_simulationarchive_job {
+    char* buf;                              ///< Binary of the simulation (owned by the job)
+    size_t size;                            ///< Size of buf in bytes
+    double t;                               ///< Simulation time of the snapshot
+    int index;                              ///< Set to 1 if an entry should be appended to the index file
+    int compress;                           ///< Set to 1 if the snapshot should be compressed
+};
+
+/**
+ * @brief Maximum number of snapshots waiting to be written by the background writer thread.
+ */
+#define REB_SIMULATIONARCHIVE_QUEUE_SIZE 2
+
+/**
+ * @brief Minimum size of the buffer in which snapshots are collected before they are written to the file.
+ */
+#define REB_SIMULATIONARCHIVE_WRITE_BUFFER 262144
+
+/**
+ * @brief This structure caches the state needed to append snapshots to a SimulationArchive.
+ * @details The file is kept open and the initial binary is kept in memory so that
+ * appending a snapshot does not require re-reading the file. If asynchronous
+ * writing is enabled, the diff and the write are done by a background thread. 
+ * Everthing in this struct is handled by REBOUND itself.
+ */
+struct reb_simulationarchive_writer {
+    char* filename;                         ///< Name of the SimulationArchive file
+    FILE* of;                               ///< File pointer (kept open between snapshots)
+    FILE* of_index;                         ///< File pointer of the index file (NULL if not used)
+    char* buf_first;                        ///< Initial binary (without the trailing blob)
+    size_t size_first;                      ///< Size of buf_first in bytes
+    long size;                              ///< Size of the file after the last snapshot
+    dev_t dev;                              ///< Device of the file (used to detect if the file was replaced)
+    ino_t ino;                              ///< Inode of the file (used to detect if the file was replaced)
+    struct reb_simulationarchive_blob blob; ///< Blob at the end of the file
+    char* buf_prev;                         ///< Binary of the last snapshot if it was compressed, NULL otherwise
+    size_t size_prev;                       ///< Size of buf_prev in bytes
+    int delta_N;                            ///< Number of consecutive snapshots delta encoded against the previous snapshot
+    char* buf_diff;                         ///< Buffer for the differences to the initial binary or for writes (reused between snapshots)
+    size_t allocated_diff;                  ///< Size of buf_diff in bytes
+    int async;                              ///< Set to 1 if snapshots are written by the background thread
+    pthread_t thread;                       ///< Background writer thread (only used if async is 1)
+    pthread_mutex_t mutex;                  ///< Protects the queue
+    pthread_cond_t cond;                    ///< Signals changes of the queue
+    struct reb_simulationarchive_job queue[REB_SIMULATIONARCHIVE_QUEUE_SIZE]; ///< Ring buffer of pending snapshots
+    int queue_start;                        ///< Index of the oldest pending snapshot
+    int queue_N;                            ///< Number of pending snapshots
+    int quit;                               ///< Set to 1 to stop the background thread
+};
 
 /**
  * @brief This structure is used to save and load SimulationArchive files.
@@ -751,8 +948,82 @@ struct reb_simulationarchive{
     double auto_walltime;   ///< Walltime setting used to create SA (if used)
     unsigned long long auto_step;  ///< Steps in-between SA snapshots (if used)
     long nblobs;            ///< Total number of snapshots (including initial binary)
-    uint32_t* offset;       ///< Index of offsets in file (length nblobs)
+    uint64_t* offset;       ///< Index of offsets in file (length nblobs)
     double* t;              ///< Index of simulation times in file (length nblobs)
+    char* map;              ///< Read-only memory map of the file (NULL if the file could not be mapped)
+    uint64_t map_size;      ///< Size of the memory map in bytes
+};
+
+/**
+ * @brief Quantities that can be stored in a trajectory file. 
+ * @details Used as a bitmask in reb_output_trajectory(). 
+ */
+enum REB_TRAJECTORY_FIELDS {
+    REB_TRAJECTORY_POSITIONS = 1,    ///< Columns x, y, z
+    REB_TRAJECTORY_VELOCITIES = 2,   ///< Columns vx, vy, vz
+    REB_TRAJECTORY_ORBITS = 4,       ///< Columns a, e, inc, Omega, omega, l (Jacobi coordinates, NaN for particle 0)
+};
+
+/**
+ * @brief Columns of a trajectory file. 
+ * @details Only columns enabled by the fields of a chunk are stored.
+ */
+enum REB_TRAJECTORY_COLUMN {
+    REB_TRAJECTORY_X = 0,
+    REB_TRAJECTORY_Y = 1,
+    REB_TRAJECTORY_Z = 2,
+    REB_TRAJECTORY_VX = 3,
+    REB_TRAJECTORY_VY = 4,
+    REB_TRAJECTORY_VZ = 5,
+    REB_TRAJECTORY_A = 6,
+    REB_TRAJECTORY_E = 7,
+    REB_TRAJECTORY_INC = 8,
+    REB_TRAJECTORY_BIGOMEGA = 9,
+    REB_TRAJECTORY_OMEGA = 10,
+    REB_TRAJECTORY_L = 11,
+};
+
+/**
+ * @brief Header of a chunk in a trajectory file.
+ * @details A trajectory file starts with a 64 byte header, followed by chunks. Each chunk 
+ * consists of this header, the times t[n], the particle hashes hash[N] (uint32_t, padded to
+ * a multiple of 8 bytes), and then one double array [N][n] per column. The time series of one 
+ * particle and one column is therefore contiguous.
+ */
+struct reb_trajectory_chunk {
+    uint64_t n;             ///< Number of snapshots in this chunk
+    uint64_t N;             ///< Number of particles
+    uint64_t fields;        ///< Bitmask of REB_TRAJECTORY_FIELDS
+    double t_first;         ///< Time of the first snapshot
+    double t_last;          ///< Time of the last snapshot
+};
+
+/**
+ * @brief This structure buffers snapshots of a trajectory file until a chunk is complete.
+ * @details Everthing in this struct is handled by REBOUND itself.
+ */
+struct reb_trajectory_writer {
+    char* filename;         ///< Name of the trajectory file
+    int fields;             ///< Bitmask of REB_TRAJECTORY_FIELDS
+    long N;                 ///< Number of particles
+    long n;                 ///< Number of buffered snapshots
+    long n_max;             ///< Capacity of the buffer (snapshots per chunk)
+    double* t;              ///< Buffered times [n_max]
+    uint32_t* hash;         ///< Particle hashes [N]
+    double* data;           ///< Buffered columns [columns][N][n_max]
+};
+
+/**
+ * @brief This structure is used to read trajectory files.
+ * @details The chunk headers form the chunk index. Everthing in this struct is handled 
+ * by REBOUND itself. 
+ */
+struct reb_trajectory {
+    FILE* inf;                              ///< File pointer (will be kept open)
+    char* filename;                         ///< Filename of open file
+    long nchunks;                           ///< Number of chunks
+    struct reb_trajectory_chunk* chunks;    ///< Chunk headers (length nchunks)
+    uint64_t* offset;                       ///< Offset of the chunk data (after the chunk header) in the file (length nchunks)
 };
 
 /**
@@ -799,6 +1070,18 @@ struct reb_orbit {
     double rhill;    ///< Circular Hill radius 
 };
 
+/**
+ * @brief Structure containing the errors of the mixed precision force calculation.
+ * @details This structure is returned by reb_tools_mixed_precision_report().
+ * Errors are relative errors of the acceleration vectors, |a_mixed-a|/|a|.
+ */
+struct reb_mixed_precision_report {
+    double max_error;       ///< Largest relative acceleration error
+    double rms_error;       ///< Root mean square of the relative acceleration errors
+    int max_error_index;    ///< Index of the particle with the largest error (-1 if no particle was compared)
+    int N;                  ///< Number of particles compared
+};
+
 /**
  * @brief Main struct encapsulating one entire REBOUND simulation
  * @details This structure contains all variables, status flags and pointers of one 
@@ -830,9 +1113,12 @@ struct reb_simulation {
     struct reb_particle* particles; ///< Main particle array. This contains all particles on this node.  
     struct reb_vec3d* gravity_cs;   ///< Vector containing the information for compensated gravity summation 
     int     gravity_cs_allocatedN;  ///< Current number of allocated space for cs array
+    double* gravity_mixed_sources;  ///< Positions and masses of active particles, packed for the mixed precision force calculation
+    int     gravity_mixed_sources_allocatedN;  ///< Current number of allocated space for gravity_mixed_sources (in particles)
     struct reb_treecell** tree_root;///< Pointer to the roots of the trees. 
     int     tree_needs_update;      ///< Flag to force a tree update (after boundary check)
     double opening_angle2;          ///< Square of the cell opening angle \f$ \theta \f$. 
+    unsigned int gravity_mixed_precision; ///< Set to 1 to calculate test particle forces (BASIC gravity) and far field cell forces (TREE gravity) in single precision with double precision accumulation. Not suitable for IAS15. Default: 0.
     enum REB_STATUS status;         ///< Set to 1 to exit the simulation at the end of the next timestep. 
     int     exact_finish_time;      ///< Set to 1 to finish the integration exactly at tmax. Set to 0 to finish at the next dt. Default is 1. 
 
@@ -920,6 +1206,18 @@ struct reb_simulation {
     double megno_mean_Y;    ///< mean of MEGNO Y
     long   megno_n;     ///< number of covariance updates
     /** @} */
+
+    /**
+     * \name Variables related to the Lyapunov spectrum
+     * @{
+     */
+    int lyapunov_spectrum_N;                ///< Number of Lyapunov exponents calculated (default=0, set by reb_tools_lyapunov_spectrum_init())
+    int lyapunov_spectrum_var_config;       ///< Index of the first of the lyapunov_spectrum_N variational configurations used
+    double lyapunov_spectrum_interval;      ///< Time between reorthonormalizations of the variational vectors. If 0, they are reorthonormalized after every timestep.
+    double lyapunov_spectrum_t0;            ///< Time at which the calculation started (internal use)
+    double lyapunov_spectrum_t_last;        ///< Time of the last reorthonormalization (internal use)
+    double* lyapunov_spectrum_sums;         ///< Running sums of the logarithmic growth of each vector (internal use)
+    /** @} */
     
     
     /**
@@ -935,6 +1233,11 @@ struct reb_simulation {
     double simulationarchive_next;              ///< Next output time (simulation tim or wall time, depending on wether auto_interval or auto_walltime is set)
     unsigned long long simulationarchive_next_step; ///< Next output step (only used if auto_steps is set)
     char*  simulationarchive_filename;          ///< Name of output file
+    int    simulationarchive_index;             ///< If 1, an index file (filename.idx) is written alongside the SA. Speeds up opening large SAs. Default: 0.
+    int    simulationarchive_async;             ///< If 1, snapshots are written to disk by a background thread. The integration only waits if more than REB_SIMULATIONARCHIVE_QUEUE_SIZE snapshots are pending. Default: 0.
+    int    simulationarchive_compress;          ///< If 1, snapshots are delta encoded against the previous snapshot and compressed. Default: 0.
+    struct reb_simulationarchive_writer* simulationarchive_writer; ///< Cached state for appending snapshots. Internal use only.
+    struct reb_trajectory_writer* trajectory_writer; ///< Buffered snapshots of reb_output_trajectory(). Internal use only.
     /** @} */
 
     /**
@@ -1195,6 +1498,17 @@ void reb_mpi_finalize(struct reb_simulation* const r);
  * @brief Wrapper method to set number of OpenMP threads from python.
  */
 void reb_omp_set_num_threads(int num_threads);
+
+/**
+ * @brief Choose between fast and reproducible parallel reductions.
+ * @details If deterministic is 1, sums over particles in the coordinate transformations
+ * are calculated in the same order as in the serial version so that the results are
+ * bitwise identical to a build without OpenMP. If deterministic is 0, these sums 
+ * and the prefix sums of the Jacobi transformations are calculated in parallel. 
+ * The results then depend on the number of threads at the level of round-off.
+ * The library uses the parallel sums until this function is called.
+ */
+void reb_omp_set_deterministic(int deterministic);
 #endif // OPENMP
 
 /**
@@ -1482,6 +1796,18 @@ void reb_output_orbits(struct reb_simulation* r, char* filename);
  */
 void reb_output_binary(struct reb_simulation* r, const char* filename);
 
+/**
+ * @brief Writes the reb_simulation structure as a binary to a file descriptor
+ * @details The data is the same as the content of a file written by reb_output_binary().
+ * It is written in one pass without a temporary file. The file descriptor can be
+ * a file, a pipe, or a socket. It is not closed. Use reb_create_simulation_from_fd()
+ * to read the simulation back.
+ * @param r The rebound simulation to be considered
+ * @param fd File descriptor open for writing.
+ * @return 0 on success, -1 if an error occured (errno is set).
+ */
+int reb_output_binary_to_fd(struct reb_simulation* r, int fd);
+
 /**
  * @brief This function compares two REBOUND simulations and records the difference in a buffer.
  * @details This is used for taking a SimulationArchive Snapshot.
@@ -1498,6 +1824,24 @@ void reb_binary_diff(char* buf1, size_t size1, char* buf2, size_t size2, char**
  */
 int reb_binary_diff_with_options(char* buf1, size_t size1, char* buf2, size_t size2, char** bufp, size_t* sizep, int output_option);
 
+/**
+ * @brief Same as reb_binary_diff but writes the differences into a buffer provided by the caller.
+ * @details No memory is allocated, so the same buffer can be reused for many diffs. 
+ * If the buffer is too small, nothing is written and sizep is set to the required size.
+ * @param buf1 The buffer corresponding to the first rebound simulation to be compared
+ * @param buf2 The buffer corresponding to the second rebound simulation to be compared
+ * @param buf The buffer which will contain the differences. Can be NULL if capacity is 0.
+ * @param capacity Size of buf in bytes.
+ * @param sizep Will be set to the size of the differences in bytes.
+ * @param particle_deltas If set to 1, a particles field which differs is written as a field of type 
+ * REB_BINARY_FIELD_TYPE_PARTICLESDELTA which only contains the particles which changed (each preceded 
+ * by its index as a uint32_t), provided this is smaller than the complete field. 
+ * Older versions of REBOUND cannot read such a field.
+ * @return 0 is returned if the simulations do not differ (are equal). 1 is return if they differ. 
+ * -1 is returned if buf is too small.
+ */
+int reb_binary_diff_to_buffer(char* buf1, size_t size1, char* buf2, size_t size2, char* buf, size_t capacity, size_t* sizep, int particle_deltas);
+
 /**
  * @brief Append the positions and velocities of all particles to an ASCII file.
  * @param r The rebound simulation to be considered
@@ -1630,6 +1974,19 @@ struct reb_particle reb_tools_pal_to_particle(double G, struct reb_particle prim
  */
 struct reb_simulation* reb_create_simulation_from_binary(char* filename);
 
+/**
+ * @brief Reads a binary from a file descriptor.
+ * @details Reads exactly one binary written by reb_output_binary_to_fd() or 
+ * reb_output_binary() from a file, pipe, or socket and creates a simulation from it.
+ * The function blocks until the binary has been received. No data after the end 
+ * of the binary is consumed, so several simulations can be sent over the same 
+ * file descriptor. The file descriptor is not closed. As for reb_create_simulation_from_binary(),
+ * function pointers need to be set again.
+ * @param fd File descriptor open for reading.
+ * @return Returns a pointer to a REBOUND simulation or NULL if no binary could be read.
+ */
+struct reb_simulation* reb_create_simulation_from_fd(int fd);
+
 /**
  * @brief Enum describing possible errors that might occur during binary file reading.
  */
@@ -1644,8 +2001,14 @@ enum reb_input_binary_messages {
     REB_INPUT_BINARY_ERROR_SEEK = 64,
     REB_INPUT_BINARY_WARNING_FIELD_UNKOWN = 128,
     REB_INPUT_BINARY_ERROR_INTEGRATOR = 256,
+    REB_INPUT_BINARY_ERROR_CORRUPT = 512,   ///< A field extends past the end of the data. The simulation is not freed.
 };
 
+/**
+ * @brief Equivalent to reb_create_simulation_from_fd() but also processes warning messages.
+ */
+void reb_create_simulation_from_fd_with_messages(struct reb_simulation* r, int fd, enum reb_input_binary_messages* warnings);
+
 /**
  * @brief This function sets up a Plummer sphere.
  * @param r The rebound simulation to be considered
@@ -1840,6 +2203,53 @@ struct reb_simulationarchive* reb_open_simulationarchive(const char* filename);
  */
 void reb_close_simulationarchive(struct reb_simulationarchive* sa);
 
+/**
+ * @brief Sets arrays to the particle data of a SimulationArchive snapshot.
+ * @details This function is a faster alternative to creating a simulation with
+ * reb_create_simulation_from_simulationarchive() and calling reb_serialize_particle_data().
+ * For version 2 SimulationArchives, the particle data is copied directly from the 
+ * memory-mapped file without creating a reb_simulation. The data is the one stored in 
+ * the snapshot. For WHFast/MERCURIUS with safe_mode turned off, this is not synchronized. 
+ * NULL pointers will not be set. The arrays need to be large enough to hold the data 
+ * of all particles. Call the function with all arrays set to NULL to get the number 
+ * of particles. 
+ * @param sa The SimulationArchive to read from.
+ * @param snapshot The index of the snapshot (negative values count from the end).
+ * @param hash 1D array to to hold particle hashes
+ * @param m 1D array to to hold particle masses
+ * @param radius 1D array to to hold particle radii
+ * @param xyz 3D array to to hold particle positions
+ * @param vxvyvz 3D array to to hold particle velocities
+ * @param xyzvxvyvz 3D array to to hold particle positions and velocities
+ * @return Number of particles in the snapshot (N-N_var) or -1 if an error occured.
+ */
+long reb_simulationarchive_serialize_particle_data(struct reb_simulationarchive* sa, long snapshot, uint32_t* hash, double* m, double* radius, double (*xyz)[3], double (*vxvyvz)[3], double (*xyzvxvyvz)[6]);
+
+/**
+ * @brief Integrates a SimulationArchive to many times and stores the particle data.
+ * @details The requested times are grouped by the snapshot preceding them. 
+ * For each group, a simulation is created from the snapshot only once and then
+ * integrated forward from one requested time to the next. Groups are processed
+ * in parallel by Nthreads threads. Additional forces and other function pointers
+ * are not restored, use reb_create_simulation_from_simulationarchive() if they are
+ * needed. In mode 1 (close) the results are bitwise identical to integrating each 
+ * time separately from the snapshot, except for EOS and MERCURIUS with safe_mode 
+ * set to 0. These integrators are synchronized at every requested time and the 
+ * results agree to the accuracy of the integrator. In mode 2 (exact) they agree to 
+ * the accuracy of the integrator because the timestep is adjusted at every requested time.
+ * @param sa The SimulationArchive to read from.
+ * @param times Requested times, sorted in ascending order. Need to be within the times of the first and last snapshot.
+ * @param Ntimes Number of requested times.
+ * @param mode 0 (snapshot): use the snapshot preceding each time. 1 (close): integrate to each time, may overshoot by at most one timestep. 2 (exact): integrate exactly to each time.
+ * @param keep_unsynchronized If 1, the integration continues with unsynchronized coordinates (WHFast/SABA only, see reb_simulation_integrator_whfast). Ignored in modes 1 and 2. The particle data is synchronized in any case.
+ * @param Nthreads Number of threads. If less than 1, the number of online processors is used.
+ * @param N Number of particles (N-N_var) in every snapshot.
+ * @param t 1D array of length Ntimes to hold the simulation times reached.
+ * @param xyzvxvyvz 3D array of size Ntimes*N to hold particle positions and velocities.
+ * @return 0 on success, -1 if the input is invalid or a snapshot cannot be read, -2 if a snapshot does not have N particles, or the REB_STATUS of an integration that did not finish successfully.
+ */
+int reb_simulationarchive_integrate_times(struct reb_simulationarchive* sa, const double* times, long Ntimes, int mode, int keep_unsynchronized, int Nthreads, long N, double* t, double (*xyzvxvyvz)[6]);
+
 /**
  * @brief Appends a SimulationArchive snapshot to a file
  * @details This function can either be called manually or via one of the convenience methods
@@ -1851,6 +2261,15 @@ void reb_close_simulationarchive(struct reb_simulationarchive* sa);
  */
 void reb_simulationarchive_snapshot(struct reb_simulation* r, const char* filename);
 
+/**
+ * @brief Waits until all pending SimulationArchive snapshots have been written to disk
+ * @details Only has an effect if simulationarchive_async is set. The function is called
+ * automatically at the end of reb_integrate() and when the simulation is freed. Call it 
+ * manually before reading a SimulationArchive that is still being written to.
+ * @param r The rebound simulation to be considered.
+ */
+void reb_simulationarchive_flush(struct reb_simulation* const r);
+
 /**
  * @brief Automatically create a SimulationArchive Snapshot at regular intervals
  * @param r The rebound simulation to be considered.
@@ -1890,6 +2309,76 @@ void reb_free_simulationarchive_pointers(struct reb_simulationarchive* sa);
 
 /** @} */
 
+/**
+ * @defgroup TrajectoryFunctions Trajectory functions
+ * Functions to write and read columnar trajectory files.
+ * @{
+ */
+
+/**
+ * @brief Appends the current state of all particles to a trajectory file.
+ * @details Trajectory files are meant for post-processing. Unlike SimulationArchives,
+ * they cannot be used to restart a simulation. Snapshots are buffered in memory 
+ * and written in chunks. A chunk is written when it is full, when the number of 
+ * particles, the fields, or the filename change, when reb_output_trajectory_flush()
+ * is called, and when the simulation is freed. Chunks are only ever appended to the file. 
+ * @param r The rebound simulation to be considered.
+ * @param filename The path and filename of the trajectory file.
+ * @param fields Bitmask of REB_TRAJECTORY_FIELDS to be stored.
+ */
+void reb_output_trajectory(struct reb_simulation* r, const char* filename, int fields);
+
+/**
+ * @brief Writes all buffered snapshots of reb_output_trajectory() to the file. 
+ * @param r The rebound simulation to be considered.
+ */
+void reb_output_trajectory_flush(struct reb_simulation* r);
+
+/**
+ * @brief Opens a trajectory file and reads its chunk index.
+ * @param filename The path and filename of the trajectory file.
+ * @return Returns a pointer to the reb_trajectory struct or NULL if the file could not be read. 
+ */
+struct reb_trajectory* reb_open_trajectory(const char* filename);
+
+/**
+ * @brief Same as reb_open_trajectory() but reads into an existing structure. 
+ * @param tr The structure to be filled.
+ * @param filename The path and filename of the trajectory file.
+ * @return 0 on success, -1 if the file could not be opened or is not a trajectory file. 
+ */
+int reb_read_trajectory(struct reb_trajectory* tr, const char* filename);
+
+/**
+ * @brief Closes a trajectory file and frees the allocated memory. 
+ * @param tr The trajectory to be closed.
+ */
+void reb_close_trajectory(struct reb_trajectory* tr);
+
+/**
+ * @brief Frees all the pointers in a reb_trajectory structure but not the structure itself. 
+ * @param tr The trajectory to be closed.
+ */
+void reb_free_trajectory_pointers(struct reb_trajectory* tr);
+
+/**
+ * @brief Reads the time series of one column of one particle. 
+ * @details Only chunks overlapping with the time range are read. 
+ * @param tr The trajectory to read from.
+ * @param column The column to read (see REB_TRAJECTORY_COLUMN).
+ * @param particle The index of the particle. 
+ * @param tmin Beginning of the time range (inclusive).
+ * @param tmax End of the time range (inclusive).
+ * @param t Array to hold the times (can be NULL).
+ * @param values Array to hold the values (can be NULL).
+ * @return Number of values in the time range. Chunks which do not contain the column or 
+ * the particle are skipped. Call with t and values set to NULL to get the size of the arrays 
+ * needed. Returns -1 if the file could not be read.
+ */
+long reb_trajectory_read(struct reb_trajectory* tr, int column, long particle, double tmin, double tmax, double* t, double* values);
+
+/** @} */
+
 /**
  * @defgroup TransformationFunctions Coordinate transformations
  * Functions for transforming between various coordinate systems.
@@ -2055,6 +2544,48 @@ double reb_tools_calculate_megno(struct reb_simulation* r);
  */
 double reb_tools_calculate_lyapunov(struct reb_simulation* r);
 
+/** 
+ * @brief Init the variational particles needed for the calculation of the Lyapunov spectrum
+ * @details Adds N_exponents sets of first order variational particles. They are
+ * reorthonormalized with a QR decomposition in regular intervals. Call this function after
+ * all particles have been added. 
+ * @param r The rebound simulation to be considered
+ * @param N_exponents Number of Lyapunov exponents to be calculated (at most 6 times the number of particles).
+ * @param interval Time between reorthonormalizations. If 0, the vectors are reorthonormalized after every timestep.
+ */
+void reb_tools_lyapunov_spectrum_init(struct reb_simulation* const r, int N_exponents, double interval);
+
+/** 
+ * @brief Init the variational particles needed for the Lyapunov spectrum and specify a seed for the random number generation.
+ * @param r The rebound simulation to be considered
+ * @param N_exponents Number of Lyapunov exponents to be calculated.
+ * @param interval Time between reorthonormalizations.
+ * @param seed The seed to use for the random number generator
+ */
+void reb_tools_lyapunov_spectrum_init_seed(struct reb_simulation* const r, int N_exponents, double interval, unsigned int seed);
+
+/**
+ * @brief Returns the Lyapunov spectrum
+ * @details The exponents are calculated at the time of the last reorthonormalization
+ * and are sorted in descending order (apart from statistical noise).
+ * @param r The rebound simulation to be considered
+ * @param lyapunov Array of length lyapunov_spectrum_N that will be filled with the exponents
+ */
+void reb_tools_calculate_lyapunov_spectrum(struct reb_simulation* const r, double* lyapunov);
+
+/**
+ * @brief Measures the accuracy of the mixed precision force calculation for the current snapshot.
+ * @details Calculates the gravitational accelerations once with gravity_mixed_precision 
+ * turned on and once in double precision and compares them for all real particles with 
+ * non-vanishing acceleration. The particles' accelerations and the gravity_mixed_precision 
+ * flag are restored afterwards. Additional forces are not included. For TREE gravity, 
+ * the tree needs to exist (it is created when particles are added after the box has been
+ * configured), otherwise an empty report is returned.
+ * @param r The rebound simulation to be considered
+ * @return A reb_mixed_precision_report structure with the relative errors.
+ */
+struct reb_mixed_precision_report reb_tools_mixed_precision_report(struct reb_simulation* const r);
+
 /**
  * @brief Returns hash for passed string.
  * @param str String key. 
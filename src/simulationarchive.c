@@ -30,16 +30,215 @@
 #include <string.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdint.h>
 #include "particle.h"
 #include "rebound.h"
 #include "binarydiff.h"
+#include "compression.h"
 #include "output.h"
 #include "tools.h"
 #include "input.h"
 #include "output.h"
+#include "integrator.h"
 #include "integrator_ias15.h"
 
+// Returns the name of the index file belonging to a SimulationArchive. Needs to be freed.
+static char* reb_simulationarchive_index_filename(const char* filename){
+    char* filename_index = malloc(strlen(filename)+5);
+    sprintf(filename_index,"%s.idx",filename);
+    return filename_index;
+}
+
+// Loads the index file of a version 2 SimulationArchive into sa->t and sa->offset.
+// Returns the number of entries that could be used. Entries are only used if they are
+// consistent with the SimulationArchive. size_first is the size of the initial binary.
+static long reb_simulationarchive_read_index(struct reb_simulationarchive* sa, const double t0, const long size_first, long* offset_end){
+    char* filename_index = reb_simulationarchive_index_filename(sa->filename);
+    FILE* inf = fopen(filename_index,"rb");
+    free(filename_index);
+    if (inf==NULL){
+        return 0;
+    }
+    fseek(inf, 0, SEEK_END);
+    const long size = ftell(inf);
+    long n = size/sizeof(struct reb_simulationarchive_index_entry);
+    if (n>sa->nblobs || n*(long)sizeof(struct reb_simulationarchive_index_entry)!=size){
+        // Index belongs to a different file
+        fclose(inf);
+        return 0;
+    }
+    struct reb_simulationarchive_index_entry* entries = malloc(size);
+    fseek(inf, 0, SEEK_SET);
+    if (n==0 || fread(entries, size, 1, inf)!=1){
+        n = 0;
+    }
+    fclose(inf);
+    if (n>0){
+        // Check first and last entry 
+        const struct reb_simulationarchive_index_entry last = entries[n-1];
+        struct reb_simulationarchive_blob blob = {0};
+        if (entries[0].offset!=0 || entries[0].size!=(uint64_t)size_first || entries[0].t!=t0 
+                || fseek(sa->inf, last.offset+last.size-sizeof(struct reb_simulationarchive_blob), SEEK_SET)
+                || fread(&blob, sizeof(struct reb_simulationarchive_blob), 1, sa->inf)!=1
+                || blob.index!=n-1){
+            n = 0;
+        }
+    }
+    for (long i=0;i<n;i++){
+        sa->t[i] = entries[i].t;
+        sa->offset[i] = entries[i].offset;
+    }
+    if (n>0){
+        *offset_end = entries[n-1].offset+entries[n-1].size;
+    }
+    free(entries);
+    return n;
+}
+
+// Appends an entry to the index file. The entry is only written if the index 
+// file is up to date, i.e. contains one entry for each of the first index snapshots.
+static void reb_simulationarchive_append_index(struct reb_simulation* const r, const char* filename, const long index, const uint64_t offset, const uint64_t size){
+    char* filename_index = reb_simulationarchive_index_filename(filename);
+    FILE* of = fopen(filename_index, index==0?"wb":"r+b");
+    free(filename_index);
+    if (of==NULL){
+        if (index==0){
+            reb_warning(r, "Cannot create SimulationArchive index file.");
+        }
+        return;
+    }
+    fseek(of, 0, SEEK_END);
+    if (ftell(of)==index*(long)sizeof(struct reb_simulationarchive_index_entry)){
+        struct reb_simulationarchive_index_entry entry = {.t = r->t, .offset = offset, .size = size};
+        fwrite(&entry, sizeof(struct reb_simulationarchive_index_entry), 1, of);
+    }
+    fclose(of);
+}
+
+
+// Returns a copy of the fields of a version 2 snapshot (without the trailing blob). Needs to be freed.
+static char* reb_simulationarchive_read_snapshot(struct reb_simulationarchive* sa, const long snapshot, size_t* sizep){
+    uint64_t end;
+    if (snapshot+1<sa->nblobs){
+        end = sa->offset[snapshot+1];
+    }else if (sa->map){
+        end = sa->map_size;
+    }else{
+        fseek(sa->inf, 0, SEEK_END);
+        end = ftell(sa->inf);
+    }
+    if (end<sa->offset[snapshot]+sizeof(struct reb_simulationarchive_blob)){
+        return NULL;
+    }
+    *sizep = end - sa->offset[snapshot] - sizeof(struct reb_simulationarchive_blob);
+    char* buf = malloc(*sizep);
+    if (buf==NULL){
+        return NULL;
+    }
+    if (sa->map){
+        memcpy(buf, sa->map+sa->offset[snapshot], *sizep);
+    }else{
+        fseek(sa->inf, sa->offset[snapshot], SEEK_SET);
+        if (fread(buf, *sizep, 1, sa->inf)!=1){
+            free(buf);
+            return NULL;
+        }
+    }
+    return buf;
+}
+
+// Returns 1 if all fields of a binary in memory, up to and including the END field, lie 
+// within the buffer. reb_input_field() does not check bounds when reading from memory, 
+// so this has to be checked before for data from a file.
+static int reb_simulationarchive_fields_in_bounds(const char* mem_stream, const char* const end){
+    struct reb_binary_field field;
+    do{
+        if (mem_stream>end || (size_t)(end-mem_stream)<sizeof(struct reb_binary_field)){
+            return 0;
+        }
+        memcpy(&field, mem_stream, sizeof(struct reb_binary_field));
+        mem_stream += sizeof(struct reb_binary_field);
+        if (field.type==REB_BINARY_FIELD_TYPE_HEADER){
+            field.size = 64 - sizeof(struct reb_binary_field); // The header has a fixed length
+        }
+        if (field.size>(uint64_t)(end-mem_stream)){
+            return 0;
+        }
+        mem_stream += field.size;
+    }while(field.type!=REB_BINARY_FIELD_TYPE_END);
+    return 1;
+}
+
+// Returns 1 if a snapshot is compressed. A compressed snapshot starts with a T field 
+// followed by a field of type REB_BINARY_FIELD_TYPE_SACOMPRESSED.
+static int reb_simulationarchive_is_compressed(struct reb_simulationarchive* sa, const long snapshot){
+    if (sa->version<2 || snapshot<=0){
+        return 0;
+    }
+    struct reb_binary_field fields[2];
+    const uint64_t offset = sa->offset[snapshot];
+    if (sa->map){
+        if (offset+2*sizeof(struct reb_binary_field)+sizeof(double)>sa->map_size) return 0;
+        memcpy(&fields[0], sa->map+offset, sizeof(struct reb_binary_field));
+        memcpy(&fields[1], sa->map+offset+sizeof(struct reb_binary_field)+sizeof(double), sizeof(struct reb_binary_field));
+    }else{
+        fseek(sa->inf, offset, SEEK_SET);
+        if (fread(&fields[0], sizeof(struct reb_binary_field), 1, sa->inf)!=1) return 0;
+        fseek(sa->inf, sizeof(double), SEEK_CUR);
+        if (fread(&fields[1], sizeof(struct reb_binary_field), 1, sa->inf)!=1) return 0;
+    }
+    return fields[0].type==REB_BINARY_FIELD_TYPE_T && fields[0].size==sizeof(double) && fields[1].type==REB_BINARY_FIELD_TYPE_SACOMPRESSED;
+}
+
+// Returns the complete binary stored in a compressed snapshot. Snapshots used as 
+// a reference are decompressed recursively. Needs to be freed. Returns NULL on error.
+static char* reb_simulationarchive_decompress(struct reb_simulationarchive* sa, const long snapshot, size_t* sizep){
+    size_t size_snapshot;
+    char* buf_snapshot = reb_simulationarchive_read_snapshot(sa, snapshot, &size_snapshot);
+    const size_t size_fields = 2*sizeof(struct reb_binary_field) + sizeof(double);
+    if (buf_snapshot==NULL){
+        return NULL;
+    }
+    if (size_snapshot<size_fields+sizeof(struct reb_simulationarchive_compressed)){
+        free(buf_snapshot);
+        return NULL;
+    }
+    struct reb_binary_field field;
+    struct reb_simulationarchive_compressed header;
+    memcpy(&field, buf_snapshot+sizeof(struct reb_binary_field)+sizeof(double), sizeof(struct reb_binary_field));
+    memcpy(&header, buf_snapshot+size_fields, sizeof(struct reb_simulationarchive_compressed));
+    if (field.size<sizeof(struct reb_simulationarchive_compressed) || field.size>size_snapshot-size_fields
+            || header.reference<0 || header.reference>=snapshot 
+            || (header.reference>0 && !reb_simulationarchive_is_compressed(sa, header.reference))){
+        free(buf_snapshot);
+        return NULL;
+    }
+
+    size_t size_ref;
+    char* buf_ref;
+    if (header.reference==0){
+        buf_ref = reb_simulationarchive_read_snapshot(sa, 0, &size_ref);
+    }else{
+        buf_ref = reb_simulationarchive_decompress(sa, header.reference, &size_ref);
+    }
+    char* buf = NULL;
+    if (buf_ref){
+        buf = malloc(header.size);
+    }
+    if (buf){
+        const char* buf_compressed = buf_snapshot+size_fields+sizeof(struct reb_simulationarchive_compressed);
+        const size_t size_compressed = field.size-sizeof(struct reb_simulationarchive_compressed);
+        if (reb_decompress_delta(buf_ref, size_ref, buf_compressed, size_compressed, buf, header.size)){
+            free(buf);
+            buf = NULL;
+        }
+    }
+    free(buf_ref);
+    free(buf_snapshot);
+    *sizep = header.size;
+    return buf;
+}
 
 void reb_create_simulation_from_simulationarchive_with_messages(struct reb_simulation* r, struct reb_simulationarchive* sa, long snapshot, enum reb_input_binary_messages* warnings){
     FILE* inf = sa->inf;
@@ -63,12 +262,53 @@ void reb_create_simulation_from_simulationarchive_with_messages(struct reb_simul
     // Set to old version by default. Will be overwritten if new version was used.
     r->simulationarchive_version = 0;
 
-    fseek(inf, 0, SEEK_SET);
-    while(reb_input_field(r, inf, warnings,NULL)){ }
+    if (sa->map){
+        // Read fields directly from the memory map
+        char* mem_stream = sa->map;
+        if (!reb_simulationarchive_fields_in_bounds(mem_stream, sa->map+sa->map_size)){
+            *warnings |= REB_INPUT_BINARY_ERROR_CORRUPT;
+            return;
+        }
+        while(reb_input_field(r, NULL, warnings, &mem_stream)){ }
+    }else{
+        fseek(inf, 0, SEEK_SET);
+        while(reb_input_field(r, inf, warnings,NULL)){ }
+    }
 
     // Done?
     if (snapshot==0) return;
 
+    if (reb_simulationarchive_is_compressed(sa, snapshot)){
+        // Compressed snapshots contain the complete binary
+        size_t size;
+        char* buf = reb_simulationarchive_decompress(sa, snapshot, &size);
+        if (buf==NULL){
+            *warnings |= REB_INPUT_BINARY_ERROR_SEEK;
+            reb_free_simulation(r);
+            return;
+        }
+        char* mem_stream = buf;
+        if (!reb_simulationarchive_fields_in_bounds(mem_stream, buf+size)){
+            *warnings |= REB_INPUT_BINARY_ERROR_CORRUPT;
+            free(buf);
+            return;
+        }
+        while(reb_input_field(r, NULL, warnings, &mem_stream)){ }
+        free(buf);
+        return;
+    }
+
+    if (r->simulationarchive_version>=2 && sa->map){
+        // Apply the snapshot's diff directly from the memory map
+        char* mem_stream = sa->map + sa->offset[snapshot];
+        if (!reb_simulationarchive_fields_in_bounds(mem_stream, sa->map+sa->map_size)){
+            *warnings |= REB_INPUT_BINARY_ERROR_CORRUPT;
+            return;
+        }
+        while(reb_input_field(r, NULL, warnings, &mem_stream)){ }
+        return;
+    }
+
     // Read SA snapshot
     if(fseek(inf, sa->offset[snapshot], SEEK_SET)){
         *warnings |= REB_INPUT_BINARY_ERROR_SEEK;
@@ -233,6 +473,8 @@ struct reb_simulation* reb_create_simulation_from_simulationarchive(struct reb_s
 }
 
 void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa, const char* filename, enum reb_input_binary_messages* warnings){
+    sa->map = NULL;
+    sa->map_size = 0;
     sa->inf = fopen(filename,"r");
     if (sa->inf==NULL){
         *warnings |= REB_INPUT_BINARY_ERROR_NOFILE;
@@ -292,6 +534,7 @@ void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa,
                 break;
         }
     }while(field.type!=REB_BINARY_FIELD_TYPE_END);
+    const long size_first = ftell(sa->inf)+sizeof(struct reb_simulationarchive_blob);
 
     // Make index
     if (sa->version<2){
@@ -305,7 +548,7 @@ void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa,
         fseek(sa->inf, 0, SEEK_END);  
         sa->nblobs = (ftell(sa->inf)-sa->size_first)/sa->size_snapshot+1; // +1 accounts for first binary 
         sa->t = malloc(sizeof(double)*sa->nblobs);
-        sa->offset = malloc(sizeof(uint32_t)*sa->nblobs);
+        sa->offset = malloc(sizeof(uint64_t)*sa->nblobs);
         sa->t[0] = t0;
         sa->offset[0] = 0;
         for(long i=1;i<sa->nblobs;i++){
@@ -321,10 +564,14 @@ void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa,
         fread(&blob, sizeof(struct reb_simulationarchive_blob), 1, sa->inf);
         sa->nblobs = blob.index+1;
         sa->t = malloc(sizeof(double)*sa->nblobs);
-        sa->offset = malloc(sizeof(uint32_t)*sa->nblobs);
-        fseek(sa->inf, 0, SEEK_SET);  
+        sa->offset = malloc(sizeof(uint64_t)*sa->nblobs);
+
+        // Use index file if available. Only snapshots not in the index need to be scanned.
+        long offset_end = 0;
+        const long nindex = reb_simulationarchive_read_index(sa, t0, size_first, &offset_end);
+        fseek(sa->inf, offset_end, SEEK_SET);  
         
-        for(long i=0;i<sa->nblobs;i++){
+        for(long i=nindex;i<sa->nblobs;i++){
             struct reb_binary_field field = {0};
             sa->offset[i] = ftell(sa->inf);
             do{
@@ -353,6 +600,18 @@ void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa,
                 return;
             }
         }
+
+        // Map the file into memory. Snapshots are then read without any 
+        // further system calls. If mapping fails, the file is read with fread.
+        fseek(sa->inf, 0, SEEK_END);
+        const long size = ftell(sa->inf);
+        if (size>0){
+            void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(sa->inf), 0);
+            if (map!=MAP_FAILED){
+                sa->map = map;
+                sa->map_size = size;
+            }
+        }
     }
 }
 
@@ -380,11 +639,311 @@ void reb_free_simulationarchive_pointers(struct reb_simulationarchive* sa){
     if (sa->inf){
         fclose(sa->inf);
     }
+    if (sa->map){
+        munmap(sa->map, sa->map_size);
+        sa->map = NULL;
+    }
     free(sa->filename);
     free(sa->t);
     free(sa->offset);
 }
     
+long reb_simulationarchive_serialize_particle_data(struct reb_simulationarchive* sa, long snapshot, uint32_t* hash, double* m, double* radius, double (*xyz)[3], double (*vxvyvz)[3], double (*xyzvxvyvz)[6]){
+    if (sa==NULL || sa->inf==NULL) return -1;
+    if (snapshot<0) snapshot += sa->nblobs;
+    if (snapshot>=sa->nblobs || snapshot<0) return -1;
+    if (sa->map==NULL){
+        // Fall back to creating a simulation
+        enum reb_input_binary_messages warnings = REB_INPUT_BINARY_WARNING_NONE;
+        struct reb_simulation* r = reb_create_simulation();
+        reb_create_simulation_from_simulationarchive_with_messages(r, sa, snapshot, &warnings);
+        if (warnings & (REB_INPUT_BINARY_ERROR_SEEK | REB_INPUT_BINARY_ERROR_INTEGRATOR)){
+            // The simulation has already been freed.
+            return -1;
+        }
+        if (warnings & REB_INPUT_BINARY_ERROR_CORRUPT){
+            reb_free_simulation(r);
+            return -1;
+        }
+        reb_serialize_particle_data(r, hash, m, radius, xyz, vxvyvz, xyzvxvyvz);
+        const long N_real = r->N - r->N_var;
+        reb_free_simulation(r);
+        return N_real;
+    }
+
+    // Find the particle data and the number of particles. The snapshot's 
+    // diff overwrites the values of the initial binary.
+    if (sa->offset[snapshot]>sa->map_size){
+        return -1;
+    }
+    const char* bufs[2] = {sa->map, sa->map + sa->offset[snapshot]};
+    const char* ends[2] = {sa->map + sa->map_size, sa->map + sa->map_size};
+    int Nbufs = snapshot?2:1;
+    char* buf_decompressed = NULL;
+    if (reb_simulationarchive_is_compressed(sa, snapshot)){
+        // Compressed snapshots contain the complete binary
+        size_t size;
+        buf_decompressed = reb_simulationarchive_decompress(sa, snapshot, &size);
+        if (buf_decompressed==NULL){
+            return -1;
+        }
+        bufs[0] = buf_decompressed;
+        ends[0] = buf_decompressed + size;
+        Nbufs = 1;
+    }
+    int N = 0;
+    int N_var = 0;
+    const char* particles = NULL;
+    uint64_t particles_size = 0;
+    for (int b=0;b<Nbufs;b++){
+        const char* mem_stream = bufs[b];
+        struct reb_binary_field field;
+        do{
+            // The file might be truncated or corrupt. Never read past the end of the buffer.
+            if ((size_t)(ends[b]-mem_stream)<sizeof(struct reb_binary_field)){
+                free(buf_decompressed);
+                return -1;
+            }
+            memcpy(&field, mem_stream, sizeof(struct reb_binary_field));
+            mem_stream += sizeof(struct reb_binary_field);
+            if (field.type==REB_BINARY_FIELD_TYPE_HEADER){
+                field.size = 64 - sizeof(struct reb_binary_field); // The header has a fixed length
+            }
+            if (field.size>(uint64_t)(ends[b]-mem_stream)){
+                free(buf_decompressed);
+                return -1;
+            }
+            switch (field.type){
+                case REB_BINARY_FIELD_TYPE_N:
+                case REB_BINARY_FIELD_TYPE_NVAR:
+                    if (field.size<sizeof(int)){
+                        free(buf_decompressed);
+                        return -1;
+                    }
+                    memcpy(field.type==REB_BINARY_FIELD_TYPE_N ? &N : &N_var, mem_stream, sizeof(int));
+                    break;
+                case REB_BINARY_FIELD_TYPE_PARTICLES:
+                    particles = mem_stream;
+                    particles_size = field.size;
+                    break;
+            }
+            mem_stream += field.size;
+        }while(field.type!=REB_BINARY_FIELD_TYPE_END && mem_stream < ends[b]);
+    }
+    const long N_real = N - N_var;
+    if (N_real<0 || (uint64_t)N_real*sizeof(struct reb_particle)>particles_size){
+        free(buf_decompressed);
+        return -1;
+    }
+    for (long i=0;i<N_real;i++){
+        // Field data is not necessarily aligned
+        struct reb_particle p;
+        memcpy(&p, particles+i*sizeof(struct reb_particle), sizeof(struct reb_particle));
+        if (hash){
+            hash[i] = p.hash;
+        }
+        if (m){
+            m[i] = p.m;
+        }
+        if (radius){
+            radius[i] = p.r;
+        }
+        if (xyz){
+            xyz[i][0] = p.x;
+            xyz[i][1] = p.y;
+            xyz[i][2] = p.z;
+        }
+        if (vxvyvz){
+            vxvyvz[i][0] = p.vx;
+            vxvyvz[i][1] = p.vy;
+            vxvyvz[i][2] = p.vz;
+        }
+        if (xyzvxvyvz){
+            xyzvxvyvz[i][0] = p.x;
+            xyzvxvyvz[i][1] = p.y;
+            xyzvxvyvz[i][2] = p.z;
+            xyzvxvyvz[i][3] = p.vx;
+            xyzvxvyvz[i][4] = p.vy;
+            xyzvxvyvz[i][5] = p.vz;
+        }
+    }
+    free(buf_decompressed);
+    return N_real;
+}
+
+// Requested times that start from the same snapshot.
+struct reb_simulationarchive_group {
+    long snapshot;  // Snapshot from which the integration starts
+    long start;     // Index of the first requested time
+    long end;       // Index after the last requested time
+};
+
+// State shared by the worker threads of reb_simulationarchive_integrate_times.
+struct reb_simulationarchive_integrate_context {
+    struct reb_simulationarchive* sa;
+    const double* times;
+    int mode;
+    int keep_unsynchronized;
+    long N;
+    double* t;
+    double (*xyzvxvyvz)[6];
+    struct reb_simulationarchive_group* groups;
+    long Ngroups;
+    long next_group;        // Next group to be processed
+    int status;             // First error encountered (0 if none)
+    pthread_mutex_t mutex;  // Protects next_group, status, and the file
+};
+
+// Returns the index of the last snapshot with a time less than or equal to t.
+static long reb_simulationarchive_snapshot_index(struct reb_simulationarchive* sa, const double t){
+    long l = 0;
+    long r = sa->nblobs;
+    while (r-1>l){
+        const long m = l+(r-l)/2;
+        if (sa->t[m]>t){
+            r = m;
+        }else{
+            l = m;
+        }
+    }
+    return l;
+}
+
+static int reb_simulationarchive_integrate_group(struct reb_simulationarchive_integrate_context* ctx, struct reb_simulationarchive_group g){
+    enum reb_input_binary_messages warnings = REB_INPUT_BINARY_WARNING_NONE;
+    struct reb_simulation* r = reb_create_simulation();
+    // Reading the snapshot uses the shared file pointer.
+    pthread_mutex_lock(&ctx->mutex);
+    reb_create_simulation_from_simulationarchive_with_messages(r, ctx->sa, g.snapshot, &warnings);
+    pthread_mutex_unlock(&ctx->mutex);
+    if (warnings & (REB_INPUT_BINARY_ERROR_SEEK | REB_INPUT_BINARY_ERROR_INTEGRATOR)){
+        // The simulation has already been freed.
+        return -1;
+    }
+    if (warnings & REB_INPUT_BINARY_ERROR_CORRUPT){
+        reb_free_simulation(r);
+        return -1;
+    }
+    if (r->N-r->N_var != ctx->N){
+        reb_free_simulation(r);
+        return -2;
+    }
+    // In mode 1, the integration continues from one requested time to the next.
+    // Keeping the unsynchronized state makes this identical to integrating directly 
+    // from the snapshot. The particles are synchronized in either case.
+    int keep_unsynchronized = ctx->mode==1 ? 1 : ctx->keep_unsynchronized;
+    if (ctx->mode==2 
+            || (r->integrator==REB_INTEGRATOR_WHFAST && r->ri_whfast.safe_mode == 1) 
+            || (r->integrator==REB_INTEGRATOR_SABA && r->ri_saba.safe_mode == 1)){
+        keep_unsynchronized = 0;
+    }
+    r->ri_whfast.keep_unsynchronized = keep_unsynchronized;
+    r->ri_saba.keep_unsynchronized = keep_unsynchronized;
+    r->exact_finish_time = ctx->mode==2;
+    int status = 0;
+    for (long i=g.start;i<g.end;i++){
+        if (ctx->mode==0){
+            reb_integrator_synchronize(r);
+        }else{
+            // Continue from the previous requested time
+            status = reb_integrate(r, ctx->times[i]);
+            if (status!=REB_EXIT_SUCCESS){
+                break;
+            }
+        }
+        ctx->t[i] = r->t;
+        reb_serialize_particle_data(r, NULL, NULL, NULL, NULL, NULL, ctx->xyzvxvyvz+i*ctx->N);
+    }
+    reb_free_simulation(r);
+    return status;
+}
+
+static void* reb_simulationarchive_integrate_worker(void* args){
+    struct reb_simulationarchive_integrate_context* ctx = args;
+    while (1){
+        pthread_mutex_lock(&ctx->mutex);
+        if (ctx->status || ctx->next_group>=ctx->Ngroups){
+            pthread_mutex_unlock(&ctx->mutex);
+            break;
+        }
+        struct reb_simulationarchive_group g = ctx->groups[ctx->next_group++];
+        pthread_mutex_unlock(&ctx->mutex);
+
+        int status = reb_simulationarchive_integrate_group(ctx, g);
+
+        if (status){
+            pthread_mutex_lock(&ctx->mutex);
+            if (ctx->status==0){
+                ctx->status = status;
+            }
+            pthread_mutex_unlock(&ctx->mutex);
+        }
+    }
+    return NULL;
+}
+
+int reb_simulationarchive_integrate_times(struct reb_simulationarchive* sa, const double* times, long Ntimes, int mode, int keep_unsynchronized, int Nthreads, long N, double* t, double (*xyzvxvyvz)[6]){
+    if (sa==NULL || sa->inf==NULL || sa->nblobs<1 || mode<0 || mode>2) return -1;
+    for (long i=0;i<Ntimes;i++){
+        if (times[i]<sa->t[0] || times[i]>sa->t[sa->nblobs-1] || (i>0 && times[i]<times[i-1])){
+            return -1;
+        }
+    }
+    if (Ntimes<1) return 0;
+
+    // Group times by the snapshot they start from
+    struct reb_simulationarchive_group* groups = malloc(sizeof(struct reb_simulationarchive_group)*Ntimes);
+    long Ngroups = 0;
+    for (long i=0;i<Ntimes;i++){
+        const long snapshot = reb_simulationarchive_snapshot_index(sa, times[i]);
+        if (Ngroups==0 || groups[Ngroups-1].snapshot!=snapshot){
+            groups[Ngroups].snapshot = snapshot;
+            groups[Ngroups].start = i;
+            Ngroups++;
+        }
+        groups[Ngroups-1].end = i+1;
+    }
+
+    struct reb_simulationarchive_integrate_context ctx = {
+        .sa = sa,
+        .times = times,
+        .mode = mode,
+        .keep_unsynchronized = keep_unsynchronized,
+        .N = N,
+        .t = t,
+        .xyzvxvyvz = xyzvxvyvz,
+        .groups = groups,
+        .Ngroups = Ngroups,
+        .next_group = 0,
+        .status = 0,
+    };
+    pthread_mutex_init(&ctx.mutex, NULL);
+
+    if (Nthreads<1){
+        Nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (Nthreads>Ngroups){
+        Nthreads = Ngroups;
+    }
+    // The calling thread is one of the workers.
+    pthread_t* threads = malloc(sizeof(pthread_t)*Nthreads);
+    int Nstarted = 0;
+    for (int i=1;i<Nthreads;i++){
+        if (pthread_create(&threads[Nstarted], NULL, reb_simulationarchive_integrate_worker, &ctx)){
+            break; // Continue with fewer threads
+        }
+        Nstarted++;
+    }
+    reb_simulationarchive_integrate_worker(&ctx);
+    for (int i=0;i<Nstarted;i++){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&ctx.mutex);
+    free(groups);
+    return ctx.status;
+}
+
 static int reb_simulationarchive_snapshotsize(struct reb_simulation* const r){
     int size_snapshot = 0;
     switch (r->integrator){
@@ -454,16 +1013,307 @@ static inline void reb_save_dp7_old(struct reb_dp7* dp7, const int N3, FILE* of)
     fwrite(dp7->p6,sizeof(double),N3,of);
 }
 
+// Creates a compressed snapshot: a T field followed by the compressed binary.
+// The binary is delta encoded against the previous snapshot if it is available.
+static void reb_simulationarchive_compress_snapshot(struct reb_simulationarchive_writer* const w, const struct reb_simulationarchive_job* const job, char** bufp, size_t* sizep){
+    struct reb_simulationarchive_compressed header = {.size = job->size, .reference = 0};
+    const char* buf_ref = w->buf_first;
+    size_t size_ref = w->size_first;
+    if (w->buf_prev && w->delta_N<REB_SIMULATIONARCHIVE_KEYFRAME_INTERVAL-1){
+        header.reference = w->blob.index;
+        buf_ref = w->buf_prev;
+        size_ref = w->size_prev;
+        w->delta_N++;
+    }else{
+        w->delta_N = 0;
+    }
+    char* buf_compressed;
+    size_t size_compressed;
+    reb_compress_delta(buf_ref, size_ref, job->buf, job->size, &buf_compressed, &size_compressed);
+
+    struct reb_binary_field field_t = {.type = REB_BINARY_FIELD_TYPE_T, .size = sizeof(double)};
+    struct reb_binary_field field_c = {.type = REB_BINARY_FIELD_TYPE_SACOMPRESSED, .size = sizeof(struct reb_simulationarchive_compressed)+size_compressed};
+    *sizep = 2*sizeof(struct reb_binary_field) + sizeof(double) + field_c.size;
+    char* buf = malloc(*sizep);
+    char* p = buf;
+    memcpy(p, &field_t, sizeof(struct reb_binary_field));      p += sizeof(struct reb_binary_field);
+    memcpy(p, &job->t, sizeof(double));                        p += sizeof(double);
+    memcpy(p, &field_c, sizeof(struct reb_binary_field));      p += sizeof(struct reb_binary_field);
+    memcpy(p, &header, sizeof(struct reb_simulationarchive_compressed)); p += sizeof(struct reb_simulationarchive_compressed);
+    memcpy(p, buf_compressed, size_compressed);
+    free(buf_compressed);
+    *bufp = buf;
+}
+
+// Adds the snapshot at offset (which ends at w->size) to the index file.
+static void reb_simulationarchive_writer_append_index(struct reb_simulationarchive_writer* const w, const int index, const double t, const long offset){
+    if (w->of_index){
+        if (index){
+            struct reb_simulationarchive_index_entry entry = {.t = t, .offset = offset, .size = w->size-offset};
+            fwrite(&entry, sizeof(struct reb_simulationarchive_index_entry), 1, w->of_index);
+            fflush(w->of_index);
+        }else{
+            // Index is out of date from now on
+            fclose(w->of_index);
+            w->of_index = NULL;
+        }
+    }
+}
+
+// Appends a serialized simulation to the SimulationArchive, either as a diff against the 
+// initial binary or compressed. Takes ownership of job->buf.
+// Does not access the simulation and can therefore run on the background writer thread.
+static void reb_simulationarchive_write_snapshot(struct reb_simulationarchive_writer* const w, struct reb_simulationarchive_job* const job){
+    FILE* const of = w->of;
+
+    // Create buffer containing diff
+    char* buf_diff;
+    size_t size_diff;
+    if (job->compress){
+        reb_simulationarchive_compress_snapshot(w, job, &buf_diff, &size_diff);
+    }else{
+        // The buffer for the differences is reused between snapshots
+        while (reb_binary_diff_to_buffer(w->buf_first, w->size_first, job->buf, job->size, w->buf_diff, w->allocated_diff, &size_diff, 0)==-1){
+            w->allocated_diff = size_diff;
+            w->buf_diff = realloc(w->buf_diff, w->allocated_diff);
+        }
+        buf_diff = w->buf_diff;
+    }
+    
+    // Update blob info and Write diff to binary file
+    struct reb_simulationarchive_blob blob = w->blob;
+    blob.offset_next = size_diff+sizeof(struct reb_binary_field);
+    fseek(of, w->size-sizeof(struct reb_simulationarchive_blob), SEEK_SET);  
+    fwrite(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+    const long offset = w->size;
+    fwrite(buf_diff, size_diff, 1, of); 
+    struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_END, .size = 0};
+    fwrite(&field,sizeof(struct reb_binary_field), 1, of);
+    blob.index++;
+    blob.offset_prev = blob.offset_next;
+    blob.offset_next = 0;
+    fwrite(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+    fflush(of);
+    w->blob = blob;
+    w->size = offset + size_diff + sizeof(struct reb_binary_field) + sizeof(struct reb_simulationarchive_blob);
+    reb_simulationarchive_writer_append_index(w, job->index, job->t, offset);
+
+    // Keep the binary as a reference for the next compressed snapshot
+    free(w->buf_prev);
+    w->buf_prev = NULL;
+    if (job->compress){
+        w->buf_prev = job->buf;
+        w->size_prev = job->size;
+    }else{
+        free(job->buf);
+    }
+    job->buf = NULL;
+    if (job->compress){
+        free(buf_diff);
+    }
+}
+
+// Appends the fields that differ from the initial binary to the SimulationArchive.
+// The fields are compared and written while the simulation is serialized, so no
+// buffer for the complete binary or the diff is needed.
+static void reb_simulationarchive_write_snapshot_direct(struct reb_simulation* const r, struct reb_simulationarchive_writer* const w){
+    FILE* const of = w->of;
+    const long offset = w->size;
+    fseek(of, offset, SEEK_SET);
+    if (w->allocated_diff<REB_SIMULATIONARCHIVE_WRITE_BUFFER){
+        w->allocated_diff = REB_SIMULATIONARCHIVE_WRITE_BUFFER;
+        w->buf_diff = realloc(w->buf_diff, w->allocated_diff);
+    }
+    const size_t size_diff = reb_output_binary_diff_to_file(r, w->buf_first, w->size_first, of, w->buf_diff, w->allocated_diff);
+    struct reb_binary_field field = {.type = REB_BINARY_FIELD_TYPE_END, .size = 0};
+    fwrite(&field,sizeof(struct reb_binary_field), 1, of);
+    struct reb_simulationarchive_blob blob = w->blob;
+    blob.index++;
+    blob.offset_prev = size_diff+sizeof(struct reb_binary_field);
+    blob.offset_next = 0;
+    fwrite(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+    
+    // The size of the snapshot is only known now. Update the previous blob.
+    w->blob.offset_next = blob.offset_prev;
+    fseek(of, offset-sizeof(struct reb_simulationarchive_blob), SEEK_SET);  
+    fwrite(&w->blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+    fflush(of);
+    w->blob = blob;
+    w->size = offset + size_diff + sizeof(struct reb_binary_field) + sizeof(struct reb_simulationarchive_blob);
+    reb_simulationarchive_writer_append_index(w, r->simulationarchive_index, r->t, offset);
+
+    // The next compressed snapshot is encoded against the initial binary
+    free(w->buf_prev);
+    w->buf_prev = NULL;
+}
+
+// Background writer thread. A job stays in the queue until it has been written
+// so that a flush waits for the write to finish.
+static void* reb_simulationarchive_writer_thread(void* args){
+    struct reb_simulationarchive_writer* const w = (struct reb_simulationarchive_writer*)args;
+    pthread_mutex_lock(&w->mutex);
+    while(1){
+        while (w->queue_N==0 && w->quit==0){
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        if (w->queue_N==0){
+            break; // Quit, nothing left to write
+        }
+        struct reb_simulationarchive_job job = w->queue[w->queue_start];
+        pthread_mutex_unlock(&w->mutex);
+        reb_simulationarchive_write_snapshot(w, &job);
+        pthread_mutex_lock(&w->mutex);
+        w->queue_start = (w->queue_start+1)%REB_SIMULATIONARCHIVE_QUEUE_SIZE;
+        w->queue_N--;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->mutex);
+    return NULL;
+}
+
+void reb_simulationarchive_flush(struct reb_simulation* const r){
+    struct reb_simulationarchive_writer* const w = r->simulationarchive_writer;
+    if (w==NULL || w->async==0) return;
+    pthread_mutex_lock(&w->mutex);
+    while (w->queue_N>0){
+        pthread_cond_wait(&w->cond, &w->mutex);
+    }
+    pthread_mutex_unlock(&w->mutex);
+}
+
+void reb_simulationarchive_free_writer(struct reb_simulation* const r){
+    struct reb_simulationarchive_writer* const w = r->simulationarchive_writer;
+    if (w==NULL) return;
+    if (w->async){
+        // Writes all pending snapshots before the thread exits
+        pthread_mutex_lock(&w->mutex);
+        w->quit = 1;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+        pthread_join(w->thread, NULL);
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->mutex);
+    }
+    if (w->of){
+        fclose(w->of);
+    }
+    if (w->of_index){
+        fclose(w->of_index);
+    }
+    free(w->filename);
+    free(w->buf_first);
+    free(w->buf_prev);
+    free(w->buf_diff);
+    free(w);
+    r->simulationarchive_writer = NULL;
+}
+
+// Returns the cached writer for filename. The cache is (re-)created if it does not 
+// exist, belongs to a different file, or if the file has been modified by someone else.
+static struct reb_simulationarchive_writer* reb_simulationarchive_get_writer(struct reb_simulation* const r, const char* filename, const struct stat* const buffer){
+    struct reb_simulationarchive_writer* w = r->simulationarchive_writer;
+    if (w && w->async==r->simulationarchive_async && strcmp(w->filename, filename)==0 && w->dev==buffer->st_dev && w->ino==buffer->st_ino){
+        if (w->async){
+            pthread_mutex_lock(&w->mutex);
+            const int pending = w->queue_N;
+            pthread_mutex_unlock(&w->mutex);
+            if (pending){
+                // File size can only be checked once all pending snapshots are written.
+                return w;
+            }
+            // The last write might have finished after stat() was called.
+            struct stat buffer_now;
+            if (stat(filename, &buffer_now)==0 && w->size==buffer_now.st_size){
+                return w;
+            }
+        }else if (w->size==buffer->st_size){
+            return w;
+        }
+    }
+    reb_simulationarchive_free_writer(r);
+    FILE* of = fopen(filename,"r+b");
+    if (of==NULL){
+        reb_error(r, "Can not open file.");
+        return NULL;
+    }
+    w = calloc(1, sizeof(struct reb_simulationarchive_writer));
+    w->of = of;
+    w->filename = malloc(strlen(filename)+1);
+    strcpy(w->filename, filename);
+    w->dev = buffer->st_dev;
+    w->ino = buffer->st_ino;
+
+    // Create buffer containing original binary file
+    fseek(of, 64, SEEK_SET); // Header
+    struct reb_binary_field field;
+    int bytesread;
+    do{
+        bytesread = fread(&field,sizeof(struct reb_binary_field),1,of);
+        fseek(of, field.size, SEEK_CUR);
+    }while(field.type!=REB_BINARY_FIELD_TYPE_END && bytesread);
+    w->size_first = ftell(of);
+    w->buf_first = malloc(w->size_first);
+    fseek(of, 0, SEEK_SET);  
+    fread(w->buf_first, w->size_first,1,of);
+
+    // Blob at the end of the file
+    fseek(of, -sizeof(struct reb_simulationarchive_blob), SEEK_END);  
+    fread(&w->blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+    w->size = ftell(of);
+
+    // The index file is only extended if it is up to date
+    if (r->simulationarchive_index){
+        char* filename_index = reb_simulationarchive_index_filename(filename);
+        w->of_index = fopen(filename_index, "r+b");
+        free(filename_index);
+        if (w->of_index){
+            fseek(w->of_index, 0, SEEK_END);
+            if (ftell(w->of_index)!=(w->blob.index+1)*(long)sizeof(struct reb_simulationarchive_index_entry)){
+                fclose(w->of_index);
+                w->of_index = NULL;
+            }
+        }
+    }
+
+    if (r->simulationarchive_async){
+        pthread_mutex_init(&w->mutex, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        if (pthread_create(&w->thread, NULL, reb_simulationarchive_writer_thread, w)==0){
+            w->async = 1;
+        }else{
+            pthread_cond_destroy(&w->cond);
+            pthread_mutex_destroy(&w->mutex);
+            reb_warning(r, "Cannot create SimulationArchive writer thread. Writing snapshots synchronously.");
+        }
+    }
+    r->simulationarchive_writer = w;
+    return w;
+}
+
 void reb_simulationarchive_snapshot(struct reb_simulation* const r, const char* filename){
     if (filename==NULL) filename = r->simulationarchive_filename;
     struct stat buffer;
     if (stat(filename, &buffer) < 0){
+        // The cache belongs to a file that no longer exists.
+        reb_simulationarchive_free_writer(r);
         // File does not exist. Output binary.
         if (r->simulationarchive_version<2){
             // Old version
             r->simulationarchive_size_snapshot = reb_simulationarchive_snapshotsize(r);
         }
         reb_output_binary(r,filename);
+        if (r->simulationarchive_version>=2){
+            char* filename_index = reb_simulationarchive_index_filename(filename);
+            if (r->simulationarchive_index){
+                if (stat(filename, &buffer) == 0){
+                    reb_simulationarchive_append_index(r, filename, 0, 0, buffer.st_size);
+                }
+            }else{
+                // Remove outdated index file from a previous SA with the same name
+                remove(filename_index);
+            }
+            free(filename_index);
+        }
     }else{
         // File exists, append snapshot.
         if (r->simulationarchive_version<2){
@@ -544,51 +1394,38 @@ void reb_simulationarchive_snapshot(struct reb_simulation* const r, const char*
             fclose(of);
         }else{
             // New version with incremental outputs
+            // The file stays open and the initial binary is cached between snapshots.
+            struct reb_simulationarchive_writer* const w = reb_simulationarchive_get_writer(r, filename, &buffer);
+            if (w==NULL) return;
 
-            // Create buffer containing original binary file
-            FILE* of = fopen(filename,"r+b");
-            fseek(of, 64, SEEK_SET); // Header
-            struct reb_binary_field field;
-            int bytesread;
-            do{
-                bytesread = fread(&field,sizeof(struct reb_binary_field),1,of);
-                fseek(of, field.size, SEEK_CUR);
-            }while(field.type!=REB_BINARY_FIELD_TYPE_END && bytesread);
-            long size_old = ftell(of);
-            char* buf_old = malloc(size_old);
-            fseek(of, 0, SEEK_SET);  
-            fread(buf_old, size_old,1,of);
-
-            // Create buffer containing current binary file
-            char* buf_new;
-            size_t size_new;
-            reb_output_binary_to_stream(r, &buf_new, &size_new);
-            
-            // Create buffer containing diff
-            char* buf_diff;
-            size_t size_diff;
-            reb_binary_diff(buf_old, size_old, buf_new, size_new, &buf_diff, &size_diff);
-            
-            // Update blob info and Write diff to binary file
-            struct reb_simulationarchive_blob blob = {0};
-            fseek(of, -sizeof(struct reb_simulationarchive_blob), SEEK_END);  
-            fread(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
-            blob.offset_next = size_diff+sizeof(struct reb_binary_field);
-            fseek(of, -sizeof(struct reb_simulationarchive_blob), SEEK_END);  
-            fwrite(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
-            fwrite(buf_diff, size_diff, 1, of); 
-            field.type = REB_BINARY_FIELD_TYPE_END;
-            field.size = 0;
-            fwrite(&field,sizeof(struct reb_binary_field), 1, of);
-            blob.index++;
-            blob.offset_prev = blob.offset_next;
-            blob.offset_next = 0;
-            fwrite(&blob, sizeof(struct reb_simulationarchive_blob), 1, of);
+            if (w->async==0 && r->simulationarchive_compress==0){
+                // Only the fields that changed since the initial binary (typically the time,
+                // the particles and the integrator state) are written, directly from the simulation.
+                reb_integrator_init(r);
+                reb_simulationarchive_write_snapshot_direct(r, w);
+                return;
+            }
 
-            fclose(of);
-            free(buf_new);
-            free(buf_old);
-            free(buf_diff);
+            // Serialize the simulation. This is what makes a restart bit-wise exact, 
+            // so it always happens right away, even if the write is done asynchronously.
+            // The full binary is needed here: the background thread works on a copy, and
+            // compressed snapshots are delta encoded against the previous binary.
+            struct reb_simulationarchive_job job = {.t = r->t, .index = r->simulationarchive_index, .compress = r->simulationarchive_compress};
+            reb_output_binary_to_stream(r, &job.buf, &job.size);
+
+            if (w->async){
+                // Hand the snapshot to the background thread. Wait if the queue is full.
+                pthread_mutex_lock(&w->mutex);
+                while (w->queue_N==REB_SIMULATIONARCHIVE_QUEUE_SIZE){
+                    pthread_cond_wait(&w->cond, &w->mutex);
+                }
+                w->queue[(w->queue_start+w->queue_N)%REB_SIMULATIONARCHIVE_QUEUE_SIZE] = job;
+                w->queue_N++;
+                pthread_cond_broadcast(&w->cond);
+                pthread_mutex_unlock(&w->mutex);
+            }else{
+                reb_simulationarchive_write_snapshot(w, &job);
+            }
         }
     }
 }
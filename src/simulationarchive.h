@@ -31,6 +31,7 @@ struct reb_simulation;
 struct reb_particles;
 
 void reb_simulationarchive_heartbeat(struct reb_simulation* const r);  ///< Internal function to handle outputs for the Simulation Archive.
+void reb_simulationarchive_free_writer(struct reb_simulation* const r);  ///< Internal function to close the file and free the cache used for appending snapshots.
 void reb_read_simulationarchive_with_messages(struct reb_simulationarchive* sa, const char* filename, enum reb_input_binary_messages* warnings); ///< Internal function to read one snapshot from a simulation archive.
 
 
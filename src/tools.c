@@ -33,6 +33,8 @@
 #include "particle.h"
 #include "rebound.h"
 #include "tools.h"
+#include "gravity.h"
+#include "tree.h"
 
 
 void reb_tools_init_srand(void){
@@ -1028,6 +1030,259 @@ void reb_tools_megno_update(struct reb_simulation* r, double dY){
 					*(r->t-r->megno_mean_t);
 }
 
+/**
+ * Columns of the tangent map: the k-th Lyapunov vector consists of the
+ * positions and velocities of the k-th variational configuration.
+ */
+static inline double* reb_tools_lyapunov_vector(struct reb_particle* const p){
+    return &(p->x);
+}
+
+/**
+ * One pass of Cholesky QR. Returns 0 if the Gram matrix is not numerically
+ * positive definite. Otherwise the vectors are replaced by Q and log(R_kk)
+ * is added to logR.
+ */
+static int reb_tools_lyapunov_spectrum_cholesky_qr(struct reb_simulation* const r, double* const G, double* const w, double* const logR){
+    const int K = r->lyapunov_spectrum_N;
+    const int N_real = r->N - r->N_var;
+    struct reb_particle* const particles = r->particles;
+    const struct reb_variational_configuration* const vc = r->var_config + r->lyapunov_spectrum_var_config;
+    // Gram matrix G = V^T V (upper triangle). The loop over particles is
+    // outermost so that every particle of every vector is loaded only once.
+    for (int a=0;a<K*K;a++){
+        G[a] = 0.;
+    }
+    for (int i=0;i<N_real;i++){
+        for (int a=0;a<K;a++){
+            const double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+            for (int l=0;l<6;l++){
+                w[6*a+l] = v[l]; // x, y, z, vx, vy, vz
+            }
+        }
+        for (int a=0;a<K;a++){
+            for (int b=a;b<K;b++){
+                double sum = 0.;
+                for (int l=0;l<6;l++){
+                    sum += w[6*a+l]*w[6*b+l];
+                }
+                G[a*K+b] += sum;
+            }
+        }
+    }
+    // Cholesky decomposition G = R^T R, stored in the upper triangle of G.
+    for (int a=0;a<K;a++){
+        double d = G[a*K+a];
+        for (int c=0;c<a;c++){
+            d -= G[c*K+a]*G[c*K+a];
+        }
+        if (!(d>1e-14*G[a*K+a]) || !(d>0.)){
+            return 0;
+        }
+        d = sqrt(d);
+        G[a*K+a] = d;
+        for (int b=a+1;b<K;b++){
+            double sum = G[a*K+b];
+            for (int c=0;c<a;c++){
+                sum -= G[c*K+a]*G[c*K+b];
+            }
+            G[a*K+b] = sum/d;
+        }
+    }
+    // Q = V R^{-1} by forward substitution, one block of six rows at a time.
+    for (int i=0;i<N_real;i++){
+        for (int a=0;a<K;a++){
+            const double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+            for (int l=0;l<6;l++){
+                double q = v[l];
+                for (int c=0;c<a;c++){
+                    q -= G[c*K+a]*w[6*c+l];
+                }
+                w[6*a+l] = q/G[a*K+a];
+            }
+        }
+        for (int a=0;a<K;a++){
+            double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+            for (int l=0;l<6;l++){
+                v[l] = w[6*a+l];
+            }
+        }
+    }
+    for (int a=0;a<K;a++){
+        logR[a] += log(G[a*K+a]);
+    }
+    return 1;
+}
+
+/**
+ * Modified Gram-Schmidt. Slower than Cholesky QR but stable for 
+ * ill-conditioned sets of vectors.
+ */
+static void reb_tools_lyapunov_spectrum_mgs(struct reb_simulation* const r, double* const logR){
+    const int K = r->lyapunov_spectrum_N;
+    const int N_real = r->N - r->N_var;
+    struct reb_particle* const particles = r->particles;
+    const struct reb_variational_configuration* const vc = r->var_config + r->lyapunov_spectrum_var_config;
+    for (int a=0;a<K;a++){
+        double norm2 = 0.;
+        for (int i=0;i<N_real;i++){
+            const double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+            for (int l=0;l<6;l++){
+                norm2 += v[l]*v[l];
+            }
+        }
+        const double norm = sqrt(norm2);
+        logR[a] += log(norm);
+        for (int i=0;i<N_real;i++){
+            double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+            for (int l=0;l<6;l++){
+                v[l] /= norm;
+            }
+        }
+        for (int b=a+1;b<K;b++){
+            double dot = 0.;
+            for (int i=0;i<N_real;i++){
+                const double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+                const double* const u = reb_tools_lyapunov_vector(&particles[vc[b].index+i]);
+                for (int l=0;l<6;l++){
+                    dot += v[l]*u[l];
+                }
+            }
+            for (int i=0;i<N_real;i++){
+                const double* const v = reb_tools_lyapunov_vector(&particles[vc[a].index+i]);
+                double* const u = reb_tools_lyapunov_vector(&particles[vc[b].index+i]);
+                for (int l=0;l<6;l++){
+                    u[l] -= dot*v[l];
+                }
+            }
+        }
+    }
+}
+
+void reb_tools_lyapunov_spectrum_orthonormalize(struct reb_simulation* const r){
+    const int K = r->lyapunov_spectrum_N;
+    double* const G = malloc(sizeof(double)*K*K);
+    double* const w = malloc(sizeof(double)*6*K);
+    double* const logR = calloc(K,sizeof(double));
+    // Cholesky QR is applied twice (CholeskyQR2) which makes Q orthonormal to
+    // machine precision as long as the vectors are not too close to being 
+    // linearly dependent. Otherwise fall back to modified Gram-Schmidt.
+    if (!reb_tools_lyapunov_spectrum_cholesky_qr(r, G, w, logR) 
+            || !reb_tools_lyapunov_spectrum_cholesky_qr(r, G, w, logR)){
+        reb_tools_lyapunov_spectrum_mgs(r, logR);
+    }
+    for (int a=0;a<K;a++){
+        r->lyapunov_spectrum_sums[a] += logR[a];
+    }
+    r->lyapunov_spectrum_t_last = r->t;
+    free(G);
+    free(w);
+    free(logR);
+}
+
+void reb_tools_lyapunov_spectrum_init_seed(struct reb_simulation* const r, int N_exponents, double interval, unsigned int seed){
+    srand(seed);
+    reb_tools_lyapunov_spectrum_init(r, N_exponents, interval);
+}
+
+void reb_tools_lyapunov_spectrum_init(struct reb_simulation* const r, int N_exponents, double interval){
+    const int N_real = r->N - r->N_var;
+    if (r->lyapunov_spectrum_N){
+        reb_error(r, "The Lyapunov spectrum has already been initialized.");
+        return;
+    }
+    if (N_exponents<1 || N_exponents>6*N_real){
+        reb_error(r, "The number of Lyapunov exponents must be between 1 and six times the number of particles.");
+        return;
+    }
+    r->lyapunov_spectrum_var_config = r->var_config_N;
+    for (int a=0;a<N_exponents;a++){
+        const int index = reb_add_var_1st_order(r,-1);
+        struct reb_particle* const particles = r->particles;
+        for (int i=index;i<index+N_real;i++){ 
+            particles[i].m  = 0.;
+            particles[i].x  = reb_random_normal(1.);
+            particles[i].y  = reb_random_normal(1.);
+            particles[i].z  = reb_random_normal(1.);
+            particles[i].vx = reb_random_normal(1.);
+            particles[i].vy = reb_random_normal(1.);
+            particles[i].vz = reb_random_normal(1.);
+        }
+    }
+    r->lyapunov_spectrum_N = N_exponents;
+    r->lyapunov_spectrum_interval = interval;
+    free(r->lyapunov_spectrum_sums);
+    r->lyapunov_spectrum_sums = calloc(N_exponents,sizeof(double));
+    reb_tools_lyapunov_spectrum_orthonormalize(r);
+    for (int a=0;a<N_exponents;a++){
+        r->lyapunov_spectrum_sums[a] = 0.;
+    }
+    r->lyapunov_spectrum_t0 = r->t;
+}
+
+void reb_tools_calculate_lyapunov_spectrum(struct reb_simulation* const r, double* lyapunov){
+    const double dt = r->lyapunov_spectrum_t_last - r->lyapunov_spectrum_t0;
+    for (int a=0;a<r->lyapunov_spectrum_N;a++){
+        lyapunov[a] = dt!=0. ? r->lyapunov_spectrum_sums[a]/dt : 0.;
+    }
+}
+
+struct reb_mixed_precision_report reb_tools_mixed_precision_report(struct reb_simulation* const r){
+    struct reb_mixed_precision_report report = {.max_error = 0., .rms_error = 0., .max_error_index = -1, .N = 0};
+    const int N = r->N;
+    const int N_real = N - r->N_var;
+    struct reb_particle* const particles = r->particles;
+    if (r->gravity==REB_GRAVITY_TREE){
+        if (r->tree_root==NULL){
+            // Building the tree might remove particles
+            return report;
+        }
+        reb_tree_update_gravity_data(r);
+    }
+    struct reb_vec3d* a_saved = malloc(sizeof(struct reb_vec3d)*N);
+    struct reb_vec3d* a_mixed = malloc(sizeof(struct reb_vec3d)*N);
+    for (int i=0;i<N;i++){
+        a_saved[i] = (struct reb_vec3d){.x=particles[i].ax, .y=particles[i].ay, .z=particles[i].az};
+    }
+    const unsigned int mixed_precision = r->gravity_mixed_precision;
+    r->gravity_mixed_precision = 1;
+    reb_calculate_acceleration(r);
+    for (int i=0;i<N;i++){
+        a_mixed[i] = (struct reb_vec3d){.x=particles[i].ax, .y=particles[i].ay, .z=particles[i].az};
+    }
+    r->gravity_mixed_precision = 0;
+    reb_calculate_acceleration(r);
+    double sum2 = 0.;
+    for (int i=0;i<N_real;i++){
+        const double a2 = particles[i].ax*particles[i].ax + particles[i].ay*particles[i].ay + particles[i].az*particles[i].az;
+        if (a2==0.){
+            continue;
+        }
+        const double dax = a_mixed[i].x - particles[i].ax;
+        const double day = a_mixed[i].y - particles[i].ay;
+        const double daz = a_mixed[i].z - particles[i].az;
+        const double error = sqrt((dax*dax + day*day + daz*daz)/a2);
+        if (error>report.max_error || report.max_error_index==-1){
+            report.max_error = error;
+            report.max_error_index = i;
+        }
+        sum2 += error*error;
+        report.N++;
+    }
+    if (report.N){
+        report.rms_error = sqrt(sum2/report.N);
+    }
+    r->gravity_mixed_precision = mixed_precision;
+    for (int i=0;i<N;i++){
+        particles[i].ax = a_saved[i].x;
+        particles[i].ay = a_saved[i].y;
+        particles[i].az = a_saved[i].z;
+    }
+    free(a_saved);
+    free(a_mixed);
+    return report;
+}
+
 #define ROT32(x, y) ((x << y) | (x >> (32 - y))) // avoid effort
 static uint32_t reb_murmur3_32(const char *key, uint32_t len, uint32_t seed) {
     // Source: Wikipedia
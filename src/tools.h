@@ -44,6 +44,12 @@ double reb_tools_megno_deltad_delta(struct reb_simulation* const r);
  */
 void reb_tools_megno_update(struct reb_simulation* r, double dY);
 
+/**
+ * @brief Reorthonormalize the variational vectors used for the Lyapunov spectrum and update the running sums.
+ * @param r REBOUND simulation to be considered.
+ */
+void reb_tools_lyapunov_spectrum_orthonormalize(struct reb_simulation* const r);
+
 /**
  * @brief Init random number generator based on time and process id.
  */
@@ -0,0 +1,328 @@
+/**
+ * @file 	trajectory.c
+ * @brief 	Columnar trajectory files for post-processing.
+ * @details Trajectory files store the positions, velocities and/or orbital
+ * elements of all particles in chunks. Within a chunk, the time series of
+ * one quantity of one particle is stored contiguously. Time series can
+ * therefore be read without reading (or reconstructing) full snapshots.
+ * @author 	Hanno Rein <hanno@hanno-rein.de>
+ *
+ * @section 	LICENSE
+ * Copyright (c) 2018 Hanno Rein
+ *
+ * This file is part of rebound.
+ *
+ * rebound is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * rebound is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with rebound.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "rebound.h"
+#include "tools.h"
+#include "trajectory.h"
+
+#define REB_TRAJECTORY_CHUNK_BYTES (4*1024*1024)  // Target size of one chunk
+
+static const char* reb_trajectory_header = "REBOUND Trajectory File. Version: ";
+
+// Number of columns stored for a given bitmask of fields.
+static int reb_trajectory_columns(const int fields){
+    int columns = 0;
+    if (fields & REB_TRAJECTORY_POSITIONS) columns += 3;
+    if (fields & REB_TRAJECTORY_VELOCITIES) columns += 3;
+    if (fields & REB_TRAJECTORY_ORBITS) columns += 6;
+    return columns;
+}
+
+// Position of a column within a chunk. Returns -1 if the column is not stored.
+static int reb_trajectory_column_index(const int fields, const int column){
+    const int group_fields[3] = {REB_TRAJECTORY_POSITIONS, REB_TRAJECTORY_VELOCITIES, REB_TRAJECTORY_ORBITS};
+    const int group_start[3] = {REB_TRAJECTORY_X, REB_TRAJECTORY_VX, REB_TRAJECTORY_A};
+    const int group_size[3] = {3, 3, 6};
+    int index = 0;
+    for (int g=0;g<3;g++){
+        if (column>=group_start[g] && column<group_start[g]+group_size[g]){
+            return (fields & group_fields[g]) ? index+column-group_start[g] : -1;
+        }
+        if (fields & group_fields[g]){
+            index += group_size[g];
+        }
+    }
+    return -1;
+}
+
+// Size of the hash array of a chunk, padded to a multiple of 8 bytes.
+static uint64_t reb_trajectory_size_hash(const uint64_t N){
+    return (N*sizeof(uint32_t)+7)/8*8;
+}
+
+// Appends the buffered snapshots as a new chunk. Returns -1 if the file cannot be opened.
+static int reb_trajectory_write_chunk(struct reb_trajectory_writer* const w){
+    FILE* of = fopen(w->filename, "ab");
+    if (of==NULL){
+        return -1;
+    }
+    fseek(of, 0, SEEK_END);
+    if (ftell(of)==0){
+        char header[64] = {0};
+        snprintf(header, 64, "%s%s", reb_trajectory_header, reb_version_str);
+        fwrite(header, 64, 1, of);
+    }
+    const long n = w->n;
+    const long N = w->N;
+    struct reb_trajectory_chunk chunk = {
+        .n = n,
+        .N = N,
+        .fields = w->fields,
+        .t_first = w->t[0],
+        .t_last = w->t[n-1],
+    };
+    fwrite(&chunk, sizeof(struct reb_trajectory_chunk), 1, of);
+    fwrite(w->t, sizeof(double), n, of);
+    const uint64_t size_hash = reb_trajectory_size_hash(N);
+    const char padding[8] = {0};
+    fwrite(w->hash, sizeof(uint32_t), N, of);
+    fwrite(padding, size_hash-N*sizeof(uint32_t), 1, of);
+    const long columns = reb_trajectory_columns(w->fields);
+    if (n==w->n_max){
+        fwrite(w->data, sizeof(double), columns*N*n, of);
+    }else{
+        for (long i=0;i<columns*N;i++){
+            fwrite(w->data+i*w->n_max, sizeof(double), n, of);
+        }
+    }
+    fclose(of);
+    w->n = 0;
+    return 0;
+}
+
+void reb_trajectory_free_writer(struct reb_simulation* const r){
+    struct reb_trajectory_writer* const w = r->trajectory_writer;
+    if (w==NULL) return;
+    if (w->n>0 && reb_trajectory_write_chunk(w)){
+        reb_error(r, "Can not open file.");
+    }
+    free(w->filename);
+    free(w->t);
+    free(w->hash);
+    free(w->data);
+    free(w);
+    r->trajectory_writer = NULL;
+}
+
+void reb_output_trajectory_flush(struct reb_simulation* r){
+    reb_trajectory_free_writer(r);
+}
+
+void reb_output_trajectory(struct reb_simulation* r, const char* filename, int fields){
+    fields &= REB_TRAJECTORY_POSITIONS | REB_TRAJECTORY_VELOCITIES | REB_TRAJECTORY_ORBITS;
+    if (fields==0){
+        reb_error(r, "No fields selected for trajectory output.");
+        return;
+    }
+    const long N = r->N - r->N_var;
+    struct reb_trajectory_writer* w = r->trajectory_writer;
+    if (w){
+        // A new chunk is needed if anything but the time series changed
+        int changed = strcmp(w->filename, filename)!=0 || w->fields!=fields || w->N!=N;
+        for (long i=0;i<N && !changed;i++){
+            changed = w->hash[i]!=r->particles[i].hash;
+        }
+        if (changed){
+            reb_trajectory_free_writer(r);
+            w = NULL;
+        }
+    }
+    const long columns = reb_trajectory_columns(fields);
+    if (w==NULL){
+        w = calloc(1, sizeof(struct reb_trajectory_writer));
+        w->filename = malloc(strlen(filename)+1);
+        strcpy(w->filename, filename);
+        w->fields = fields;
+        w->N = N;
+        w->n_max = REB_TRAJECTORY_CHUNK_BYTES/(sizeof(double)*(1+columns*N));
+        if (w->n_max<1){
+            w->n_max = 1;
+        }
+        w->t = malloc(sizeof(double)*w->n_max);
+        w->hash = malloc(sizeof(uint32_t)*N);
+        w->data = malloc(sizeof(double)*columns*N*w->n_max);
+        for (long i=0;i<N;i++){
+            w->hash[i] = r->particles[i].hash;
+        }
+        r->trajectory_writer = w;
+    }
+
+    const long n = w->n;
+    const long n_max = w->n_max;
+    w->t[n] = r->t;
+    double* data = w->data;
+    if (fields & REB_TRAJECTORY_POSITIONS){
+        for (long i=0;i<N;i++){
+            data[(0*N+i)*n_max+n] = r->particles[i].x;
+            data[(1*N+i)*n_max+n] = r->particles[i].y;
+            data[(2*N+i)*n_max+n] = r->particles[i].z;
+        }
+        data += 3*N*n_max;
+    }
+    if (fields & REB_TRAJECTORY_VELOCITIES){
+        for (long i=0;i<N;i++){
+            data[(0*N+i)*n_max+n] = r->particles[i].vx;
+            data[(1*N+i)*n_max+n] = r->particles[i].vy;
+            data[(2*N+i)*n_max+n] = r->particles[i].vz;
+        }
+        data += 3*N*n_max;
+    }
+    if (fields & REB_TRAJECTORY_ORBITS){
+        // Jacobi coordinates, same as reb_output_orbits()
+        if (N>0){
+            for (int c=0;c<6;c++){
+                data[(c*N+0)*n_max+n] = NAN;
+            }
+            struct reb_particle com = r->particles[0];
+            for (long i=1;i<N;i++){
+                struct reb_orbit o = reb_tools_particle_to_orbit(r->G, r->particles[i], com);
+                data[(0*N+i)*n_max+n] = o.a;
+                data[(1*N+i)*n_max+n] = o.e;
+                data[(2*N+i)*n_max+n] = o.inc;
+                data[(3*N+i)*n_max+n] = o.Omega;
+                data[(4*N+i)*n_max+n] = o.omega;
+                data[(5*N+i)*n_max+n] = o.l;
+                com = reb_get_com_of_pair(com, r->particles[i]);
+            }
+        }
+    }
+    w->n++;
+    if (w->n==w->n_max && reb_trajectory_write_chunk(w)){
+        reb_error(r, "Can not open file.");
+        w->n = 0;
+    }
+}
+
+int reb_read_trajectory(struct reb_trajectory* tr, const char* filename){
+    memset(tr, 0, sizeof(struct reb_trajectory));
+    FILE* inf = fopen(filename, "rb");
+    if (inf==NULL){
+        return -1;
+    }
+    char header[64];
+    if (fread(header, 64, 1, inf)!=1 || strncmp(header, reb_trajectory_header, strlen(reb_trajectory_header))!=0){
+        fclose(inf);
+        return -1;
+    }
+    fseek(inf, 0, SEEK_END);
+    const uint64_t size = ftell(inf);
+    uint64_t offset = 64;
+    long allocated = 0;
+    // Build the chunk index. An incomplete chunk at the end of the file is ignored.
+    while (offset+sizeof(struct reb_trajectory_chunk)<=size){
+        struct reb_trajectory_chunk chunk;
+        fseek(inf, offset, SEEK_SET);
+        if (fread(&chunk, sizeof(struct reb_trajectory_chunk), 1, inf)!=1){
+            break;
+        }
+        offset += sizeof(struct reb_trajectory_chunk);
+        const uint64_t size_chunk = sizeof(double)*chunk.n + reb_trajectory_size_hash(chunk.N) + sizeof(double)*reb_trajectory_columns(chunk.fields)*chunk.N*chunk.n;
+        if (chunk.n==0 || size_chunk>size-offset){
+            break;
+        }
+        if (tr->nchunks>=allocated){
+            allocated = allocated ? 2*allocated : 16;
+            tr->chunks = realloc(tr->chunks, sizeof(struct reb_trajectory_chunk)*allocated);
+            tr->offset = realloc(tr->offset, sizeof(uint64_t)*allocated);
+        }
+        tr->chunks[tr->nchunks] = chunk;
+        tr->offset[tr->nchunks] = offset;
+        tr->nchunks++;
+        offset += size_chunk;
+    }
+    tr->inf = inf;
+    tr->filename = malloc(strlen(filename)+1);
+    strcpy(tr->filename, filename);
+    return 0;
+}
+
+struct reb_trajectory* reb_open_trajectory(const char* filename){
+    struct reb_trajectory* tr = malloc(sizeof(struct reb_trajectory));
+    if (reb_read_trajectory(tr, filename)){
+        free(tr);
+        return NULL;
+    }
+    return tr;
+}
+
+void reb_free_trajectory_pointers(struct reb_trajectory* tr){
+    if (tr==NULL) return;
+    if (tr->inf){
+        fclose(tr->inf);
+    }
+    free(tr->filename);
+    free(tr->chunks);
+    free(tr->offset);
+}
+
+void reb_close_trajectory(struct reb_trajectory* tr){
+    reb_free_trajectory_pointers(tr);
+    free(tr);
+}
+
+long reb_trajectory_read(struct reb_trajectory* tr, int column, long particle, double tmin, double tmax, double* t, double* values){
+    if (tr==NULL || tr->inf==NULL) return -1;
+    long count = 0;
+    for (long k=0;k<tr->nchunks;k++){
+        const struct reb_trajectory_chunk chunk = tr->chunks[k];
+        const int index = reb_trajectory_column_index(chunk.fields, column);
+        if (index<0 || particle<0 || (uint64_t)particle>=chunk.N){
+            continue;
+        }
+        // Times are monotonic within a chunk (increasing or decreasing)
+        const double t_lo = chunk.t_first<chunk.t_last ? chunk.t_first : chunk.t_last;
+        const double t_hi = chunk.t_first<chunk.t_last ? chunk.t_last : chunk.t_first;
+        if (t_hi<tmin || t_lo>tmax){
+            continue;
+        }
+        double* t_chunk = malloc(sizeof(double)*chunk.n);
+        double* values_chunk = NULL;
+        fseek(tr->inf, tr->offset[k], SEEK_SET);
+        int error = fread(t_chunk, sizeof(double), chunk.n, tr->inf)!=chunk.n;
+        if (values && !error){
+            values_chunk = malloc(sizeof(double)*chunk.n);
+            const uint64_t offset = tr->offset[k] + sizeof(double)*chunk.n + reb_trajectory_size_hash(chunk.N) + sizeof(double)*chunk.n*(index*chunk.N+particle);
+            fseek(tr->inf, offset, SEEK_SET);
+            error = fread(values_chunk, sizeof(double), chunk.n, tr->inf)!=chunk.n;
+        }
+        if (!error){
+            for (uint64_t j=0;j<chunk.n;j++){
+                if (t_chunk[j]>=tmin && t_chunk[j]<=tmax){
+                    if (t){
+                        t[count] = t_chunk[j];
+                    }
+                    if (values){
+                        values[count] = values_chunk[j];
+                    }
+                    count++;
+                }
+            }
+        }
+        free(t_chunk);
+        free(values_chunk);
+        if (error){
+            return -1;
+        }
+    }
+    return count;
+}
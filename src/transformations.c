@@ -25,13 +25,165 @@
  *
  */
 
+#include <stdlib.h>
 #include "transformations.h"
 #include "rebound.h"
+#ifdef OPENMP
+#include <omp.h>
+
+int reb_omp_deterministic = 0;
+
+// Below this number of particles the Jacobi transformations are always calculated serially.
+static const unsigned int reb_transformations_omp_N_min = 4096;
+
+/**
+ * Parallel versions of the Jacobi transformations. The serial versions are recurrences
+ * over the particles. In exact arithmetic they are equivalent to prefix sums of the 
+ * masses and of the mass weighted coordinates, which are calculated here with a blocked 
+ * parallel scan. The components c0<=c<c1 of a particle are addressed as (&p.x)[c], i.e. 
+ * 0-2 are positions, 3-5 velocities and 6-8 accelerations.
+ * The results agree with the serial version to round-off, but depend on the number of threads.
+ */
+#define REB_JACOBI_C (9)
+static void reb_transformations_inertial_to_jacobi_parallel(const struct reb_particle* const particles, struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N, const int c0, const int c1, const int set_m){
+    const int threads = omp_get_max_threads();
+    double* const partial = calloc((threads+1)*(REB_JACOBI_C+1),sizeof(double)); // partial sums; last entry is mass
+#pragma omp parallel
+    {
+        const int nt = omp_get_num_threads();
+        const int t = omp_get_thread_num();
+        const unsigned int lo = (unsigned int)(((unsigned long)N*t)/nt);
+        const unsigned int hi = (unsigned int)(((unsigned long)N*(t+1))/nt);
+        double* const S = partial + (t+1)*(REB_JACOBI_C+1);
+        for (unsigned int i=lo;i<hi;i++){
+            const double m = p_mass[i].m;
+            const double* const x = &particles[i].x;
+            for (int c=c0;c<c1;c++){
+                S[c] += m*x[c];
+            }
+            S[REB_JACOBI_C] += m;
+        }
+#pragma omp barrier
+        // Offset from all blocks before this one
+        double s[REB_JACOBI_C+1] = {0};
+        for (int k=1;k<=t;k++){
+            for (int c=c0;c<c1;c++){
+                s[c] += partial[k*(REB_JACOBI_C+1)+c];
+            }
+            s[REB_JACOBI_C] += partial[k*(REB_JACOBI_C+1)+REB_JACOBI_C];
+        }
+        for (unsigned int i=lo;i<hi;i++){
+            const double m = p_mass[i].m;
+            const double* const x = &particles[i].x;
+            if (i>0){
+                double* const xj = &p_j[i].x;
+                const double ei = 1./s[REB_JACOBI_C];
+                for (int c=c0;c<c1;c++){
+                    xj[c] = x[c] - s[c]*ei;
+                }
+                if (set_m){
+                    p_j[i].m = particles[i].m;
+                }
+            }
+            for (int c=c0;c<c1;c++){
+                s[c] += m*x[c];
+            }
+            s[REB_JACOBI_C] += m;
+        }
+    }
+    double s[REB_JACOBI_C+1] = {0};
+    for (int k=1;k<=threads;k++){
+        for (int c=c0;c<c1;c++){
+            s[c] += partial[k*(REB_JACOBI_C+1)+c];
+        }
+        s[REB_JACOBI_C] += partial[k*(REB_JACOBI_C+1)+REB_JACOBI_C];
+    }
+    const double Mtotali = 1./s[REB_JACOBI_C];
+    double* const x0 = &p_j[0].x;
+    for (int c=c0;c<c1;c++){
+        x0[c] = s[c]*Mtotali;
+    }
+    if (set_m){
+        p_j[0].m = s[REB_JACOBI_C];
+    }
+    free(partial);
+}
+
+static void reb_transformations_jacobi_to_inertial_parallel(struct reb_particle* const particles, const struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N, const int c0, const int c1){
+    // x_i = pj_i + R_{i-1} where R_{i-1} = R_{N-1} - sum_{k>=i} m_k pj_k / eta_k
+    const int threads = omp_get_max_threads();
+    double* const mass = calloc(threads+1,sizeof(double));
+    double* const partial = calloc((threads+1)*REB_JACOBI_C,sizeof(double));
+    const double* const R = &p_j[0].x;
+#pragma omp parallel
+    {
+        const int nt = omp_get_num_threads();
+        const int t = omp_get_thread_num();
+        const unsigned int lo = (unsigned int)(((unsigned long)N*t)/nt);
+        const unsigned int hi = (unsigned int)(((unsigned long)N*(t+1))/nt);
+        for (unsigned int i=lo;i<hi;i++){
+            mass[t+1] += p_mass[i].m;
+        }
+#pragma omp barrier
+        double eta = 0.;
+        for (int k=1;k<=t;k++){
+            eta += mass[k];
+        }
+        double* const T = partial + (t+1)*REB_JACOBI_C;
+        for (unsigned int i=lo;i<hi;i++){
+            eta += p_mass[i].m;
+            if (i>0){
+                const double f = p_mass[i].m/eta;
+                const double* const xj = &p_j[i].x;
+                for (int c=c0;c<c1;c++){
+                    T[c] += f*xj[c];
+                }
+            }
+        }
+#pragma omp barrier
+        double s[REB_JACOBI_C] = {0};
+        for (int k=t+2;k<=nt;k++){
+            for (int c=c0;c<c1;c++){
+                s[c] += partial[k*REB_JACOBI_C+c];
+            }
+        }
+        for (unsigned int i=hi;i-->lo;){
+            if (i==0) break;
+            const double f = p_mass[i].m/eta;
+            const double* const xj = &p_j[i].x;
+            double* const x = &particles[i].x;
+            for (int c=c0;c<c1;c++){
+                s[c] += f*xj[c];
+                x[c] = xj[c] + (R[c] - s[c]);
+            }
+            eta -= p_mass[i].m;
+        }
+    }
+    double s[REB_JACOBI_C] = {0};
+    for (int k=1;k<=threads;k++){
+        for (int c=c0;c<c1;c++){
+            s[c] += partial[k*REB_JACOBI_C+c];
+        }
+    }
+    double* const x0 = &particles[0].x;
+    for (int c=c0;c<c1;c++){
+        x0[c] = R[c] - s[c];
+    }
+    free(mass);
+    free(partial);
+}
+#endif // OPENMP
 
 /******************************
  * Jacobi */
 
 void reb_transformations_inertial_to_jacobi_posvel(const struct reb_particle* const particles, struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_inertial_to_jacobi_parallel(particles, p_j, p_mass, N, 0, 6, 1);
+        return;
+    }
+#endif // OPENMP
     double eta = p_mass[0].m;
     double s_x = eta * particles[0].x;
     double s_y = eta * particles[0].y;
@@ -70,6 +222,12 @@ void reb_transformations_inertial_to_jacobi_posvel(const struct reb_particle* co
 }
 
 void reb_transformations_inertial_to_jacobi_posvelacc(const struct reb_particle* const particles, struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_inertial_to_jacobi_parallel(particles, p_j, p_mass, N, 0, 9, 1);
+        return;
+    }
+#endif // OPENMP
     double eta = p_mass[0].m;
     double s_x = eta * particles[0].x;
     double s_y = eta * particles[0].y;
@@ -120,6 +278,12 @@ void reb_transformations_inertial_to_jacobi_posvelacc(const struct reb_particle*
 }
 
 void reb_transformations_inertial_to_jacobi_acc(const struct reb_particle* const particles, struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_inertial_to_jacobi_parallel(particles, p_j, p_mass, N, 6, 9, 0);
+        return;
+    }
+#endif // OPENMP
     double eta = p_mass[0].m;
     double s_ax = eta * particles[0].ax;
     double s_ay = eta * particles[0].ay;
@@ -144,6 +308,12 @@ void reb_transformations_inertial_to_jacobi_acc(const struct reb_particle* const
 }
 
 void reb_transformations_jacobi_to_inertial_posvel(struct reb_particle* const particles, const struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_jacobi_to_inertial_parallel(particles, p_j, p_mass, N, 0, 6);
+        return;
+    }
+#endif // OPENMP
     double eta  = p_j[0].m;
     double s_x  = p_j[0].x  * eta;
     double s_y  = p_j[0].y  * eta;
@@ -184,6 +354,12 @@ void reb_transformations_jacobi_to_inertial_posvel(struct reb_particle* const pa
 }
 
 void reb_transformations_jacobi_to_inertial_pos(struct reb_particle* const particles, const struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_jacobi_to_inertial_parallel(particles, p_j, p_mass, N, 0, 3);
+        return;
+    }
+#endif // OPENMP
     double eta  = p_j[0].m;
     double s_x  = p_j[0].x  * eta;
     double s_y  = p_j[0].y  * eta;
@@ -209,6 +385,12 @@ void reb_transformations_jacobi_to_inertial_pos(struct reb_particle* const parti
 }
 
 void reb_transformations_jacobi_to_inertial_acc(struct reb_particle* const particles, const struct reb_particle* const p_j, const struct reb_particle* const p_mass, const unsigned int N){
+#ifdef OPENMP
+    if (!reb_omp_deterministic && N>=reb_transformations_omp_N_min){
+        reb_transformations_jacobi_to_inertial_parallel(particles, p_j, p_mass, N, 6, 9);
+        return;
+    }
+#endif // OPENMP
     double eta  = p_j[0].m;
     double s_ax  = p_j[0].ax  * eta;
     double s_ay  = p_j[0].ay  * eta;
@@ -244,7 +426,7 @@ void reb_transformations_inertial_to_whds_posvel(const struct reb_particle* cons
     double vy0 = 0.;
     double vz0 = 0.;
     double m0  = 0.;
-#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) reduction(+:m0)
+#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) reduction(+:m0) if(!reb_omp_deterministic)
     for (unsigned int i=0;i<N;i++){
         double m = particles[i].m;
         x0  += particles[i].x *m;
@@ -297,7 +479,7 @@ void reb_transformations_whds_to_inertial_posvel(struct reb_particle* const part
     double vx0  = 0.;
     double vy0  = 0.;
     double vz0  = 0.;
-#pragma omp parallel for reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) 
+#pragma omp parallel for reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) if(!reb_omp_deterministic)
     for (int i=1;i<N;i++){
         double m = particles[i].m;
         vx0 += p_h[i].vx*m/(m0+m);
@@ -325,7 +507,7 @@ void reb_transformations_inertial_to_democraticheliocentric_posvel_testparticles
     double vy0 = 0.;
     double vz0 = 0.;
     double m0  = 0.;
-#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) reduction(+:m0)
+#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) reduction(+:m0) if(!reb_omp_deterministic)
     for (int i=0;i<N_active;i++){
         double m = particles[i].m;
         x0  += particles[i].x *m;
@@ -365,7 +547,7 @@ void reb_transformations_democraticheliocentric_to_inertial_pos_testparticles(st
     double x0  = 0.;
     double y0  = 0.;
     double z0  = 0.;
-#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) 
+#pragma omp parallel for reduction(+:x0) reduction(+:y0) reduction(+:z0) if(!reb_omp_deterministic)
     for (int i=1;i<N_active;i++){
         double m = p_h[i].m;
         x0 += p_h[i].x*m/mtot;
@@ -400,7 +582,7 @@ void reb_transformations_democraticheliocentric_to_inertial_posvel_testparticles
     double vx0  = 0.;
     double vy0  = 0.;
     double vz0  = 0.;
-#pragma omp parallel for reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) 
+#pragma omp parallel for reduction(+:vx0) reduction(+:vy0) reduction(+:vz0) if(!reb_omp_deterministic)
     for (int i=1;i<N_active;i++){
         double m = particles[i].m;
         vx0 += p_h[i].vx*m/m0;
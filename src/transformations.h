@@ -25,5 +25,8 @@
 
 #ifndef _TRANFORMATIONS_H
 #define _TRANFORMATIONS_H
+#ifdef OPENMP
+extern int reb_omp_deterministic;   ///< If 1, reductions are calculated in serial order (see reb_omp_set_deterministic()).
+#endif // OPENMP
 
 #endif
\ No newline at end of file